@@ -0,0 +1,54 @@
+// Host (Linux) port of the mixedtones hardware layer, see mixedtones_host.h
+
+#include <stdint.h>
+#include "../mixedtones_config.h"
+#include "../mixedtones_hal.h"
+#include "mixedtones_host.h"
+
+static int32_t hostSampleRate = 11025;
+static uint64_t hostSamples = 0;
+
+bool audioHalBegin(int32_t sample_rate, uint8_t pin_piezo, uint8_t pin_speaker_enable, bool run_on_core1) {
+    (void)pin_piezo;
+    (void)pin_speaker_enable;
+    (void)run_on_core1;
+    
+    hostSampleRate = sample_rate;
+    hostSamples = 0;
+    return true;
+}
+
+uint32_t audioHalMillis() {
+    return (uint32_t)(hostSamples * 1000 / hostSampleRate);
+}
+
+bool audioHalOnCore1() {
+    return false;
+}
+
+// No sample clock to measure on the host, only the sample count is known
+void audioHalGetStats(AudioStats &stats) {
+    stats.callbacks = (uint32_t)hostSamples;
+    stats.avg_cycles = 0;
+    stats.max_cycles = 0;
+    stats.cycle_budget = 0;
+    stats.late_periods = 0;
+    stats.missed_periods = 0;
+    stats.max_jitter_us = 0;
+}
+
+void audioHalResetStats() {
+}
+
+uint16_t audioHostRenderSample() {
+    hostSamples++;
+    return audioRenderSample();
+}
+
+uint64_t audioHostSampleCount() {
+    return hostSamples;
+}
+
+uint16_t audioHostOutputMax() {
+    return (1 << MIXEDTONES_PWM_BITS) - 1;
+}
@@ -0,0 +1,19 @@
+// Host (Linux) port of the mixedtones hardware layer. Instead of a timer the
+// caller pulls samples; audioHalMillis() follows the rendered sample count so
+// scheduled tones start at the same sample they would on the board.
+
+#ifndef MIXEDTONES_HOST_H
+#define MIXEDTONES_HOST_H
+
+#include <stdint.h>
+
+// Render the next sample and advance the host clock
+uint16_t audioHostRenderSample();
+
+// Number of samples rendered since setupAudio()
+uint64_t audioHostSampleCount();
+
+// Full scale of the values returned by audioHostRenderSample()
+uint16_t audioHostOutputMax();
+
+#endif
@@ -0,0 +1,465 @@
+// Offline renderer and benchmark for the mixedtones engine.
+//
+// Build on Linux from this directory:
+//   g++ -O2 -o mixedtones_render mixedtones_render.cpp mixedtones_host.cpp mixedtones_wav.cpp ../mixedtones.cpp
+//
+// Render a sequence file to a WAV file:
+//   ./mixedtones_render [-r sample_rate] [-o out.wav] [-t tail_ms] demo.seq
+// Measure mixer cost per sample against the number of active tone and
+// sample voices:
+//   ./mixedtones_render --bench [-r sample_rate]
+// Regression check: render the sequence at every sample rate in its
+// reference file (demo.seq -> demo.ref) and compare a hash of every second
+// of output, exits with 1 on a mismatch. --update writes the reference
+// from the current mixer (-r picks the rates, 22050 and 44100 by
+// default), listen to the WAV before checking it in:
+//   ./mixedtones_render --check demo.seq
+//   ./mixedtones_render --update [-r sample_rate]... demo.seq
+//
+// Sequence files hold one event per line, '#' starts a comment:
+//   <time_ms> tone <frequency> <volume> [duration_sec] [delay_sec]
+//   <time_ms> note <midi_note> <cents> <volume> [duration_ms] [delay_ms]
+//   <time_ms> sweep <from> <to> <volume> <sweep_sec> <duration_sec> [exponential] [pingpong]
+//   <time_ms> vibrato <frequency> <volume> <rate_hz> <depth_cents> [duration_sec]
+//   <time_ms> arp <frequency> <volume> <step_sec> <duration_sec> <semitones>...
+//   <time_ms> sample <clip> <volume> [pitch] [loop] [loop_start] [loop_end]
+//   <time_ms> stop
+//
+// The clip of a sample event is a WAV file, encoded to IMA-ADPCM in memory
+// first so the mixer plays it the same way it plays a converted clip on the
+// board, or one of the sketch's clips: kick, snare, or kick8 for the kick
+// as 8 bit PCM. Loop points are in clip samples and replace the clip's own.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdint.h>
+#include <algorithm>
+#include <chrono>
+#include <list>
+#include <string>
+#include <vector>
+#include "../mixedtones.h"
+#include "../mixedtones_adpcm.h"
+#include "../sample_kick.h"
+#include "../sample_snare.h"
+#include "mixedtones_host.h"
+#include "mixedtones_wav.h"
+
+struct Event {
+    uint32_t time_ms;
+    char command[16];
+    char text[128];  // first argument as written, for file names
+    float args[16];
+    int arg_count;
+};
+
+static bool loadSequence(const char *path, std::vector<Event> &events) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "Cannot open %s\n", path);
+        return false;
+    }
+    
+    char line[256];
+    int line_no = 0;
+    while (fgets(line, sizeof(line), f)) {
+        line_no++;
+        char *comment = strchr(line, '#');
+        if (comment) *comment = 0;
+        
+        Event ev;
+        memset(&ev, 0, sizeof(ev));
+        char *tok = strtok(line, " \t\r\n");
+        if (!tok) continue;
+        ev.time_ms = (uint32_t)strtoul(tok, NULL, 10);
+        
+        tok = strtok(NULL, " \t\r\n");
+        if (!tok) {
+            fprintf(stderr, "%s:%d: missing command\n", path, line_no);
+            fclose(f);
+            return false;
+        }
+        snprintf(ev.command, sizeof(ev.command), "%s", tok);
+        
+        while ((tok = strtok(NULL, " \t\r\n")) && ev.arg_count < 16) {
+            if (ev.arg_count == 0) snprintf(ev.text, sizeof(ev.text), "%s", tok);
+            ev.args[ev.arg_count++] = strtof(tok, NULL);
+        }
+        events.push_back(ev);
+    }
+    fclose(f);
+    return true;
+}
+
+// Clips loaded by sample events, one per clip and loop points. The voices
+// keep pointers into these, so they live until the program exits.
+struct LoadedClip {
+    std::string path;
+    uint32_t loop_start, loop_end;
+    std::vector<uint8_t> data;
+    AudioSample sample;
+};
+static std::list<LoadedClip> clips;
+
+// The whole of an ADPCM clip as 16 bit samples
+static void decodeClip(const AudioSample &s, std::vector<int16_t> &pcm) {
+    uint32_t per_block = adpcmSamplesPerBlock(s.block_size);
+    pcm.clear();
+    AdpcmState st = {};
+    for (uint32_t i = 0; i < s.length; i++) {
+        const uint8_t *block = s.data + i / per_block * s.block_size;
+        uint32_t pos = i % per_block;
+        if (pos == 0) {
+            pcm.push_back(adpcmBlockStart(st, block));
+        } else {
+            uint8_t byte = block[4 + (pos - 1) / 2];
+            pcm.push_back(adpcmDecode(st, (pos - 1) & 1 ? byte >> 4 : byte & 15));
+        }
+    }
+}
+
+static bool openClip(const char *path, LoadedClip &clip) {
+    if (strcmp(path, "kick") == 0) {
+        clip.sample = sample_kick;
+        return true;
+    }
+    if (strcmp(path, "snare") == 0) {
+        clip.sample = sample_snare;
+        return true;
+    }
+    
+    std::vector<int16_t> pcm;
+    int32_t rate = 0;
+    if (strcmp(path, "kick8") == 0) {
+        decodeClip(sample_kick, pcm);
+        clip.data.resize(pcm.size());
+        for (size_t i = 0; i < pcm.size(); i++) clip.data[i] = (uint8_t)(int8_t)(pcm[i] >> 8);
+        AudioSample sample = { &clip.data[0], (uint32_t)pcm.size(), sample_kick.sample_rate, 0, 0, 0, SAMPLE_PCM8 };
+        clip.sample = sample;
+        return true;
+    }
+    
+    if (!readWav(path, pcm, rate) || pcm.empty()) return false;
+    const uint16_t block_size = 256;
+    clip.data.resize(adpcmEncodedSize((uint32_t)pcm.size(), block_size));
+    adpcmEncodeBlocks(&pcm[0], (uint32_t)pcm.size(), block_size, &clip.data[0]);
+    AudioSample sample = { &clip.data[0], (uint32_t)pcm.size(), (uint32_t)rate, 0, 0, block_size, SAMPLE_IMA_ADPCM };
+    clip.sample = sample;
+    return true;
+}
+
+// loop_end 0 keeps the clip's own loop points
+static const AudioSample *loadClip(const char *path, uint32_t loop_start, uint32_t loop_end) {
+    for (std::list<LoadedClip>::iterator it = clips.begin(); it != clips.end(); ++it) {
+        if (it->path == path && it->loop_start == loop_start && it->loop_end == loop_end) return &it->sample;
+    }
+    
+    clips.push_back(LoadedClip());
+    LoadedClip &clip = clips.back();
+    clip.path = path;
+    clip.loop_start = loop_start;
+    clip.loop_end = loop_end;
+    if (!openClip(path, clip)) {
+        fprintf(stderr, "Cannot load clip %s\n", path);
+        clips.pop_back();
+        return NULL;
+    }
+    if (loop_end) {
+        clip.sample.loop_start = loop_start;
+        clip.sample.loop_end = loop_end;
+    }
+    return &clip.sample;
+}
+
+static bool applyEvent(const Event &ev) {
+    if (strcmp(ev.command, "tone") == 0 && ev.arg_count >= 2) {
+        playTone(ev.args[0], (uint8_t)ev.args[1],
+                 ev.arg_count > 2 ? ev.args[2] : 0,
+                 ev.arg_count > 3 ? ev.args[3] : 0);
+    } else if (strcmp(ev.command, "note") == 0 && ev.arg_count >= 3) {
+        playNote((uint8_t)ev.args[0], (int8_t)ev.args[1], (uint8_t)ev.args[2],
+                 ev.arg_count > 3 ? audioMsToSamples((uint32_t)ev.args[3]) : 0,
+                 ev.arg_count > 4 ? audioMsToSamples((uint32_t)ev.args[4]) : 0);
+    } else if (strcmp(ev.command, "sweep") == 0 && ev.arg_count >= 5) {
+        ToneMod mod;
+        mod.sweep_to = ev.args[1];
+        mod.sweep_time = ev.args[3];
+        mod.sweep_exponential = ev.arg_count > 5 && ev.args[5] != 0;
+        mod.sweep_pingpong = ev.arg_count > 6 && ev.args[6] != 0;
+        playToneMod(ev.args[0], (uint8_t)ev.args[2], mod, ev.args[4]);
+    } else if (strcmp(ev.command, "vibrato") == 0 && ev.arg_count >= 4) {
+        ToneMod mod;
+        mod.vibrato_rate = ev.args[2];
+        mod.vibrato_depth = (uint8_t)ev.args[3];
+        playToneMod(ev.args[0], (uint8_t)ev.args[1], mod, ev.arg_count > 4 ? ev.args[4] : 0);
+    } else if (strcmp(ev.command, "arp") == 0 && ev.arg_count >= 5) {
+        int8_t steps[12];
+        ToneMod mod;
+        mod.arpeggio_length = (uint8_t)(ev.arg_count - 4);
+        for (int i = 0; i < mod.arpeggio_length; i++) steps[i] = (int8_t)ev.args[4 + i];
+        mod.arpeggio = steps;
+        mod.arpeggio_step = ev.args[2];
+        playToneMod(ev.args[0], (uint8_t)ev.args[1], mod, ev.args[3]);
+    } else if (strcmp(ev.command, "sample") == 0 && ev.arg_count >= 2) {
+        const AudioSample *clip = loadClip(ev.text, ev.arg_count > 5 ? (uint32_t)ev.args[4] : 0,
+                                           ev.arg_count > 5 ? (uint32_t)ev.args[5] : 0);
+        if (!clip) return false;
+        playSample(*clip, (uint8_t)ev.args[1],
+                   ev.arg_count > 2 ? ev.args[2] : 1.0f,
+                   ev.arg_count > 3 && ev.args[3] != 0);
+    } else if (strcmp(ev.command, "stop") == 0) {
+        stopAllTones();
+    } else {
+        fprintf(stderr, "Unknown or incomplete event '%s' at %u ms\n", ev.command, ev.time_ms);
+        return false;
+    }
+    return true;
+}
+
+// Renders the sequence plus tail_ms into samples, as 16 bit signed
+static bool renderSequence(const std::vector<Event> &events, int32_t sample_rate, uint32_t tail_ms,
+                           std::vector<int16_t> &samples) {
+    uint32_t end_ms = tail_ms;
+    for (size_t i = 0; i < events.size(); i++) {
+        if (events[i].time_ms + tail_ms > end_ms) end_ms = events[i].time_ms + tail_ms;
+    }
+    
+    setupAudio(sample_rate, 0, 0);
+    
+    uint64_t total = (uint64_t)end_ms * sample_rate / 1000;
+    samples.clear();
+    samples.reserve(total);
+    
+    // Events and updateAudio() run once per millisecond, like a sketch loop
+    size_t next_event = 0;
+    uint32_t last_ms = UINT32_MAX;
+    uint16_t full_scale = audioHostOutputMax();
+    
+    for (uint64_t n = 0; n < total; n++) {
+        uint32_t now_ms = (uint32_t)(n * 1000 / sample_rate);
+        if (now_ms != last_ms) {
+            last_ms = now_ms;
+            while (next_event < events.size() && events[next_event].time_ms <= now_ms) {
+                if (!applyEvent(events[next_event])) return false;
+                next_event++;
+            }
+            updateAudio();
+        }
+        
+        uint16_t level = audioHostRenderSample();
+        samples.push_back((int16_t)((int32_t)level * 32767 / full_scale));
+    }
+    stopAllTones();
+    return true;
+}
+
+static int render(const char *seq_path, const char *wav_path, int32_t sample_rate, uint32_t tail_ms) {
+    std::vector<Event> events;
+    std::vector<int16_t> samples;
+    if (!loadSequence(seq_path, events)) return 1;
+    if (!renderSequence(events, sample_rate, tail_ms, samples)) return 1;
+    
+    if (!writeWav(wav_path, samples, sample_rate)) return 1;
+    printf("Rendered %zu ms (%zu samples at %d Hz) to %s\n",
+           samples.size() * 1000 / sample_rate, samples.size(), (int)sample_rate, wav_path);
+    return 0;
+}
+
+// FNV-1a over the samples of one second, so a mismatch says where
+static uint64_t hashSecond(const std::vector<int16_t> &samples, int32_t sample_rate, uint32_t second) {
+    uint64_t hash = 14695981039346656037ull;
+    size_t end = std::min(samples.size(), (size_t)(second + 1) * sample_rate);
+    for (size_t i = (size_t)second * sample_rate; i < end; i++) {
+        hash = (hash ^ (uint16_t)samples[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+static std::string referencePath(const char *seq_path) {
+    std::string path = seq_path;
+    size_t dot = path.rfind('.');
+    if (dot != std::string::npos && path.find('/', dot) == std::string::npos) path.erase(dot);
+    return path + ".ref";
+}
+
+// Reference lines: <sample_rate> <second> <hash in hex>
+static int check(const char *seq_path, uint32_t tail_ms) {
+    std::vector<Event> events;
+    if (!loadSequence(seq_path, events)) return 1;
+    std::string ref_path = referencePath(seq_path);
+    FILE *f = fopen(ref_path.c_str(), "r");
+    if (!f) {
+        fprintf(stderr, "Cannot open %s, write it with --update\n", ref_path.c_str());
+        return 1;
+    }
+    
+    std::vector<int16_t> samples;
+    int32_t rendered_rate = 0;
+    int failures = 0, checked = 0;
+    char line[256];
+    while (fgets(line, sizeof(line), f)) {
+        long rate;
+        unsigned long second;
+        unsigned long long expect;
+        if (line[0] == '#' || sscanf(line, "%ld %lu %llx", &rate, &second, &expect) != 3) continue;
+        if (rate != rendered_rate) {
+            rendered_rate = (int32_t)rate;
+            if (!renderSequence(events, rendered_rate, tail_ms, samples)) {
+                fclose(f);
+                return 1;
+            }
+        }
+        uint64_t got = hashSecond(samples, rendered_rate, (uint32_t)second);
+        if (got != expect) {
+            printf("FAIL %ld Hz, second %lu: %016llx, expected %016llx\n", rate, second,
+                   (unsigned long long)got, expect);
+            failures++;
+        }
+        checked++;
+    }
+    fclose(f);
+    
+    if (checked == 0) {
+        fprintf(stderr, "No reference hashes in %s\n", ref_path.c_str());
+        return 1;
+    }
+    printf("%s: %d seconds checked, %s, %d failed\n", seq_path, checked, failures ? "FAILED" : "all passed",
+           failures);
+    return failures ? 1 : 0;
+}
+
+static int update(const char *seq_path, const std::vector<int32_t> &rates, uint32_t tail_ms) {
+    std::vector<Event> events;
+    if (!loadSequence(seq_path, events)) return 1;
+    std::string ref_path = referencePath(seq_path);
+    FILE *f = fopen(ref_path.c_str(), "w");
+    if (!f) {
+        fprintf(stderr, "Cannot write %s\n", ref_path.c_str());
+        return 1;
+    }
+    
+    fprintf(f, "# mixedtones_render --check reference for %s: <sample_rate> <second> <FNV-1a of its samples>\n",
+            seq_path);
+    std::vector<int16_t> samples;
+    for (size_t r = 0; r < rates.size(); r++) {
+        if (!renderSequence(events, rates[r], tail_ms, samples)) {
+            fclose(f);
+            return 1;
+        }
+        uint32_t seconds = (uint32_t)((samples.size() + rates[r] - 1) / rates[r]);
+        for (uint32_t s = 0; s < seconds; s++) {
+            fprintf(f, "%d %u %016llx\n", (int)rates[r], s, (unsigned long long)hashSecond(samples, rates[r], s));
+        }
+    }
+    fclose(f);
+    printf("Wrote %s\n", ref_path.c_str());
+    return 0;
+}
+
+static void benchRun(const char *label, int32_t sample_rate, const AudioSample *clip) {
+    const uint32_t warmup = 10000;
+    const uint32_t measured = 2000000;
+    
+    printf("%s\nvoices  ns/sample  %% of sample period\n", label);
+    
+    volatile uint32_t sink = 0;
+    for (int voices = 1; voices <= getMaxChannels(); voices *= 2) {
+        stopAllTones();
+        updateAudio();
+        for (int i = 0; i < voices; i++) {
+            if (clip) playSample(*clip, 20, 1.0f + 0.01f * i, true);
+            else playTone(200.0f + 37.0f * i, 20);
+        }
+        
+        for (uint32_t n = 0; n < warmup; n++) sink += audioHostRenderSample();
+        
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t n = 0; n < measured; n++) sink += audioHostRenderSample();
+        auto stop = std::chrono::steady_clock::now();
+        
+        double ns = std::chrono::duration<double, std::nano>(stop - start).count() / measured;
+        double period_ns = 1e9 / sample_rate;
+        printf("%6d  %9.2f  %6.3f\n", voices, ns, 100.0 * ns / period_ns);
+    }
+    (void)sink;
+}
+
+static int bench(int32_t sample_rate) {
+    setupAudio(sample_rate, 0, 0);
+    printf("Sample rate %d Hz, 2000000 samples per run\n", (int)sample_rate);
+    benchRun("Square tones", sample_rate, NULL);
+    
+    // One second of a 440 Hz sine at 22050 Hz, looped, as an ADPCM clip
+    const uint32_t length = 22050;
+    const uint16_t block_size = 256;
+    std::vector<int16_t> pcm(length);
+    for (uint32_t i = 0; i < length; i++) {
+        pcm[i] = (int16_t)(20000 * sin(2 * M_PI * 440 * i / 22050.0));
+    }
+    std::vector<uint8_t> data(adpcmEncodedSize(length, block_size));
+    adpcmEncodeBlocks(&pcm[0], length, block_size, &data[0]);
+    AudioSample clip = { &data[0], length, 22050, 0, 0, block_size, SAMPLE_IMA_ADPCM };
+    benchRun("ADPCM sample voices", sample_rate, &clip);
+    stopAllTones();
+    return 0;
+}
+
+static void usage() {
+    fprintf(stderr,
+            "usage: mixedtones_render [-r sample_rate] [-o out.wav] [-t tail_ms] sequence.seq\n"
+            "       mixedtones_render --bench [-r sample_rate]\n"
+            "       mixedtones_render --check sequence.seq\n"
+            "       mixedtones_render --update [-r sample_rate]... sequence.seq\n");
+}
+
+int main(int argc, char **argv) {
+    int32_t sample_rate = 44100;
+    uint32_t tail_ms = 1000;
+    const char *out = "mixedtones.wav";
+    const char *seq = NULL;
+    bool do_bench = false, do_check = false, do_update = false;
+    std::vector<int32_t> rates;
+    
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--bench") == 0) {
+            do_bench = true;
+        } else if (strcmp(argv[i], "--check") == 0) {
+            do_check = true;
+        } else if (strcmp(argv[i], "--update") == 0) {
+            do_update = true;
+        } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            sample_rate = atoi(argv[++i]);
+            rates.push_back(sample_rate);
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            out = argv[++i];
+        } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            tail_ms = (uint32_t)atoi(argv[++i]);
+        } else if (argv[i][0] != '-' && !seq) {
+            seq = argv[i];
+        } else {
+            usage();
+            return 1;
+        }
+    }
+    
+    if (sample_rate <= 0) {
+        usage();
+        return 1;
+    }
+    if (do_bench) return bench(sample_rate);
+    if (!seq) {
+        usage();
+        return 1;
+    }
+    if (do_check) return check(seq, tail_ms);
+    if (do_update) {
+        if (rates.empty()) {
+            rates.push_back(22050);
+            rates.push_back(44100);
+        }
+        return update(seq, rates, tail_ms);
+    }
+    return render(seq, out, sample_rate, tail_ms);
+}
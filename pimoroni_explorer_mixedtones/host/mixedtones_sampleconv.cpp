@@ -0,0 +1,199 @@
+// Converts a WAV file into a C header with an AudioSample for playSample().
+//
+// Build on Linux from this directory:
+//   g++ -O2 -o mixedtones_sampleconv mixedtones_sampleconv.cpp mixedtones_wav.cpp
+//
+// Convert to 4 bit IMA-ADPCM (default) or signed 8 bit PCM:
+//   ./mixedtones_sampleconv [-8] [-b block_size] [-l loop_start:loop_end] [-n name] [-o out.h] clip.wav
+// Encode, decode again and report how far the result is from the original:
+//   ./mixedtones_sampleconv --check [-8] [-b block_size] clip.wav
+//
+// The header holds a const data array and a const AudioSample, include it
+// in one .cpp/.ino file of the sketch.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+#include <vector>
+#include "../mixedtones.h"
+#include "../mixedtones_adpcm.h"
+#include "mixedtones_wav.h"
+
+static void encode(const std::vector<int16_t> &pcm, bool pcm8, uint16_t block_size, std::vector<uint8_t> &data) {
+    if (pcm8) {
+        data.resize(pcm.size());
+        for (size_t i = 0; i < pcm.size(); i++) {
+            int32_t v = (pcm[i] + 128) >> 8;
+            if (v > 127) v = 127;
+            data[i] = (uint8_t)(int8_t)v;
+        }
+    } else {
+        data.resize(adpcmEncodedSize((uint32_t)pcm.size(), block_size));
+        adpcmEncodeBlocks(&pcm[0], (uint32_t)pcm.size(), block_size, &data[0]);
+    }
+}
+
+// Decode the whole clip the way the mixer walks through it
+static void decode(const std::vector<uint8_t> &data, uint32_t length, bool pcm8, uint16_t block_size, std::vector<int16_t> &pcm) {
+    pcm.resize(length);
+    if (pcm8) {
+        for (uint32_t i = 0; i < length; i++) {
+            pcm[i] = (int16_t)((int8_t)data[i] * 256);
+        }
+        return;
+    }
+    
+    uint32_t per_block = adpcmSamplesPerBlock(block_size);
+    AdpcmState st = { 0, 0 };
+    for (uint32_t i = 0; i < length; i++) {
+        const uint8_t *block = &data[(i / per_block) * block_size];
+        uint32_t k = i % per_block;
+        if (k == 0) {
+            pcm[i] = adpcmBlockStart(st, block);
+        } else {
+            uint8_t byte = block[4 + (k - 1) / 2];
+            pcm[i] = adpcmDecode(st, (k - 1) & 1 ? byte >> 4 : byte & 15);
+        }
+    }
+}
+
+static int check(const std::vector<int16_t> &pcm, bool pcm8, uint16_t block_size) {
+    std::vector<uint8_t> data;
+    std::vector<int16_t> decoded;
+    encode(pcm, pcm8, block_size, data);
+    decode(data, (uint32_t)pcm.size(), pcm8, block_size, decoded);
+    
+    double signal = 0, noise = 0;
+    int32_t max_error = 0;
+    for (size_t i = 0; i < pcm.size(); i++) {
+        int32_t error = decoded[i] - pcm[i];
+        if (abs(error) > max_error) max_error = abs(error);
+        signal += (double)pcm[i] * pcm[i];
+        noise += (double)error * error;
+    }
+    
+    printf("%zu samples, %zu bytes (%.2f bits per sample)\n",
+           pcm.size(), data.size(), 8.0 * data.size() / pcm.size());
+    printf("max error %d, SNR %.1f dB\n", (int)max_error,
+           noise > 0 ? 10.0 * log10(signal / noise) : 999.0);
+    
+    // Block headers carry the exact sample, so block starts must match
+    if (!pcm8) {
+        uint32_t per_block = adpcmSamplesPerBlock(block_size);
+        for (size_t i = 0; i < pcm.size(); i += per_block) {
+            if (decoded[i] != pcm[i]) {
+                printf("FAIL: block start %zu decodes to %d instead of %d\n", i, decoded[i], pcm[i]);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+static bool writeHeader(const char *path, const char *name, const char *source,
+                        const std::vector<uint8_t> &data, uint32_t length, int32_t rate,
+                        uint32_t loop_start, uint32_t loop_end, bool pcm8, uint16_t block_size) {
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        fprintf(stderr, "Cannot write %s\n", path);
+        return false;
+    }
+    
+    fprintf(f, "// Generated by mixedtones_sampleconv from %s\n", source);
+    fprintf(f, "// %u samples at %d Hz, %s, %zu bytes\n\n", length, (int)rate,
+            pcm8 ? "8 bit PCM" : "IMA-ADPCM", data.size());
+    fprintf(f, "#pragma once\n\n#include \"mixedtones.h\"\n\n");
+    fprintf(f, "static const uint8_t %s_data[%zu] = {", name, data.size());
+    for (size_t i = 0; i < data.size(); i++) {
+        fprintf(f, "%s0x%02x,", i % 16 ? " " : "\n    ", data[i]);
+    }
+    fprintf(f, "\n};\n\n");
+    fprintf(f, "static const AudioSample %s = {\n", name);
+    fprintf(f, "    %s_data, %u, %d, %u, %u, %u, %s\n", name, length, (int)rate,
+            loop_start, loop_end, pcm8 ? 0 : block_size, pcm8 ? "SAMPLE_PCM8" : "SAMPLE_IMA_ADPCM");
+    fprintf(f, "};\n");
+    fclose(f);
+    return true;
+}
+
+static void usage() {
+    fprintf(stderr,
+            "usage: mixedtones_sampleconv [-8] [-b block_size] [-l loop_start:loop_end] [-n name] [-o out.h] clip.wav\n"
+            "       mixedtones_sampleconv --check [-8] [-b block_size] clip.wav\n");
+}
+
+int main(int argc, char **argv) {
+    bool pcm8 = false;
+    bool do_check = false;
+    uint32_t block_size = 256;
+    uint32_t loop_start = 0, loop_end = 0;
+    const char *name = NULL;
+    const char *out = NULL;
+    const char *in = NULL;
+    
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--check") == 0) {
+            do_check = true;
+        } else if (strcmp(argv[i], "-8") == 0) {
+            pcm8 = true;
+        } else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+            block_size = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc) {
+            if (sscanf(argv[++i], "%u:%u", &loop_start, &loop_end) != 2) {
+                usage();
+                return 1;
+            }
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            name = argv[++i];
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            out = argv[++i];
+        } else if (argv[i][0] != '-' && !in) {
+            in = argv[i];
+        } else {
+            usage();
+            return 1;
+        }
+    }
+    
+    if (!in || block_size < 8 || block_size > 4096) {
+        usage();
+        return 1;
+    }
+    
+    std::vector<int16_t> pcm;
+    int32_t rate = 0;
+    if (!readWav(in, pcm, rate)) return 1;
+    if (pcm.empty()) {
+        fprintf(stderr, "%s has no samples\n", in);
+        return 1;
+    }
+    if (loop_end > pcm.size() || loop_start >= (loop_end ? loop_end : pcm.size())) {
+        fprintf(stderr, "Loop points outside the clip (%zu samples)\n", pcm.size());
+        return 1;
+    }
+    
+    if (do_check) return check(pcm, pcm8, (uint16_t)block_size);
+    
+    // Default name from the file name, without directory and extension
+    std::string base = in;
+    size_t slash = base.find_last_of('/');
+    if (slash != std::string::npos) base = base.substr(slash + 1);
+    size_t dot = base.find_last_of('.');
+    if (dot != std::string::npos) base = base.substr(0, dot);
+    for (size_t i = 0; i < base.size(); i++) {
+        if (!isalnum((unsigned char)base[i])) base[i] = '_';
+    }
+    std::string sample_name = name ? name : "sample_" + base;
+    std::string out_path = out ? out : sample_name + ".h";
+    
+    std::vector<uint8_t> data;
+    encode(pcm, pcm8, (uint16_t)block_size, data);
+    if (!writeHeader(out_path.c_str(), sample_name.c_str(), in, data, (uint32_t)pcm.size(), rate,
+                     loop_start, loop_end, pcm8, (uint16_t)block_size)) {
+        return 1;
+    }
+    printf("Wrote %s (%zu samples, %zu bytes)\n", out_path.c_str(), pcm.size(), data.size());
+    return 0;
+}
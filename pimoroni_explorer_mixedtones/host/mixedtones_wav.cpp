@@ -0,0 +1,106 @@
+// WAV file helpers shared by the host tools, see mixedtones_wav.h
+
+#include <stdio.h>
+#include <string.h>
+#include "mixedtones_wav.h"
+
+static uint32_t readLE(const uint8_t *p, int bytes) {
+    uint32_t value = 0;
+    for (int i = bytes - 1; i >= 0; i--) {
+        value = (value << 8) | p[i];
+    }
+    return value;
+}
+
+static void writeLE(FILE *f, uint32_t value, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        fputc((value >> (i * 8)) & 0xFF, f);
+    }
+}
+
+bool readWav(const char *path, std::vector<int16_t> &samples, int32_t &sample_rate) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "Cannot open %s\n", path);
+        return false;
+    }
+    
+    std::vector<uint8_t> file;
+    uint8_t buf[4096];
+    size_t got;
+    while ((got = fread(buf, 1, sizeof(buf), f)) > 0) {
+        file.insert(file.end(), buf, buf + got);
+    }
+    fclose(f);
+    
+    if (file.size() < 12 || memcmp(&file[0], "RIFF", 4) != 0 || memcmp(&file[8], "WAVE", 4) != 0) {
+        fprintf(stderr, "%s is not a WAV file\n", path);
+        return false;
+    }
+    
+    uint16_t format = 0, channels = 0, bits = 0;
+    const uint8_t *data = NULL;
+    uint32_t data_bytes = 0;
+    size_t pos = 12;
+    while (pos + 8 <= file.size()) {
+        const uint8_t *chunk = &file[pos];
+        uint32_t size = readLE(chunk + 4, 4);
+        if (pos + 8 + size > file.size()) size = (uint32_t)(file.size() - pos - 8);
+        
+        if (memcmp(chunk, "fmt ", 4) == 0 && size >= 16) {
+            format = (uint16_t)readLE(chunk + 8, 2);
+            channels = (uint16_t)readLE(chunk + 10, 2);
+            sample_rate = (int32_t)readLE(chunk + 12, 4);
+            bits = (uint16_t)readLE(chunk + 22, 2);
+        } else if (memcmp(chunk, "data", 4) == 0) {
+            data = chunk + 8;
+            data_bytes = size;
+        }
+        pos += 8 + size + (size & 1);
+    }
+    
+    if (format != 1 || channels == 0 || (bits != 8 && bits != 16) || !data) {
+        fprintf(stderr, "%s: only 8 or 16 bit PCM WAV files are supported\n", path);
+        return false;
+    }
+    
+    uint32_t frame = channels * bits / 8;
+    uint32_t frames = data_bytes / frame;
+    samples.resize(frames);
+    for (uint32_t i = 0; i < frames; i++) {
+        int32_t sum = 0;
+        for (int ch = 0; ch < channels; ch++) {
+            const uint8_t *p = data + i * frame + ch * bits / 8;
+            sum += bits == 8 ? ((int32_t)p[0] - 128) * 256 : (int16_t)readLE(p, 2);
+        }
+        samples[i] = (int16_t)(sum / channels);
+    }
+    return true;
+}
+
+bool writeWav(const char *path, const std::vector<int16_t> &samples, int32_t sample_rate) {
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        fprintf(stderr, "Cannot write %s\n", path);
+        return false;
+    }
+    
+    uint32_t data_bytes = (uint32_t)(samples.size() * 2);
+    fwrite("RIFF", 1, 4, f);
+    writeLE(f, 36 + data_bytes, 4);
+    fwrite("WAVEfmt ", 1, 8, f);
+    writeLE(f, 16, 4);               // fmt chunk size
+    writeLE(f, 1, 2);                // PCM
+    writeLE(f, 1, 2);                // mono
+    writeLE(f, sample_rate, 4);
+    writeLE(f, sample_rate * 2, 4);  // byte rate
+    writeLE(f, 2, 2);                // block align
+    writeLE(f, 16, 2);               // bits per sample
+    fwrite("data", 1, 4, f);
+    writeLE(f, data_bytes, 4);
+    for (size_t i = 0; i < samples.size(); i++) {
+        writeLE(f, (uint16_t)samples[i], 2);
+    }
+    fclose(f);
+    return true;
+}
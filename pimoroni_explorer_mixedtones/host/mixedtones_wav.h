@@ -0,0 +1,15 @@
+// WAV file helpers shared by the host tools
+
+#ifndef MIXEDTONES_WAV_H
+#define MIXEDTONES_WAV_H
+
+#include <stdint.h>
+#include <vector>
+
+// Read an 8 or 16 bit PCM WAV file, stereo is mixed down to mono
+bool readWav(const char *path, std::vector<int16_t> &samples, int32_t &sample_rate);
+
+// Write 16 bit mono PCM
+bool writeWav(const char *path, const std::vector<int16_t> &samples, int32_t sample_rate);
+
+#endif
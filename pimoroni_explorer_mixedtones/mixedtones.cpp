@@ -3,22 +3,63 @@
 #include <stdlib.h>
 #include <float.h>
 #include <stdint.h>
-#include <Arduino.h>
-#include <hardware/timer.h>
-#include <hardware/pwm.h>
-#include <pico/time.h>
+#include <math.h>
 #include "mixedtones.h"
-
-// Configuration
-uint8_t audioPinPiezo = 12;
-uint8_t speakerEnablePin = 13;
+#include "mixedtones_config.h"
+#include "mixedtones_hal.h"
+#include "mixedtones_adpcm.h"
 
 // Global audio time tracking
 uint32_t audioStartTime = 0;
 int32_t sampleRate = 11025;
-#define MAX_CHANNELS 64
-static struct repeating_timer audio_timer;
-static volatile bool timer_running = false;
+#define MAX_CHANNELS MIXEDTONES_MAX_VOICES
+
+static_assert(MAX_CHANNELS > 0 && MAX_CHANNELS <= 127, "channel numbers are int8_t");
+
+// Mix bus: voices are summed at constant gain into a 16 bit bus, scaled by
+// the master volume and soft limited, then reduced to the PWM resolution
+#define BUS_FULL_SCALE 65535
+#define OUTPUT_SHIFT (16 - MIXEDTONES_PWM_BITS)
+#define OUTPUT_MAX ((1 << MIXEDTONES_PWM_BITS) - 1)
+
+static uint8_t masterVolume = 255;
+static volatile int32_t busGain = MIXEDTONES_VOICE_GAIN * 256;  // Q16, voice gain * master
+static int32_t ditherError = 0;
+
+// Voice ownership. FREE and SCHEDULED voices belong to the main thread,
+// ACTIVE ones to the mixer. The mixer hands a finished voice back by moving
+// it ACTIVE -> FREE; the main thread takes one away early with the same
+// compare-and-swap, so exactly one side wins. The mixer may still be in the
+// middle of that voice then, so the main thread waits for the pass to end
+// before it writes the fields again (render_pass).
+enum VoiceState : uint8_t {
+    VOICE_FREE,
+    VOICE_SCHEDULED,
+    VOICE_ACTIVE
+};
+
+#define MOD_RATE MIXEDTONES_MOD_RATE
+#define MOD_ARP_MAX 8
+#define MOD_SWEEP_LINEAR 0x01
+#define MOD_SWEEP_EXP    0x02
+#define MOD_PINGPONG     0x04
+#define MOD_VIBRATO      0x08
+#define MOD_ARPEGGIO     0x10
+
+static_assert((MOD_RATE & (MOD_RATE - 1)) == 0, "MIXEDTONES_MOD_RATE must be a power of two");
+
+// Read position in a sample clip. ADPCM is decoded one code at a time as the
+// voice moves through a block, so no per-voice decode buffer is needed.
+struct SampleCursor {
+    uint32_t index;        // clip position of value
+    const uint8_t *block;  // ADPCM block holding index
+    uint16_t block_pos;    // index within that block
+    AdpcmState adpcm;
+    int16_t value;
+};
+
+// Most clip samples one output sample may step over, bounds the mixer time
+#define SAMPLE_MAX_STEP 8
 
 struct Oscillator {
     uint32_t phase;
@@ -28,15 +69,112 @@ struct Oscillator {
     uint32_t samples_played;
     uint32_t start_time_ms;
     uint16_t envelope;  // 0-256 for fade in/out
-    bool active;
-    bool scheduled;
+    uint8_t priority;
+    volatile uint8_t state;
+    
+    // Modulators, stepped by the mixer every MOD_RATE samples
+    uint8_t mod_flags;
+    uint32_t base_increment;  // pitch before arpeggio and vibrato
+    uint32_t sweep_origin;
+    uint32_t sweep_target;
+    int32_t sweep_step;       // linear: added per step
+    uint32_t sweep_mul;       // exponential: Q24 factor per step
+    uint32_t sweep_mul_back;  // ... and the way back for ping-pong
+    uint16_t vibrato_phase;
+    uint16_t vibrato_rate;    // added to vibrato_phase per step
+    uint16_t vibrato_depth;   // Q16 fraction of the pitch
+    int8_t arp_semitones[MOD_ARP_MAX];
+    uint8_t arp_length;
+    uint8_t arp_pos;
+    uint16_t arp_ticks;       // steps per arpeggio note
+    uint16_t arp_count;
+    
+    // Sample playback, sample is 0 for tone voices. phase counts clip
+    // samples in Q16 here.
+    const AudioSample *sample;
+    uint32_t loop_end;         // 0 = play once
+    SampleCursor cursor;
+    SampleCursor loop_cursor;  // saved on the way past loop_start
 };
 
 Oscillator oscillators[MAX_CHANNELS];
 
-// Active channel tracking
-static uint8_t active_channel_indices[MAX_CHANNELS];
-static uint8_t active_channel_count = 0;
+// Voice allocator (main thread only). Every voice sits on exactly one of two
+// intrusive lists: the free list, or the in-use list which is kept in
+// allocation order so its head is the oldest voice.
+struct VoiceList {
+    int8_t head;
+    int8_t tail;
+};
+
+static int8_t voice_next[MAX_CHANNELS];
+static int8_t voice_prev[MAX_CHANNELS];
+static bool voice_is_free[MAX_CHANNELS];
+static VoiceList free_voices = { -1, -1 };
+static VoiceList used_voices = { -1, -1 };
+static VoiceSteal stealMode = STEAL_OLDEST;
+
+// Allocation statistics (main thread) and peak voices (mixer)
+static uint32_t dropped_tones = 0;
+static uint32_t stolen_voices = 0;
+static volatile uint8_t peak_voices = 0;
+static volatile bool peak_restart = false;
+
+// Voices finished by the mixer, handed back to the allocator. Single
+// producer (mixer) / single consumer (main thread). An entry is only a hint
+// to look at that voice again, so stale entries are harmless.
+#define RETIRE_RING_SIZE 128
+static uint8_t retire_ring[RETIRE_RING_SIZE];
+static volatile uint8_t retire_head = 0;
+static uint8_t retire_tail = 0;
+
+static_assert(RETIRE_RING_SIZE > MAX_CHANNELS, "retire ring must hold every voice");
+
+// Mixer passes over the voices, odd while one is running
+static volatile uint32_t render_pass = 0;
+
+// Phase increment of every MIDI note at the current sample rate, built once
+// in setupAudio() so playNote() needs no floating point
+static uint32_t notePhaseInc[128];
+
+// 2^(cents/1200) - 1 in Q16 for 0-99 cents
+static const uint16_t centsFraction[100] = {
+       0,   38,   76,  114,  152,  190,  228,  266,  304,  342,
+     380,  418,  456,  494,  532,  570,  608,  647,  685,  723,
+     761,  800,  838,  876,  915,  953,  992, 1030, 1069, 1107,
+    1146, 1184, 1223, 1261, 1300, 1338, 1377, 1416, 1454, 1493,
+    1532, 1571, 1609, 1648, 1687, 1726, 1765, 1804, 1842, 1881,
+    1920, 1959, 1998, 2037, 2076, 2115, 2155, 2194, 2233, 2272,
+    2311, 2350, 2390, 2429, 2468, 2507, 2547, 2586, 2625, 2665,
+    2704, 2744, 2783, 2823, 2862, 2902, 2941, 2981, 3020, 3060,
+    3099, 3139, 3179, 3219, 3258, 3298, 3338, 3378, 3417, 3457,
+    3497, 3537, 3577, 3617, 3657, 3697, 3737, 3777, 3817, 3857
+};
+
+// 2^(n/12) in Q16 for n = -24..24 semitones
+static const uint32_t semitoneRatio[49] = {
+     16384,  17358,  18390,  19484,  20643,  21870,  23170,
+     24548,  26008,  27554,  29193,  30929,  32768,  34716,
+     36781,  38968,  41285,  43740,  46341,  49097,  52016,
+     55109,  58386,  61858,  65536,  69433,  73562,  77936,
+     82570,  87480,  92682,  98193, 104032, 110218, 116772,
+    123715, 131072, 138866, 147123, 155872, 165140, 174960,
+    185364, 196386, 208064, 220436, 233544, 247431, 262144
+};
+
+// Frequencies at or above Nyquist are clamped to just below it
+static uint32_t frequencyToPhaseInc(double frequency) {
+    double inc = (frequency * 4294967296.0) / sampleRate;
+    if (inc >= 2147483647.0) return 2147483647u;
+    if (inc <= 0) return 0;
+    return (uint32_t)inc;
+}
+
+static void buildNoteTable() {
+    for (int note = 0; note < 128; note++) {
+        notePhaseInc[note] = frequencyToPhaseInc(440.0 * pow(2.0, (note - 69) / 12.0));
+    }
+}
 
 inline int16_t squareWave(uint8_t phase) {
     return (phase < 128) ? 127 : -127;
@@ -62,264 +200,626 @@ inline int16_t fastSine(uint8_t phase) {
     return val;
 }
 
+// Current pitch of a modulated voice: swept base, arpeggio step, vibrato
+static uint32_t modulatedIncrement(const Oscillator &osc) {
+    uint64_t inc = osc.base_increment;
+    
+    if (osc.mod_flags & MOD_ARPEGGIO) {
+        inc = (inc * semitoneRatio[osc.arp_semitones[osc.arp_pos] + 24]) >> 16;
+    }
+    
+    if (osc.mod_flags & MOD_VIBRATO) {
+        int64_t swing = (int64_t)((inc * osc.vibrato_depth) >> 16);
+        inc += (swing * fastSine(osc.vibrato_phase >> 8)) >> 7;
+    }
+    
+    if (inc > 2147483647u) inc = 2147483647u;
+    return (uint32_t)inc;
+}
 
-// Rebuild active channel list (lock-free)
-static inline void rebuildActiveChannelList() {
-    uint8_t temp_indices[MAX_CHANNELS];
-    uint8_t temp_count = 0;
+// One control step, called by the mixer every MOD_RATE samples
+static void stepModulators(Oscillator &osc) {
+    uint8_t flags = osc.mod_flags;
     
-    for (int i = 0; i < MAX_CHANNELS; i++) {
-        if (oscillators[i].active || oscillators[i].scheduled) {
-            temp_indices[temp_count++] = i;
+    if (flags & (MOD_SWEEP_LINEAR | MOD_SWEEP_EXP)) {
+        uint32_t inc = osc.base_increment;
+        bool done;
+        if (flags & MOD_SWEEP_LINEAR) {
+            inc += osc.sweep_step;
+            done = osc.sweep_step > 0 ? inc >= osc.sweep_target : inc <= osc.sweep_target;
+        } else {
+            inc = (uint32_t)(((uint64_t)inc * osc.sweep_mul) >> 24);
+            done = osc.sweep_mul > (1u << 24) ? inc >= osc.sweep_target : inc <= osc.sweep_target;
+        }
+        
+        if (done) {
+            inc = osc.sweep_target;
+            if (flags & MOD_PINGPONG) {
+                osc.sweep_target = osc.sweep_origin;
+                osc.sweep_origin = inc;
+                osc.sweep_step = -osc.sweep_step;
+                uint32_t mul = osc.sweep_mul;
+                osc.sweep_mul = osc.sweep_mul_back;
+                osc.sweep_mul_back = mul;
+            } else {
+                // Hold the target for the rest of the tone
+                osc.mod_flags = flags & ~(MOD_SWEEP_LINEAR | MOD_SWEEP_EXP);
+            }
+        }
+        osc.base_increment = inc;
+    }
+    
+    if (flags & MOD_ARPEGGIO) {
+        if (++osc.arp_count >= osc.arp_ticks) {
+            osc.arp_count = 0;
+            if (++osc.arp_pos >= osc.arp_length) osc.arp_pos = 0;
+        }
+    }
+    
+    if (flags & MOD_VIBRATO) {
+        osc.vibrato_phase += osc.vibrato_rate;
+    }
+    
+    osc.phase_increment = modulatedIncrement(osc);
+}
+
+// Move a sample voice one clip sample on, false at the end of the clip
+static bool nextSample(Oscillator &osc) {
+    const AudioSample &s = *osc.sample;
+    SampleCursor &c = osc.cursor;
+    
+    if (osc.loop_end && c.index + 1 >= osc.loop_end) {
+        c = osc.loop_cursor;
+        return true;
+    }
+    if (c.index + 1 >= s.length) return false;
+    c.index++;
+    
+    if (s.format == SAMPLE_PCM8) {
+        c.value = (int16_t)((int8_t)s.data[c.index] * 256);
+    } else {
+        if (++c.block_pos >= adpcmSamplesPerBlock(s.block_size)) {
+            c.block += s.block_size;
+            c.block_pos = 0;
+            c.value = adpcmBlockStart(c.adpcm, c.block);
+        } else {
+            uint8_t byte = c.block[4 + (c.block_pos - 1) / 2];
+            c.value = adpcmDecode(c.adpcm, (c.block_pos - 1) & 1 ? byte >> 4 : byte & 15);
+        }
+    }
+    
+    if (osc.loop_end && c.index == s.loop_start) osc.loop_cursor = c;
+    return true;
+}
+
+static inline bool claimVoice(Oscillator &osc, uint8_t from) {
+    return __atomic_compare_exchange_n(&osc.state, &from, (uint8_t)VOICE_FREE, false,
+                                       __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+static inline void listAppend(VoiceList &list, int8_t v) {
+    voice_next[v] = -1;
+    voice_prev[v] = list.tail;
+    if (list.tail >= 0) voice_next[list.tail] = v;
+    else list.head = v;
+    list.tail = v;
+}
+    
+static inline void listUnlink(VoiceList &list, int8_t v) {
+    if (voice_prev[v] >= 0) voice_next[voice_prev[v]] = voice_next[v];
+    else list.head = voice_next[v];
+    if (voice_next[v] >= 0) voice_prev[voice_next[v]] = voice_prev[v];
+    else list.tail = voice_prev[v];
+}
+
+static inline void moveToFree(int8_t v) {
+    listUnlink(used_voices, v);
+    listAppend(free_voices, v);
+    voice_is_free[v] = true;
+}
+
+// After taking a voice from the mixer: a pass running now may have seen it
+// ACTIVE and still be reading it, one starting later sees it FREE. Spins for
+// at most one sample when the mixer is on the other core. With the mixer in
+// an interrupt on this core the pass is never caught half way.
+static void waitForMixer() {
+    audioHalBarrier();
+    uint32_t pass = render_pass;
+    if (pass & 1) {
+        while (render_pass == pass) {
+        }
+    }
+}
+
+// Take a voice back from the mixer (or cancel it while scheduled). When the
+// mixer got there first the voice is already FREE and its retire entry is on
+// the way, either way the voice is now stopped and the caller may reuse it.
+static inline void releaseVoice(int8_t v) {
+    Oscillator &osc = oscillators[v];
+    if (osc.state == VOICE_SCHEDULED) {
+        osc.state = VOICE_FREE;
+    } else if (osc.state == VOICE_ACTIVE) {
+        claimVoice(osc, VOICE_ACTIVE);
+        waitForMixer();
+    }
+}
+    
+static void drainRetiredVoices() {
+    uint8_t head = __atomic_load_n(&retire_head, __ATOMIC_ACQUIRE);
+    while (retire_tail != head) {
+        int8_t v = retire_ring[retire_tail % RETIRE_RING_SIZE];
+        retire_tail++;
+        if (oscillators[v].state == VOICE_FREE && !voice_is_free[v]) {
+            moveToFree(v);
         }
     }
+}
+
+// Pick a voice to steal for a sound of the given priority, never one with a
+// higher priority
+static int8_t pickVictim(uint8_t priority) {
+    int8_t victim = -1;
     
-    for (int i = 0; i < temp_count; i++) {
-        active_channel_indices[i] = temp_indices[i];
+    if (stealMode == STEAL_OLDEST) {
+        for (int8_t v = used_voices.head; v >= 0; v = voice_next[v]) {
+            if (oscillators[v].priority <= priority) return v;
+        }
+    } else if (stealMode == STEAL_QUIETEST) {
+        uint16_t quietest = UINT16_MAX;
+        for (int8_t v = used_voices.head; v >= 0; v = voice_next[v]) {
+            if (oscillators[v].priority <= priority && oscillators[v].amplitude < quietest) {
+                quietest = oscillators[v].amplitude;
+                victim = v;
+            }
+        }
     }
-    active_channel_count = temp_count;
+    
+    return victim;
 }
 
+// O(1) unless the pool is full and a voice has to be stolen
+static int8_t allocateVoice(uint8_t priority) {
+    drainRetiredVoices();
+    
+    int8_t v = free_voices.head;
+    if (v >= 0) {
+        listUnlink(free_voices, v);
+        voice_is_free[v] = false;
+        return v;
+    }
+    
+    v = pickVictim(priority);
+    if (v < 0) {
+        dropped_tones++;
+        return -1;
+    }
+    
+    stolen_voices++;
+    releaseVoice(v);
+    listUnlink(used_voices, v);
+    return v;
+}
 
-bool timerCallback_Piezo(struct repeating_timer *t) {
+// Mix one output sample, called by the hardware layer at the sample rate
+uint16_t audioRenderSample() {
     int32_t mixed_sample = 0;
     int active_count = 0;
     
+    render_pass++;
+    audioHalBarrier();
+    
     for (int i = 0; i < MAX_CHANNELS; i++) {
-        if (oscillators[i].active) {
-            oscillators[i].phase += oscillators[i].phase_increment;
-            oscillators[i].samples_played++;
+        Oscillator &osc = oscillators[i];
+        if (osc.state == VOICE_ACTIVE) {
+            uint32_t phase = osc.phase;
+            osc.phase += osc.phase_increment;
+            osc.samples_played++;
             
-            if (oscillators[i].duration_samples > 0 && 
-                oscillators[i].samples_played >= oscillators[i].duration_samples) {
-                oscillators[i].active = false;
-                oscillators[i].scheduled = false;
+            if (osc.mod_flags && (osc.samples_played & (MOD_RATE - 1)) == 0) {
+                stepModulators(osc);
+            }
+            
+            bool finished = osc.duration_samples > 0 &&
+                            osc.samples_played >= osc.duration_samples;
+            if (osc.sample) {
+                // Whole clip samples stepped over since the last output
+                uint32_t advance = phase >> 16;
+                osc.phase -= advance << 16;
+                while (advance-- > 0 && !finished) {
+                    finished = !nextSample(osc);
+                }
+            }
+            
+            if (finished) {
+                // Hand the voice back unless the main thread just took it
+                if (claimVoice(osc, VOICE_ACTIVE)) {
+                    uint8_t head = retire_head;
+                    retire_ring[head % RETIRE_RING_SIZE] = i;
+                    __atomic_store_n(&retire_head, (uint8_t)(head + 1), __ATOMIC_RELEASE);
+                }
             } else {
-                if (oscillators[i].amplitude > 0) {
-                    uint8_t phase_byte = oscillators[i].phase >> 24;
-                    // Use square wave directly - better for piezo with PWM
-                    int16_t wave = (phase_byte < 128) ? oscillators[i].amplitude : 0;
-                    mixed_sample += wave;
+                if (osc.amplitude > 0) {
+                    if (osc.sample) {
+                        // Clip swings 0..amplitude around the middle, like the square
+                        mixed_sample += (osc.amplitude * (uint32_t)(osc.cursor.value + 32768)) >> 16;
+                    } else if ((int32_t)osc.phase >= 0) {
+                        // Use square wave directly - better for piezo with PWM
+                        mixed_sample += osc.amplitude;
+                    }
                     active_count++;
                 }
             }
         }
     }
+    
+    // Done with the voices
+    audioHalBarrier();
+    render_pass++;
 
-    if (active_count > 0) {
-        // Average the mixed samples
-        mixed_sample /= active_count;
-        
-        mixed_sample = mixed_sample / 4;  
-        
-        // Clamp to valid range
-        if (mixed_sample < 0) mixed_sample = 0;
-        if (mixed_sample > 255) mixed_sample = 255;
-        
-        // Output via PWM - duty cycle represents volume
-        pwm_set_gpio_level(audioPinPiezo, (uint16_t)mixed_sample);
-    } else {
-        pwm_set_gpio_level(audioPinPiezo, 0);  // Complete silence
+#if MIXEDTONES_STATS
+    if (peak_restart) {
+        peak_restart = false;
+        peak_voices = 0;
+    }
+    if (active_count > peak_voices) peak_voices = active_count;
+#endif
+
+    if (active_count == 0) {
+        ditherError = 0;
+        return 0;  // Complete silence
     }
+
+    // Constant per-voice gain and master volume, so adding voices no longer
+    // makes the others quieter
+    int32_t bus = (mixed_sample * busGain) >> 8;
     
-    return true;
+    // Soft limiter: above the knee the overshoot is squeezed into the
+    // remaining headroom, the divide only happens when it is needed
+    if (bus > MIXEDTONES_LIMIT_KNEE) {
+        int32_t over = bus - MIXEDTONES_LIMIT_KNEE;
+        int32_t room = BUS_FULL_SCALE - MIXEDTONES_LIMIT_KNEE;
+        bus = MIXEDTONES_LIMIT_KNEE + (int32_t)(((int64_t)over * room) / (over + room));
+    }
+    
+#if MIXEDTONES_DITHER
+    // Error feedback: the bits dropped now are added to the next sample
+    bus += ditherError;
+    int32_t level = bus >> OUTPUT_SHIFT;
+    if (level > OUTPUT_MAX) level = OUTPUT_MAX;
+    ditherError = bus - (level << OUTPUT_SHIFT);
+#else
+    int32_t level = bus >> OUTPUT_SHIFT;
+#endif
+    
+    return (uint16_t)level;
 }
 
-void setupAudio(int32_t sample_rate, uint8_t pin_piezo, uint8_t pin_speaker_enable) 
+void setupAudio(int32_t sample_rate, uint8_t pin_piezo, uint8_t pin_speaker_enable, bool run_on_core1) 
 {
-    audioPinPiezo = pin_piezo;
     sampleRate = sample_rate;
-    speakerEnablePin = pin_speaker_enable;
-    
-    // Enable the amplifier
-    pinMode(speakerEnablePin, OUTPUT);
-    digitalWrite(speakerEnablePin, HIGH);
-    
-    // Configure GPIO 12 for PWM (it's PWM slice 6, channel A)
-    gpio_set_function(audioPinPiezo, GPIO_FUNC_PWM);
-    uint slice_num = pwm_gpio_to_slice_num(audioPinPiezo);
-    
-    // Configure PWM
-    pwm_config config = pwm_get_default_config();
-    
-    // CRITICAL: PWM frequency must be MUCH higher than sample rate
-    // Set PWM to run at a high carrier frequency (e.g., 150 kHz)
-    // System clock is 150 MHz
-    float clock_div = 150000000.0f / (150000.0f * 256);  // 150kHz carrier, 8-bit resolution
-    pwm_config_set_clkdiv(&config, clock_div);
-    pwm_config_set_wrap(&config, 255);  // 8-bit PWM (0-255)
-    
-    pwm_init(slice_num, &config, true);
-    pwm_set_gpio_level(audioPinPiezo, 0);  // Start silent
-    
-    Serial.print("PWM Audio setup - Pin: ");
-    Serial.print(audioPinPiezo);
-    Serial.print(" (PWM slice ");
-    Serial.print(slice_num);
-    Serial.print("), Sample rate: ");
-    Serial.print(sampleRate);
-    Serial.print(" Hz, PWM freq: ~150 kHz");
-    Serial.println();
-    
-    // Initialize oscillators
+    
+    // Initialize oscillators, all of them start on the free list
+    free_voices.head = free_voices.tail = -1;
+    used_voices.head = used_voices.tail = -1;
+    retire_head = retire_tail = 0;
     for (int i = 0; i < MAX_CHANNELS; i++) {
-        oscillators[i].active = false;
-        oscillators[i].scheduled = false;
+        oscillators[i].state = VOICE_FREE;
         oscillators[i].phase = 0;
         oscillators[i].amplitude = 0;
         oscillators[i].duration_samples = 0;
         oscillators[i].samples_played = 0;
         oscillators[i].start_time_ms = 0;
         oscillators[i].envelope = 0;
+        oscillators[i].priority = 0;
+        oscillators[i].mod_flags = 0;
+        oscillators[i].sample = 0;
+        listAppend(free_voices, i);
+        voice_is_free[i] = true;
     }
-
-    // Setup timer interrupt
-    int64_t interval_us = -1000000 / sampleRate;  
-    Serial.print("Attempting to set timer interval: ");
-    Serial.print(-interval_us);
-    Serial.println(" microseconds");
     
-    if (!add_repeating_timer_us(interval_us, timerCallback_Piezo, NULL, &audio_timer)) {
-        Serial.println("ERROR: Failed to setup timer!");
-        Serial.println("Sample rate may be too high for reliable interrupt timing");
-        timer_running = false;
-    } else {
-        timer_running = true;
-        Serial.print("Timer interrupt enabled successfully at ");
-        Serial.print(sampleRate);
-        Serial.println(" Hz");
-    }
+    buildNoteTable();
     
-    audioStartTime = millis();
+    audioHalBegin(sample_rate, pin_piezo, pin_speaker_enable, run_on_core1);
+    
+    audioStartTime = audioHalMillis();
 }
+
 uint8_t getMaxChannels() {
     return MAX_CHANNELS;
 }
 
 int8_t findFreeChannel() {
-    for (int i = 0; i < MAX_CHANNELS; i++) {
-        if (!oscillators[i].active && !oscillators[i].scheduled) {
-            return i;
-        }
-    }
-    return -1;
+    drainRetiredVoices();
+    return free_voices.head;
+}
+
+void setVoiceStealMode(VoiceSteal mode) {
+    stealMode = mode;
 }
 
 void updateAudio() {
-    uint32_t now = millis();
+    uint32_t now = audioHalMillis();
     
-    for (int i = 0; i < MAX_CHANNELS; i++) {
-        if (oscillators[i].scheduled && !oscillators[i].active) {
+    drainRetiredVoices();
+    
+    for (int8_t i = used_voices.head; i >= 0; i = voice_next[i]) {
+        if (oscillators[i].state == VOICE_SCHEDULED) {
             if (now >= oscillators[i].start_time_ms) {
                 oscillators[i].phase = 0;
                 oscillators[i].samples_played = 0;
                 oscillators[i].envelope = 0;
-                oscillators[i].active = true;
-                oscillators[i].scheduled = false;
+                audioHalBarrier();
+                oscillators[i].state = VOICE_ACTIVE;
             }
         }
     }
+}
+    
+// Program a voice the main thread owns and publish it to the mixer, which
+// may be running on the other core. Every field is written before the state
+// store makes the voice visible.
+static int8_t startVoice(int8_t channel, uint32_t phase_increment, uint8_t volume, uint32_t duration_samples, bool delayed, uint32_t delay_ms, uint8_t priority) {
+    Oscillator &osc = oscillators[channel];
+    
+    // mod_flags and the modulator state were set up by the caller
+    osc.base_increment = phase_increment;
+    osc.phase_increment = osc.mod_flags ? modulatedIncrement(osc) : phase_increment;
+    osc.amplitude = volume;
+    osc.priority = priority;
+    osc.duration_samples = duration_samples;
+    
+    osc.phase = 0;
+    osc.samples_played = 0;
+    osc.envelope = 0;
+    
+    listAppend(used_voices, channel);
+    
+    if (delayed) {
+        osc.start_time_ms = audioHalMillis() + delay_ms;
+        audioHalBarrier();
+        osc.state = VOICE_SCHEDULED;
+    } else {
+        osc.start_time_ms = 0;
+        audioHalBarrier();
+        osc.state = VOICE_ACTIVE;
+    }
     
-    rebuildActiveChannelList();
+    return channel;
 }
 
-int8_t playTone(float frequency, uint8_t volume, float duration_sec, float delay_sec) {
-    int8_t channel = findFreeChannel();
-    if (channel < 0) return -1;
+// Make a specific channel available for reuse, wherever it currently is
+static void takeChannel(uint8_t channel) {
+    drainRetiredVoices();
+    if (voice_is_free[channel]) {
+        listUnlink(free_voices, channel);
+        voice_is_free[channel] = false;
+    } else {
+        releaseVoice(channel);
+        listUnlink(used_voices, channel);
+    }
+}
     
-    oscillators[channel].phase_increment = (uint32_t)((frequency * 4294967296.0) / sampleRate);
-    oscillators[channel].amplitude = volume;
+// Convert a ToneMod into per-voice modulator state. Floating point happens
+// here once per call, the mixer only does integer steps.
+static void setupModulators(Oscillator &osc, uint32_t base_inc, const ToneMod *mod) {
+    uint8_t flags = 0;
+    
+    if (mod && mod->sweep_to > 0 && mod->sweep_time > 0) {
+        uint32_t target = frequencyToPhaseInc(mod->sweep_to);
+        uint32_t ticks = (uint32_t)(mod->sweep_time * sampleRate / MOD_RATE);
+        if (ticks < 1) ticks = 1;
+        
+        osc.sweep_origin = base_inc;
+        osc.sweep_target = target;
+        if (mod->sweep_exponential && base_inc > 0) {
+            double ratio = pow((double)target / base_inc, 1.0 / ticks);
+            osc.sweep_mul = (uint32_t)(ratio * 16777216.0 + 0.5);
+            osc.sweep_mul_back = (uint32_t)(16777216.0 / ratio + 0.5);
+            // Very slow sweeps must still move
+            if (osc.sweep_mul == (1u << 24) && target != base_inc) {
+                osc.sweep_mul += target > base_inc ? 1 : -1;
+                osc.sweep_mul_back -= target > base_inc ? 1 : -1;
+            }
+            flags |= MOD_SWEEP_EXP;
+        } else {
+            osc.sweep_step = (int32_t)(((int64_t)target - base_inc) / ticks);
+            if (osc.sweep_step == 0 && target != base_inc) {
+                osc.sweep_step = target > base_inc ? 1 : -1;
+            }
+            flags |= MOD_SWEEP_LINEAR;
+        }
+        if (mod->sweep_pingpong) flags |= MOD_PINGPONG;
+    }
     
+    if (mod && mod->vibrato_rate > 0 && mod->vibrato_depth > 0) {
+        float rate = mod->vibrato_rate * 65536.0f * MOD_RATE / sampleRate;
+        osc.vibrato_rate = rate > 65535.0f ? 65535 : (uint16_t)rate;
+        osc.vibrato_depth = (uint16_t)((pow(2.0, mod->vibrato_depth / 1200.0) - 1.0) * 65536.0);
+        osc.vibrato_phase = 0;
+        flags |= MOD_VIBRATO;
+    }
+    
+    if (mod && mod->arpeggio && mod->arpeggio_length > 0) {
+        osc.arp_length = mod->arpeggio_length > MOD_ARP_MAX ? MOD_ARP_MAX : mod->arpeggio_length;
+        for (uint8_t i = 0; i < osc.arp_length; i++) {
+            int8_t semis = mod->arpeggio[i];
+            if (semis < -24) semis = -24;
+            if (semis > 24) semis = 24;
+            osc.arp_semitones[i] = semis;
+        }
+        float ticks = mod->arpeggio_step * sampleRate / MOD_RATE;
+        osc.arp_ticks = ticks < 1.0f ? 1 : (ticks > 65535.0f ? 65535 : (uint16_t)ticks);
+        osc.arp_pos = 0;
+        osc.arp_count = 0;
+        flags |= MOD_ARPEGGIO;
+    }
+    
+    osc.mod_flags = flags;
+}
+
+static int8_t startTone(int8_t channel, float frequency, uint8_t volume, float duration_sec, float delay_sec, uint8_t priority, const ToneMod *mod = 0) {
+    uint32_t duration_samples = 0;
     if (duration_sec > 0) {
-        oscillators[channel].duration_samples = (uint32_t)(sampleRate * duration_sec);
-    } else {
-        oscillators[channel].duration_samples = 0;
+        duration_samples = (uint32_t)(sampleRate * duration_sec);
     }
     
-    if (delay_sec > 0) {
-        oscillators[channel].start_time_ms = millis() + (uint32_t)(delay_sec * 1000);
-        oscillators[channel].scheduled = true;
-        oscillators[channel].active = false;
-        oscillators[channel].phase = 0;
-        oscillators[channel].samples_played = 0;
-    } else {
-        oscillators[channel].start_time_ms = 0;
-        oscillators[channel].scheduled = false;
-        oscillators[channel].active = true;
-        oscillators[channel].phase = 0;
-        oscillators[channel].samples_played = 0;
+    uint32_t inc = frequencyToPhaseInc(frequency);
+    setupModulators(oscillators[channel], inc, mod);
+    oscillators[channel].sample = 0;
+    return startVoice(channel, inc, volume, duration_samples,
+                      delay_sec > 0, (uint32_t)(delay_sec * 1000), priority);
+}
+
+int8_t playTone(float frequency, uint8_t volume, float duration_sec, float delay_sec, uint8_t priority) {
+    int8_t channel = allocateVoice(priority);
+    if (channel < 0) return -1;
+    
+    return startTone(channel, frequency, volume, duration_sec, delay_sec, priority);
+}
+
+int8_t playToneOnChannel(uint8_t channel, float frequency, uint8_t volume, float duration_sec, float delay_sec, uint8_t priority) {
+    if (channel >= MAX_CHANNELS) return -1;
+    
+    takeChannel(channel);
+    return startTone(channel, frequency, volume, duration_sec, delay_sec, priority);
+}
+
+int8_t playToneMod(float frequency, uint8_t volume, const ToneMod &mod, float duration_sec, float delay_sec, uint8_t priority) {
+    int8_t channel = allocateVoice(priority);
+    if (channel < 0) return -1;
+    
+    return startTone(channel, frequency, volume, duration_sec, delay_sec, priority, &mod);
+}
+
+int8_t playToneModOnChannel(uint8_t channel, float frequency, uint8_t volume, const ToneMod &mod, float duration_sec, float delay_sec, uint8_t priority) {
+    if (channel >= MAX_CHANNELS) return -1;
+    
+    takeChannel(channel);
+    return startTone(channel, frequency, volume, duration_sec, delay_sec, priority, &mod);
+}
+
+uint32_t notePhaseIncrement(uint8_t note, int8_t cents) {
+    // Fold whole semitones of the offset into the note
+    int32_t total = (int32_t)note * 100 + cents;
+    if (total < 0) total = 0;
+    int32_t n = total / 100;
+    int32_t c = total % 100;
+    if (n > 127) {
+        n = 127;
+        c = 0;
     }
     
-    oscillators[channel].envelope = 0;
-    rebuildActiveChannelList();
+    uint32_t inc = notePhaseInc[n];
+    return inc + (uint32_t)(((uint64_t)inc * centsFraction[c]) >> 16);
+}
+
+uint32_t audioMsToSamples(uint32_t ms) {
+    return (uint32_t)(((uint64_t)ms * sampleRate) / 1000);
+}
+
+static int8_t startNote(int8_t channel, uint8_t note, int8_t cents, uint8_t volume, uint32_t duration_samples, uint32_t delay_samples, uint8_t priority) {
+    uint32_t delay_ms = (uint32_t)(((uint64_t)delay_samples * 1000) / sampleRate);
+    oscillators[channel].mod_flags = 0;
+    oscillators[channel].sample = 0;
+    return startVoice(channel, notePhaseIncrement(note, cents), volume, duration_samples,
+                      delay_samples > 0, delay_ms, priority);
+}
+
+int8_t playNote(uint8_t note, int8_t cents, uint8_t volume, uint32_t duration_samples, uint32_t delay_samples, uint8_t priority) {
+    int8_t channel = allocateVoice(priority);
+    if (channel < 0) return -1;
     
-    return channel;
+    return startNote(channel, note, cents, volume, duration_samples, delay_samples, priority);
 }
 
-int8_t playToneOnChannel(uint8_t channel, float frequency, uint8_t volume, float duration_sec, float delay_sec) {
+int8_t playNoteOnChannel(uint8_t channel, uint8_t note, int8_t cents, uint8_t volume, uint32_t duration_samples, uint32_t delay_samples, uint8_t priority) {
     if (channel >= MAX_CHANNELS) return -1;
     
-    oscillators[channel].phase_increment = (uint32_t)((frequency * 4294967296.0) / sampleRate);
-    oscillators[channel].amplitude = volume;
+    takeChannel(channel);
+    return startNote(channel, note, cents, volume, duration_samples, delay_samples, priority);
+}
+
+static int8_t startSample(int8_t channel, const AudioSample &sample, uint8_t volume, float pitch, bool loop, float delay_sec, uint8_t priority) {
+    Oscillator &osc = oscillators[channel];
+    osc.mod_flags = 0;
+    osc.sample = &sample;
     
-    if (duration_sec > 0) {
-        oscillators[channel].duration_samples = (uint32_t)(sampleRate * duration_sec);
-    } else {
-        oscillators[channel].duration_samples = 0;
+    osc.loop_end = 0;
+    if (loop) {
+        uint32_t end = sample.loop_end ? sample.loop_end : sample.length;
+        if (end > sample.length) end = sample.length;
+        if (sample.loop_start < end) osc.loop_end = end;
     }
     
-    if (delay_sec > 0) {
-        oscillators[channel].start_time_ms = millis() + (uint32_t)(delay_sec * 1000);
-        oscillators[channel].scheduled = true;
-        oscillators[channel].active = false;
-        oscillators[channel].phase = 0;
-        oscillators[channel].samples_played = 0;
+    SampleCursor &c = osc.cursor;
+    c.index = 0;
+    c.block = sample.data;
+    c.block_pos = 0;
+    if (sample.format == SAMPLE_PCM8) {
+        c.value = (int16_t)((int8_t)sample.data[0] * 256);
     } else {
-        oscillators[channel].start_time_ms = 0;
-        oscillators[channel].scheduled = false;
-        oscillators[channel].active = true;
-        oscillators[channel].phase = 0;
-        oscillators[channel].samples_played = 0;
+        c.value = adpcmBlockStart(c.adpcm, sample.data);
     }
+    if (osc.loop_end && sample.loop_start == 0) osc.loop_cursor = c;
     
-    oscillators[channel].envelope = 0;
-    rebuildActiveChannelList();
+    // Clip samples per output sample in Q16
+    double step = (double)pitch * sample.sample_rate / sampleRate * 65536.0;
+    if (step > SAMPLE_MAX_STEP * 65536.0) step = SAMPLE_MAX_STEP * 65536.0;
+    if (step < 0) step = 0;
     
-    return channel;
+    return startVoice(channel, (uint32_t)step, volume, 0,
+                      delay_sec > 0, (uint32_t)(delay_sec * 1000), priority);
+}
+
+int8_t playSample(const AudioSample &sample, uint8_t volume, float pitch, bool loop, float delay_sec, uint8_t priority) {
+    if (!sample.data || sample.length == 0) return -1;
+    
+    int8_t channel = allocateVoice(priority);
+    if (channel < 0) return -1;
+    
+    return startSample(channel, sample, volume, pitch, loop, delay_sec, priority);
+}
+
+int8_t playSampleOnChannel(uint8_t channel, const AudioSample &sample, uint8_t volume, float pitch, bool loop, float delay_sec, uint8_t priority) {
+    if (channel >= MAX_CHANNELS || !sample.data || sample.length == 0) return -1;
+    
+    takeChannel(channel);
+    return startSample(channel, sample, volume, pitch, loop, delay_sec, priority);
 }
 
 void cancelScheduled(int8_t channel) {
-    if (channel >= 0 && channel < MAX_CHANNELS) {
-        oscillators[channel].scheduled = false;
-        oscillators[channel].active = false;
+    if (channel >= 0 && channel < MAX_CHANNELS && !voice_is_free[channel]) {
+        releaseVoice(channel);
+        moveToFree(channel);
     }
 }
 
 void stopChannel(int8_t channel) {
-    if (channel >= 0 && channel < MAX_CHANNELS) {
-        oscillators[channel].active = false;
-        oscillators[channel].scheduled = false;
+    if (channel >= 0 && channel < MAX_CHANNELS && !voice_is_free[channel]) {
+        releaseVoice(channel);
         oscillators[channel].amplitude = 0;
+        moveToFree(channel);
     }
 }
 
 void stopAllTones() {
-    for (int i = 0; i < MAX_CHANNELS; i++) {
-        oscillators[i].active = false;
-        oscillators[i].scheduled = false;
-        oscillators[i].amplitude = 0;
+    while (used_voices.head >= 0) {
+        int8_t v = used_voices.head;
+        releaseVoice(v);
+        oscillators[v].amplitude = 0;
+        moveToFree(v);
     }
 }
 
 bool isChannelActive(int8_t channel) {
     if (channel < 0 || channel >= MAX_CHANNELS) return false;
-    return oscillators[channel].active || oscillators[channel].scheduled;
+    return oscillators[channel].state != VOICE_FREE;
 }
 
 uint8_t getActiveChannelCount() {
     uint8_t count = 0;
     for (int i = 0; i < MAX_CHANNELS; i++) {
-        if (oscillators[i].active || oscillators[i].scheduled) count++;
+        if (oscillators[i].state != VOICE_FREE) count++;
     }
     return count;
 }
@@ -327,11 +827,43 @@ uint8_t getActiveChannelCount() {
 uint8_t getPlayingChannelCount() {
     uint8_t count = 0;
     for (int i = 0; i < MAX_CHANNELS; i++) {
-        if (oscillators[i].active) count++;
+        if (oscillators[i].state == VOICE_ACTIVE) count++;
     }
     return count;
 }
 
+void setMasterVolume(uint8_t volume) {
+    masterVolume = volume;
+    // 255 maps to unity (256)
+    busGain = MIXEDTONES_VOICE_GAIN * (volume + (volume >> 7));
+}
+
+uint8_t getMasterVolume() {
+    return masterVolume;
+}
+
+uint16_t getAudioOutputMax() {
+    return OUTPUT_MAX;
+}
+
 uint32_t getAudioStartTime() {
     return audioStartTime;
 }
+
+bool isAudioOnCore1() {
+    return audioHalOnCore1();
+}
+
+void getAudioStats(AudioStats &stats) {
+    audioHalGetStats(stats);
+    stats.peak_voices = peak_voices;
+    stats.dropped_tones = dropped_tones;
+    stats.stolen_voices = stolen_voices;
+}
+
+void resetAudioStats() {
+    audioHalResetStats();
+    peak_restart = true;
+    dropped_tones = 0;
+    stolen_voices = 0;
+}
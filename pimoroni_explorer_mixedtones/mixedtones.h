@@ -6,16 +6,78 @@
 #include <stdint.h>
 
 // Setup functions
-void setupAudio(int32_t sample_rate, uint8_t pin_piezo, uint8_t pin_speaker_enable);
+// run_on_core1 launches the mixer on core1 driven by its own hardware alarm,
+// keeping it clear of core0 work. Core1 must not be used by the sketch
+// (no setup1()/loop1()) when this is enabled.
+void setupAudio(int32_t sample_rate, uint8_t pin_piezo, uint8_t pin_speaker_enable, bool run_on_core1 = false);
 
 // Core functions
 void updateAudio();
-int8_t playTone(float frequency, uint8_t volume, float duration_sec = 0, float delay_sec = 0);
-int8_t playToneOnChannel(uint8_t channel, float frequency, uint8_t volume, float duration_sec = 0, float delay_sec = 0);
+// When every voice is busy, playTone steals one with the same or a lower
+// priority (see setVoiceStealMode) instead of dropping the new sound
+int8_t playTone(float frequency, uint8_t volume, float duration_sec = 0, float delay_sec = 0, uint8_t priority = 0);
+int8_t playToneOnChannel(uint8_t channel, float frequency, uint8_t volume, float duration_sec = 0, float delay_sec = 0, uint8_t priority = 0);
+// Integer note API: MIDI note number (69 = A4 440 Hz) plus a cents offset,
+// durations and delays in samples (see audioMsToSamples). Phase increments
+// come from a table built in setupAudio(), no floating point per call.
+int8_t playNote(uint8_t note, int8_t cents, uint8_t volume, uint32_t duration_samples = 0, uint32_t delay_samples = 0, uint8_t priority = 0);
+int8_t playNoteOnChannel(uint8_t channel, uint8_t note, int8_t cents, uint8_t volume, uint32_t duration_samples = 0, uint32_t delay_samples = 0, uint8_t priority = 0);
+uint32_t notePhaseIncrement(uint8_t note, int8_t cents = 0);
+
+// Sample clips. Keep the data and the AudioSample itself as const globals so
+// they stay in flash; the voice reads them while it plays. WAV files can be
+// converted with host/mixedtones_sampleconv.
+enum SampleFormat : uint8_t {
+    SAMPLE_PCM8,       // signed 8 bit
+    SAMPLE_IMA_ADPCM   // 4 bit IMA-ADPCM blocks, see mixedtones_adpcm.h
+};
+struct AudioSample {
+    const uint8_t *data;
+    uint32_t length;       // in samples
+    uint32_t sample_rate;
+    uint32_t loop_start;   // loop region in samples, loop_end 0 = whole clip
+    uint32_t loop_end;
+    uint16_t block_size;   // ADPCM bytes per block
+    SampleFormat format;
+};
+// pitch 1.0 plays at the clip's own rate, 2.0 an octave up. A looping clip
+// plays until it is stopped.
+int8_t playSample(const AudioSample &sample, uint8_t volume, float pitch = 1.0f, bool loop = false, float delay_sec = 0, uint8_t priority = 0);
+int8_t playSampleOnChannel(uint8_t channel, const AudioSample &sample, uint8_t volume, float pitch = 1.0f, bool loop = false, float delay_sec = 0, uint8_t priority = 0);
+
+// Pitch modulators, run by the mixer on a single voice. Leave a field at 0
+// to switch that modulator off. A whole siren or power-up is one call.
+struct ToneMod {
+    float sweep_to = 0;              // slide the pitch to this frequency (Hz)
+    float sweep_time = 0;            // ... in this many seconds
+    bool sweep_exponential = false;  // equal ratio per step instead of equal Hz
+    bool sweep_pingpong = false;     // keep sliding back and forth (sirens)
+    float vibrato_rate = 0;          // LFO speed in Hz
+    uint8_t vibrato_depth = 0;       // LFO swing in cents
+    const int8_t *arpeggio = 0;      // semitone offsets, played in a loop
+    uint8_t arpeggio_length = 0;     // up to 8 steps, offsets -24..24
+    float arpeggio_step = 0;         // seconds per step
+};
+int8_t playToneMod(float frequency, uint8_t volume, const ToneMod &mod, float duration_sec = 0, float delay_sec = 0, uint8_t priority = 0);
+int8_t playToneModOnChannel(uint8_t channel, float frequency, uint8_t volume, const ToneMod &mod, float duration_sec = 0, float delay_sec = 0, uint8_t priority = 0);
+uint32_t audioMsToSamples(uint32_t ms);
 void stopChannel(int8_t channel);
 void stopAllTones();
 void cancelScheduled(int8_t channel);
 
+// Voice stealing when the pool (MIXEDTONES_MAX_VOICES) is full
+enum VoiceSteal {
+    STEAL_NONE,      // drop the new sound, playTone returns -1
+    STEAL_OLDEST,    // replace the longest playing voice (default)
+    STEAL_QUIETEST   // replace the voice with the lowest volume
+};
+void setVoiceStealMode(VoiceSteal mode);
+
+// Mix bus - every voice plays at the same gain, the master volume scales the
+// whole mix (255 = unity) before the soft limiter
+void setMasterVolume(uint8_t volume);
+uint8_t getMasterVolume();
+
 // Query functions
 uint8_t getMaxChannels();
 int8_t findFreeChannel();
@@ -23,5 +85,23 @@ bool isChannelActive(int8_t channel);
 uint8_t getActiveChannelCount();
 uint8_t getPlayingChannelCount();
 uint32_t getAudioStartTime();
+uint16_t getAudioOutputMax();
+bool isAudioOnCore1();
+
+// Mixer instrumentation since the last reset (MIXEDTONES_STATS)
+struct AudioStats {
+    uint32_t callbacks;       // samples rendered
+    uint32_t avg_cycles;      // CPU cycles per sample callback, average
+    uint32_t max_cycles;      // ... and worst case
+    uint32_t cycle_budget;    // cycles available per sample period
+    uint32_t late_periods;    // callbacks that came a period or more late
+    uint32_t missed_periods;  // sample periods lost to those late callbacks
+    uint32_t max_jitter_us;   // worst deviation from the nominal period
+    uint8_t peak_voices;      // most voices sounding in one sample
+    uint32_t dropped_tones;   // play requests that got no voice
+    uint32_t stolen_voices;   // voices taken over by voice stealing
+};
+void getAudioStats(AudioStats &stats);
+void resetAudioStats();
 
 #endif
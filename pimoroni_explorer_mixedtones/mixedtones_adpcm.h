@@ -0,0 +1,147 @@
+//this files has been generated with the help of claude.ai
+
+#ifndef MIXEDTONES_ADPCM_H
+#define MIXEDTONES_ADPCM_H
+
+#include <stdint.h>
+
+// IMA-ADPCM as used in WAV files: blocks start with a 4 byte header (first
+// sample as int16, step index, reserved byte) followed by 4 bit codes, low
+// nibble first. Shared by the mixer and the host converter so both decode
+// exactly the same way.
+
+static const int16_t adpcmStepTable[89] = {
+        7,     8,     9,    10,    11,    12,    13,    14,    16,    17,
+       19,    21,    23,    25,    28,    31,    34,    37,    41,    45,
+       50,    55,    60,    66,    73,    80,    88,    97,   107,   118,
+      130,   143,   157,   173,   190,   209,   230,   253,   279,   307,
+      337,   371,   408,   449,   494,   544,   598,   658,   724,   796,
+      876,   963,  1060,  1166,  1282,  1411,  1552,  1707,  1878,  2066,
+     2272,  2499,  2749,  3024,  3327,  3660,  4026,  4428,  4871,  5358,
+     5894,  6484,  7132,  7845,  8630,  9493, 10442, 11487, 12635, 13899,
+    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+static const int8_t adpcmIndexTable[16] = {
+    -1, -1, -1, -1, 2, 4, 6, 8,
+    -1, -1, -1, -1, 2, 4, 6, 8
+};
+
+struct AdpcmState {
+    int16_t predictor;
+    uint8_t index;
+};
+
+// Samples held by one block: the header sample plus two per data byte
+static inline uint32_t adpcmSamplesPerBlock(uint16_t block_size) {
+    return 1 + (uint32_t)(block_size - 4) * 2;
+}
+
+// Start of a block: the header holds the first sample and the step index
+static inline int16_t adpcmBlockStart(AdpcmState &st, const uint8_t *block) {
+    st.predictor = (int16_t)(block[0] | (block[1] << 8));
+    st.index = block[2] > 88 ? 88 : block[2];
+    return st.predictor;
+}
+
+static inline int16_t adpcmDecode(AdpcmState &st, uint8_t code) {
+    int32_t step = adpcmStepTable[st.index];
+    int32_t diff = step >> 3;
+    if (code & 4) diff += step;
+    if (code & 2) diff += step >> 1;
+    if (code & 1) diff += step >> 2;
+    
+    int32_t pred = st.predictor + ((code & 8) ? -diff : diff);
+    if (pred > 32767) pred = 32767;
+    if (pred < -32768) pred = -32768;
+    st.predictor = (int16_t)pred;
+    
+    int32_t index = st.index + adpcmIndexTable[code & 15];
+    if (index < 0) index = 0;
+    if (index > 88) index = 88;
+    st.index = (uint8_t)index;
+    return st.predictor;
+}
+
+// Pick the code that gets closest to sample, and advance the state the same
+// way the decoder will
+static inline uint8_t adpcmEncode(AdpcmState &st, int16_t sample) {
+    int32_t step = adpcmStepTable[st.index];
+    int32_t diff = sample - st.predictor;
+    uint8_t code = 0;
+    if (diff < 0) {
+        code = 8;
+        diff = -diff;
+    }
+    if (diff >= step) {
+        code |= 4;
+        diff -= step;
+    }
+    if (diff >= step >> 1) {
+        code |= 2;
+        diff -= step >> 1;
+    }
+    if (diff >= step >> 2) {
+        code |= 1;
+    }
+    adpcmDecode(st, code);
+    return code;
+}
+
+// Bytes needed to encode count samples
+static inline uint32_t adpcmEncodedSize(uint32_t count, uint16_t block_size) {
+    uint32_t per_block = adpcmSamplesPerBlock(block_size);
+    return (count + per_block - 1) / per_block * block_size;
+}
+
+static inline uint64_t adpcmBlockError(const int16_t *pcm, uint32_t count, uint32_t per_block, uint8_t index) {
+    AdpcmState st = { pcm[0], index };
+    uint64_t error = 0;
+    for (uint32_t k = 1; k < per_block && k < count; k++) {
+        adpcmEncode(st, pcm[k]);
+        int64_t e = st.predictor - pcm[k];
+        error += (uint64_t)(e * e);
+    }
+    return error;
+}
+
+// Encode count samples into blocks of block_size bytes, out must hold
+// adpcmEncodedSize() bytes. The tail of the last block repeats the last
+// value. Every block starts from the step index that encodes it best, so
+// attacks are not smeared while the step size catches up. Returns the
+// number of bytes written.
+static inline uint32_t adpcmEncodeBlocks(const int16_t *pcm, uint32_t count, uint16_t block_size, uint8_t *out) {
+    uint32_t per_block = adpcmSamplesPerBlock(block_size);
+    uint32_t written = 0;
+    
+    for (uint32_t first = 0; first < count; first += per_block) {
+        uint8_t best = 0;
+        uint64_t best_error = UINT64_MAX;
+        for (uint8_t index = 0; index <= 88; index++) {
+            uint64_t error = adpcmBlockError(pcm + first, count - first, per_block, index);
+            if (error < best_error) {
+                best_error = error;
+                best = index;
+            }
+        }
+        
+        uint8_t *block = out + written;
+        AdpcmState st = { pcm[first], best };
+        block[0] = (uint8_t)(st.predictor & 0xFF);
+        block[1] = (uint8_t)((uint16_t)st.predictor >> 8);
+        block[2] = st.index;
+        block[3] = 0;
+        
+        for (uint32_t k = 1; k < per_block; k++) {
+            uint32_t n = first + k;
+            uint8_t code = adpcmEncode(st, n < count ? pcm[n] : pcm[count - 1]);
+            uint8_t &byte = block[4 + (k - 1) / 2];
+            if ((k - 1) & 1) byte |= (uint8_t)(code << 4);
+            else byte = code;
+        }
+        written += block_size;
+    }
+    return written;
+}
+
+#endif
@@ -0,0 +1,52 @@
+//this files has been generated with the help of claude.ai
+
+#ifndef MIXEDTONES_CONFIG_H
+#define MIXEDTONES_CONFIG_H
+
+// Compile-time settings for mixedtones. Edit here, or override with -D on
+// host builds.
+
+// Size of the voice pool (1-127). Every voice costs RAM and mixer time, so
+// builds that only need a few simultaneous tones can lower this.
+#ifndef MIXEDTONES_MAX_VOICES
+#define MIXEDTONES_MAX_VOICES 64
+#endif
+
+// PWM output resolution in bits (8-12). Above 8 bits the PWM runs at the full
+// system clock and the carrier frequency drops (10 bits ~146 kHz, 12 bits
+// ~37 kHz).
+#ifndef MIXEDTONES_PWM_BITS
+#define MIXEDTONES_PWM_BITS 8
+#endif
+
+// Error-feedback dithering when the 16 bit mix bus is reduced to the PWM
+// resolution. Costs a couple of instructions per sample.
+#ifndef MIXEDTONES_DITHER
+#define MIXEDTONES_DITHER 1
+#endif
+
+// Constant gain of every voice on the mix bus, Q8. 64 (1/4) puts a single
+// voice at the same level the old averaging mixer did.
+#ifndef MIXEDTONES_VOICE_GAIN
+#define MIXEDTONES_VOICE_GAIN 64
+#endif
+
+// Soft limiter knee on the 16 bit bus. Above it the level is compressed
+// towards full scale instead of clipping.
+#ifndef MIXEDTONES_LIMIT_KNEE
+#define MIXEDTONES_LIMIT_KNEE 49152
+#endif
+
+// Pitch modulators (sweep, vibrato, arpeggio) are updated once every this
+// many samples instead of every sample. Must be a power of two.
+#ifndef MIXEDTONES_MOD_RATE
+#define MIXEDTONES_MOD_RATE 32
+#endif
+
+// Mixer instrumentation: cycles per sample, late/missed timer periods, peak
+// voices, dropped and stolen tones (see getAudioStats)
+#ifndef MIXEDTONES_STATS
+#define MIXEDTONES_STATS 1
+#endif
+
+#endif
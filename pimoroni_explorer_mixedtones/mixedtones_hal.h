@@ -0,0 +1,31 @@
+//this files has been generated with the help of claude.ai
+
+#ifndef MIXEDTONES_HAL_H
+#define MIXEDTONES_HAL_H
+
+#include <stdint.h>
+#include "mixedtones.h"
+
+// Hardware layer used by the mixer engine in mixedtones.cpp. The RP2350 port
+// lives in mixedtones_rp2350.cpp, host builds provide their own (see host/).
+
+// Start output and call audioRenderSample() once per sample from then on
+bool audioHalBegin(int32_t sample_rate, uint8_t pin_piezo, uint8_t pin_speaker_enable, bool run_on_core1);
+uint32_t audioHalMillis();
+bool audioHalOnCore1();
+// Timing part of AudioStats: cycles, late/missed periods, jitter
+void audioHalGetStats(AudioStats &stats);
+void audioHalResetStats();
+
+// Provided by the engine: mix the next sample, returns the output level
+uint16_t audioRenderSample();
+
+// Orders voice setup against the mixer, which may run on the other core
+#if defined(ARDUINO_ARCH_RP2040)
+#include <hardware/sync.h>
+static inline void audioHalBarrier() { __dmb(); }
+#else
+static inline void audioHalBarrier() { __atomic_thread_fence(__ATOMIC_SEQ_CST); }
+#endif
+
+#endif
@@ -0,0 +1,276 @@
+//this files has been generated with the help of claude.ai
+
+// RP2350 / arduino-pico port of the mixedtones hardware layer: PWM output,
+// sample timer (core0 repeating timer or core1 hardware alarm)
+
+#if defined(ARDUINO_ARCH_RP2040)
+
+#include <stdint.h>
+#include <Arduino.h>
+#include <hardware/timer.h>
+#include <hardware/pwm.h>
+#include <hardware/sync.h>
+#include <pico/time.h>
+#include <pico/multicore.h>
+#include <hardware/clocks.h>
+#include <hardware/structs/m33.h>
+#include "mixedtones_config.h"
+#include "mixedtones_hal.h"
+
+// Configuration
+static uint8_t audioPinPiezo = 12;
+static uint8_t speakerEnablePin = 13;
+static int32_t halSampleRate = 11025;
+
+static struct repeating_timer audio_timer;
+static volatile bool timer_running = false;
+
+// Core1 mode: dedicated hardware alarm, period kept in 1/65536 us so the
+// average sample rate is exact even though the timer ticks in whole us
+static bool audio_on_core1 = false;
+static int audio_alarm_num = -1;
+static uint64_t alarm_target_fx = 0;
+
+// Timing statistics, kept by the sample interrupt. Resets are only
+// requested from outside and carried out by the interrupt itself.
+static uint32_t audio_period_fx = 0;
+static uint32_t jitter_last_us = 0;
+static volatile uint32_t jitter_max_us = 0;
+static volatile uint32_t late_periods = 0;
+static volatile uint32_t missed_periods = 0;
+static volatile uint32_t stat_callbacks = 0;
+static volatile uint64_t cycle_sum = 0;
+static volatile uint32_t cycle_seq = 0;  // odd while the two above change
+static volatile uint32_t cycle_max = 0;
+static volatile bool stats_restart = true;
+
+// Cycle counter of the core running the mixer (each core has its own DWT)
+static inline void enableCycleCounter() {
+    m33_hw->demcr |= M33_DEMCR_TRCENA_BITS;
+    m33_hw->dwt_ctrl |= M33_DWT_CTRL_CYCCNTENA_BITS;
+}
+
+static inline uint32_t readCycleCounter() {
+    return m33_hw->dwt_cyccnt;
+}
+
+static inline void measureTiming() {
+    uint32_t now = time_us_32();
+    if (stats_restart) {
+        stats_restart = false;
+        jitter_max_us = 0;
+        late_periods = 0;
+        missed_periods = 0;
+        cycle_seq++;
+        __dmb();
+        stat_callbacks = 0;
+        cycle_sum = 0;
+        __dmb();
+        cycle_seq++;
+        cycle_max = 0;
+    } else {
+        int64_t interval_fx = (int64_t)(now - jitter_last_us) << 16;
+        int64_t diff = interval_fx - audio_period_fx;
+        if (diff < 0) diff = -diff;
+        uint32_t jitter = (uint32_t)((diff + 0x8000) >> 16);
+        if (jitter > jitter_max_us) jitter_max_us = jitter;
+        
+        // Half a period or more late means at least one sample slot was lost
+        uint32_t periods = (uint32_t)((interval_fx + audio_period_fx / 2) / audio_period_fx);
+        if (periods > 1) {
+            late_periods++;
+            missed_periods += periods - 1;
+        }
+    }
+    jitter_last_us = now;
+}
+
+static inline void recordCycles(uint32_t cycles) {
+    cycle_seq++;
+    __dmb();
+    stat_callbacks++;
+    cycle_sum += cycles;
+    __dmb();
+    cycle_seq++;
+    if (cycles > cycle_max) cycle_max = cycles;
+}
+
+bool timerCallback_Piezo(struct repeating_timer *t) {
+#if MIXEDTONES_STATS
+    uint32_t start = readCycleCounter();
+    measureTiming();
+#endif
+    
+    // Output via PWM - duty cycle represents volume
+    pwm_set_gpio_level(audioPinPiezo, audioRenderSample());
+    
+#if MIXEDTONES_STATS
+    recordCycles(readCycleCounter() - start);
+#endif
+    return true;
+}
+
+// Hardware alarm callback, runs on core1 when setupAudio() was asked to use it
+static void alarmCallback_Piezo(uint alarm_num) {
+    // Re-arm first so mixing time does not push the next sample back
+    alarm_target_fx += audio_period_fx;
+    if (hardware_alarm_set_target(alarm_num, from_us_since_boot(alarm_target_fx >> 16))) {
+        // Target already passed, resync instead of firing a burst of late samples
+        alarm_target_fx = (time_us_64() + 1) << 16;
+        hardware_alarm_set_target(alarm_num, from_us_since_boot(alarm_target_fx >> 16));
+    }
+    
+#if MIXEDTONES_STATS
+    uint32_t start = readCycleCounter();
+    measureTiming();
+#endif
+    
+    pwm_set_gpio_level(audioPinPiezo, audioRenderSample());
+
+#if MIXEDTONES_STATS
+    recordCycles(readCycleCounter() - start);
+#endif
+}
+
+static void audioCore1Entry() {
+    // The alarm irq is enabled on the core that installs the callback
+    audio_alarm_num = hardware_alarm_claim_unused(false);
+    if (audio_alarm_num < 0) {
+        multicore_fifo_push_blocking(0);
+        while (true) __wfi();
+    }
+    
+    enableCycleCounter();
+    hardware_alarm_set_callback(audio_alarm_num, alarmCallback_Piezo);
+    alarm_target_fx = (time_us_64() + 100) << 16;
+    hardware_alarm_set_target(audio_alarm_num, from_us_since_boot(alarm_target_fx >> 16));
+    
+    // Tell core0 the mixer is running
+    multicore_fifo_push_blocking(1);
+    
+    // Everything else happens in the alarm interrupt
+    while (true) __wfi();
+}
+
+bool audioHalBegin(int32_t sample_rate, uint8_t pin_piezo, uint8_t pin_speaker_enable, bool run_on_core1)
+{
+    audioPinPiezo = pin_piezo;
+    halSampleRate = sample_rate;
+    speakerEnablePin = pin_speaker_enable;
+    
+    // Enable the amplifier
+    pinMode(speakerEnablePin, OUTPUT);
+    digitalWrite(speakerEnablePin, HIGH);
+    
+    // Configure GPIO 12 for PWM (it's PWM slice 6, channel A)
+    gpio_set_function(audioPinPiezo, GPIO_FUNC_PWM);
+    uint slice_num = pwm_gpio_to_slice_num(audioPinPiezo);
+    
+    // Configure PWM
+    pwm_config config = pwm_get_default_config();
+    
+    // CRITICAL: PWM frequency must be MUCH higher than sample rate
+    // Set PWM to run at a high carrier frequency (e.g., 150 kHz)
+    // System clock is 150 MHz
+    // Above 8 bits the divider bottoms out at 1 and the carrier drops instead
+    const uint32_t pwm_steps = 1u << MIXEDTONES_PWM_BITS;
+    float clock_div = 150000000.0f / (150000.0f * pwm_steps);
+    if (clock_div < 1.0f) clock_div = 1.0f;
+    pwm_config_set_clkdiv(&config, clock_div);
+    pwm_config_set_wrap(&config, pwm_steps - 1);
+    
+    pwm_init(slice_num, &config, true);
+    pwm_set_gpio_level(audioPinPiezo, 0);  // Start silent
+    
+    Serial.print("PWM Audio setup - Pin: ");
+    Serial.print(audioPinPiezo);
+    Serial.print(" (PWM slice ");
+    Serial.print(slice_num);
+    Serial.print("), Sample rate: ");
+    Serial.print(halSampleRate);
+    Serial.print(" Hz, PWM: ");
+    Serial.print(MIXEDTONES_PWM_BITS);
+    Serial.print(" bit, ~");
+    Serial.print((uint32_t)(150000000.0f / (clock_div * pwm_steps) / 1000.0f));
+    Serial.print(" kHz");
+    Serial.println();
+    
+    if (run_on_core1) {
+        // Mixer gets core1 and a hardware alarm to itself, so display flushes,
+        // I2C reads and other core0 work no longer delay the samples
+        audio_period_fx = (uint32_t)((1000000ULL << 16) / halSampleRate);
+        audio_on_core1 = true;
+        stats_restart = true;
+        multicore_launch_core1(audioCore1Entry);
+        
+        if (multicore_fifo_pop_blocking() == 0) {
+            Serial.println("ERROR: No free hardware alarm for core1 audio!");
+            timer_running = false;
+        } else {
+            timer_running = true;
+            Serial.print("Core1 alarm ");
+            Serial.print(audio_alarm_num);
+            Serial.print(" running mixer at ");
+            Serial.print(halSampleRate);
+            Serial.println(" Hz");
+        }
+    } else {
+        // Setup timer interrupt
+        int64_t interval_us = -1000000 / halSampleRate;  
+        audio_period_fx = (uint32_t)(-interval_us) << 16;
+        audio_on_core1 = false;
+        stats_restart = true;
+        enableCycleCounter();
+        Serial.print("Attempting to set timer interval: ");
+        Serial.print(-interval_us);
+        Serial.println(" microseconds");
+        
+        if (!add_repeating_timer_us(interval_us, timerCallback_Piezo, NULL, &audio_timer)) {
+            Serial.println("ERROR: Failed to setup timer!");
+            Serial.println("Sample rate may be too high for reliable interrupt timing");
+            timer_running = false;
+        } else {
+            timer_running = true;
+            Serial.print("Timer interrupt enabled successfully at ");
+            Serial.print(halSampleRate);
+            Serial.println(" Hz");
+        }
+    }
+    
+    return timer_running;
+}
+
+uint32_t audioHalMillis() {
+    return millis();
+}
+
+bool audioHalOnCore1() {
+    return audio_on_core1;
+}
+
+void audioHalGetStats(AudioStats &stats) {
+    // The 64 bit sum takes two loads, the interrupt (maybe on the other
+    // core) can update it in between: read again until nothing changed
+    uint32_t seq, callbacks;
+    uint64_t sum;
+    do {
+        seq = cycle_seq;
+        __dmb();
+        callbacks = stat_callbacks;
+        sum = cycle_sum;
+        __dmb();
+    } while ((seq & 1) || seq != cycle_seq);
+    stats.callbacks = callbacks;
+    stats.avg_cycles = callbacks ? (uint32_t)(sum / callbacks) : 0;
+    stats.max_cycles = cycle_max;
+    stats.cycle_budget = clock_get_hz(clk_sys) / halSampleRate;
+    stats.late_periods = late_periods;
+    stats.missed_periods = missed_periods;
+    stats.max_jitter_us = jitter_max_us;
+}
+
+void audioHalResetStats() {
+    stats_restart = true;
+}
+
+#endif
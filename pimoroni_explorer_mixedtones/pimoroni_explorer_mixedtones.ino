@@ -1,9 +1,18 @@
 // Musical Demo for i2stones library on Adafruit FruitJam
 // Features: melodies, chords, arpeggios, sound effects, and classic tunes
 #include "mixedtones.h"
+#include "sample_kick.h"
+#include "sample_snare.h"
 
 #define volume 20
 
+// Run the mixer on core1 with its own hardware alarm instead of a core0 timer
+#define AUDIO_ON_CORE1 true
+
+// Uncomment to replace the demo with a jitter measurement: the sample clock
+// is measured while idle and while core0 runs a display-like workload
+//#define MEASURE_JITTER
+
 // Note frequencies (Middle C = C4)
 #define NOTE_C4  261.63
 #define NOTE_CS4 277.18
@@ -52,7 +61,7 @@ void setup() {
     Serial.println("║   MIXEDTONES MUSICAL DEMO - Pimoroni Explorer   ║");
     Serial.println("╚═══════════════════════════════════════╝\n");
     
-    setupAudio(44100,12,13);
+    setupAudio(44100,12,13,AUDIO_ON_CORE1);
     Serial.println("✓ Mixed Tones Audio initialized!");
     Serial.println("\n🎵 Starting musical demo...\n");
     
@@ -65,18 +74,19 @@ void setup() {
 
 void powerUp() {
     Serial.println("🔊 Power Up!");
-    for (float f = 200; f <= 800; f += 50) {
-        playTone(f, volume, 0.03);
-        delay(30);
-    }
+    // One voice sliding up, the mixer moves the pitch
+    ToneMod mod;
+    mod.sweep_to = 800;
+    mod.sweep_time = 0.4;
+    playToneMod(200, volume, mod, 0.4);
 }
 
 void powerDown() {
     Serial.println("🔊 Power Down!");
-    for (float f = 800; f >= 200; f -= 50) {
-        playTone(f, volume, 0.03);
-        delay(30);
-    }
+    ToneMod mod;
+    mod.sweep_to = 200;
+    mod.sweep_time = 0.4;
+    playToneMod(800, volume, mod, 0.4);
 }
 
 void laserShot() {
@@ -109,10 +119,12 @@ void coin() {
 
 void playScale() {
     Serial.println("🎹 Playing C Major Scale");
-    const float scale[] = {NOTE_C4, NOTE_D4, NOTE_E4, NOTE_F4, NOTE_G4, NOTE_A4, NOTE_B4, NOTE_C5};
+    // MIDI note numbers, C4 = 60
+    const uint8_t scale[] = {60, 62, 64, 65, 67, 69, 71, 72};
+    const uint32_t noteSamples = audioMsToSamples(250);
     
     for (int i = 0; i < 8; i++) {
-        playTone(scale[i], volume, 0.25);
+        playNote(scale[i], 0, volume, noteSamples);
         delay(280);
     }
 }
@@ -271,17 +283,33 @@ void multiChannelDemo() {
 void sirens() {
     Serial.println("🚨 Police Siren");
     
-    for (int i = 0; i < 4; i++) {
-        // Up sweep
-        for (float f = 400; f <= 800; f += 30) {
-            playTone(f, volume, 0.03);
-            delay(30);
-        }
-        // Down sweep
-        for (float f = 800; f >= 400; f -= 30) {
-            playTone(f, volume, 0.03);
-            delay(30);
+    // 4 times up and down on a single voice
+    ToneMod mod;
+    mod.sweep_to = 800;
+    mod.sweep_time = 0.4;
+    mod.sweep_pingpong = true;
+    playToneMod(400, volume, mod, 3.2);
+}
+
+void drumBeat() {
+    Serial.println("🥁 Drum Beat (ADPCM samples)");
+    
+    // Two bars, kick on the beat and snare on the backbeat, with a bass line
+    // from the same kick clip pitched down
+    for (int i = 0; i < 8; i++) {
+        float t = i * 0.4;
+        if (i % 2 == 0) {
+            playSample(sample_kick, volume, 1.0f, false, t);
+        } else {
+            playSample(sample_snare, volume, 1.0f, false, t);
         }
+        playSample(sample_kick, volume / 2, i % 4 == 3 ? 0.75f : 0.5f, false, t + 0.2);
+    }
+    
+    // The delayed hits are started by updateAudio(), keep calling it
+    uint32_t start = millis();
+    while (millis() - start < 3200) {
+        updateAudio();
     }
 }
 
@@ -298,6 +326,98 @@ void echoDemo() {
     delay(2000);
 }
 
+// ═══════════════════════════════════════════════════════════
+// MIXER STATISTICS
+// ═══════════════════════════════════════════════════════════
+
+void printAudioStats() {
+    AudioStats stats;
+    getAudioStats(stats);
+    
+    Serial.print("  mixer: ");
+    Serial.print(stats.avg_cycles);
+    Serial.print(" avg / ");
+    Serial.print(stats.max_cycles);
+    Serial.print(" max cycles of ");
+    Serial.print(stats.cycle_budget);
+    Serial.print(" (");
+    Serial.print(stats.cycle_budget ? stats.max_cycles * 100 / stats.cycle_budget : 0);
+    Serial.println("% worst case)");
+    
+    Serial.print("  timer: ");
+    Serial.print(stats.callbacks);
+    Serial.print(" samples, ");
+    Serial.print(stats.late_periods);
+    Serial.print(" late, ");
+    Serial.print(stats.missed_periods);
+    Serial.print(" missed, max jitter ");
+    Serial.print(stats.max_jitter_us);
+    Serial.println(" us");
+    
+    Serial.print("  voices: peak ");
+    Serial.print(stats.peak_voices);
+    Serial.print("/");
+    Serial.print(getMaxChannels());
+    Serial.print(", ");
+    Serial.print(stats.stolen_voices);
+    Serial.print(" stolen, ");
+    Serial.print(stats.dropped_tones);
+    Serial.println(" dropped");
+}
+
+// ═══════════════════════════════════════════════════════════
+// JITTER MEASUREMENT
+// ═══════════════════════════════════════════════════════════
+
+#ifdef MEASURE_JITTER
+#include <hardware/sync.h>
+
+// Roughly what a canvas redraw + flush does to core0: clear and fill a
+// 320x240 RGB565 framebuffer, then push it out, with short interrupt-off
+// sections like the ones I2C and USB handling add
+static uint16_t loadFramebuffer[320 * 240];
+static uint16_t loadOutput[320 * 240];
+
+void simulateDisplayLoad() {
+    for (int i = 0; i < 320 * 240; i++) {
+        loadFramebuffer[i] = (uint16_t)(i * 31);
+    }
+    for (int row = 0; row < 240; row += 24) {
+        uint32_t irq = save_and_disable_interrupts();
+        memcpy(&loadOutput[row * 320], &loadFramebuffer[row * 320], 24 * 320 * sizeof(uint16_t));
+        restore_interrupts(irq);
+    }
+}
+
+void measureJitter() {
+    static bool withLoad = false;
+    
+    // Keep a chord going so the mixer does real work
+    if (getPlayingChannelCount() == 0) {
+        playTone(NOTE_C4, volume, 0, 0);
+        playTone(NOTE_E4, volume, 0, 0);
+        playTone(NOTE_G4, volume, 0, 0);
+    }
+    
+    resetAudioStats();
+    uint32_t start = millis();
+    while (millis() - start < 5000) {
+        if (withLoad) {
+            simulateDisplayLoad();
+        } else {
+            delay(1);
+        }
+    }
+    
+    Serial.print(isAudioOnCore1() ? "[core1] " : "[core0] ");
+    Serial.print(withLoad ? "with display load: " : "idle:              ");
+    Serial.println();
+    printAudioStats();
+    
+    withLoad = !withLoad;
+}
+#endif
+
 // ═══════════════════════════════════════════════════════════
 // MAIN DEMO SEQUENCE
 // ═══════════════════════════════════════════════════════════
@@ -305,14 +425,24 @@ void echoDemo() {
 void loop() {
     updateAudio();
     
+#ifdef MEASURE_JITTER
+    measureJitter();
+    return;
+#endif
+    
     static int demoStep = 0;
     static uint32_t lastDemo = 0;
     
     // Run demos every 5 seconds
     if (millis() - lastDemo > 5000) {
+        // Numbers for the demo that just ran
+        if (lastDemo != 0) {
+            printAudioStats();
+        }
+        resetAudioStats();
         lastDemo = millis();
         
-        Serial.print("\n▶ Demo "); Serial.print(demoStep + 1); Serial.println("/15");
+        Serial.print("\n▶ Demo "); Serial.print(demoStep + 1); Serial.println("/16");
         Serial.println("────────────────────────────────────");
         
         switch(demoStep) {
@@ -330,11 +460,12 @@ void loop() {
             case 11: playMarioTheme(); break;
             case 12: echoDemo(); break;
             case 13: playHappyBirthday(); break;
-            case 14: powerDown(); break;
+            case 14: drumBeat(); break;
+            case 15: powerDown(); break;
         }
         
         demoStep++;
-        if (demoStep >= 15) {
+        if (demoStep >= 16) {
             Serial.println("\n\n🎉 Demo sequence complete! Restarting...\n");
             demoStep = 0;
         }
@@ -0,0 +1,109 @@
+// Generated by mixedtones_sampleconv from kick.wav
+// 2756 samples at 11025 Hz, IMA-ADPCM, 1536 bytes
+
+#pragma once
+
+#include "mixedtones.h"
+
+static const uint8_t sample_kick_data[1536] = {
+    0x01, 0x0a, 0x42, 0x00, 0x22, 0x23, 0x33, 0x33, 0x33, 0x33, 0x23, 0x12, 0x81, 0xa8, 0xcc, 0xeb,
+    0xcb, 0xbc, 0xbc, 0xbc, 0xbc, 0xcb, 0xac, 0xbb, 0xcb, 0xbb, 0xbb, 0xbb, 0xac, 0xba, 0xa9, 0x89,
+    0x08, 0x21, 0x53, 0x44, 0x43, 0x44, 0x33, 0x44, 0x33, 0x34, 0x43, 0x33, 0x34, 0x43, 0x32, 0x33,
+    0x33, 0x24, 0x22, 0x12, 0x11, 0x00, 0x99, 0xcb, 0xcc, 0xdb, 0xcb, 0xbc, 0xbc, 0xbc, 0xcb, 0xcb,
+    0xbb, 0xbc, 0xcb, 0xbb, 0xbb, 0xbc, 0xbb, 0xbb, 0xbb, 0xab, 0xab, 0x99, 0x08, 0x30, 0x63, 0x34,
+    0x35, 0x35, 0x53, 0x33, 0x25, 0x24, 0x24, 0x33, 0x34, 0x33, 0x34, 0x24, 0x33, 0x43, 0x32, 0x33,
+    0x32, 0x33, 0x23, 0x22, 0x11, 0x80, 0xaa, 0xdc, 0xdb, 0xdb, 0xcb, 0xcb, 0xbc, 0xcb, 0xcb, 0xcb,
+    0xbb, 0xbc, 0xcb, 0xcb, 0xba, 0xac, 0xbb, 0xbb, 0xcb, 0xbb, 0xbb, 0xbb, 0xbb, 0xab, 0xaa, 0x99,
+    0x00, 0x32, 0x54, 0x44, 0x43, 0x44, 0x33, 0x44, 0x43, 0x33, 0x44, 0x32, 0x34, 0x43, 0x33, 0x43,
+    0x43, 0x33, 0x33, 0x34, 0x33, 0x34, 0x32, 0x33, 0x43, 0x22, 0x22, 0x21, 0x01, 0x80, 0xa8, 0xcb,
+    0xcc, 0xcc, 0xcb, 0xdb, 0xbb, 0xcc, 0xbb, 0xbc, 0xbc, 0xbc, 0xbb, 0xad, 0xac, 0xbb, 0xcb, 0xbb,
+    0xcb, 0xbb, 0xbc, 0xbb, 0xbb, 0xbc, 0xbb, 0xbb, 0xbb, 0xbb, 0xbb, 0x9a, 0x8a, 0x18, 0x32, 0x45,
+    0x44, 0x53, 0x43, 0x34, 0x53, 0x33, 0x44, 0x42, 0x33, 0x43, 0x24, 0x43, 0x33, 0x43, 0x43, 0x33,
+    0x43, 0x33, 0x34, 0x33, 0x43, 0x33, 0x24, 0x33, 0x33, 0x33, 0x24, 0x23, 0x22, 0x22, 0x11, 0x80,
+    0x98, 0xcb, 0xcc, 0xdb, 0xdb, 0xcb, 0xcb, 0xcb, 0xac, 0xbc, 0xcb, 0xbb, 0xcc, 0xba, 0xbc, 0xcb,
+    0xbb, 0xdb, 0xba, 0xac, 0xbb, 0xac, 0xcb, 0xba, 0xcb, 0xba, 0xbb, 0xcb, 0xab, 0xcb, 0xaa, 0xab,
+    0xd5, 0xc1, 0x20, 0x00, 0xbe, 0xaa, 0x9b, 0x9a, 0x08, 0x21, 0x43, 0x45, 0x34, 0x44, 0x43, 0x34,
+    0x34, 0x53, 0x33, 0x34, 0x34, 0x34, 0x43, 0x43, 0x33, 0x34, 0x43, 0x33, 0x34, 0x43, 0x33, 0x34,
+    0x43, 0x32, 0x24, 0x33, 0x43, 0x33, 0x33, 0x24, 0x33, 0x43, 0x32, 0x32, 0x32, 0x22, 0x13, 0x12,
+    0x01, 0x98, 0xba, 0xcd, 0xbc, 0xbd, 0xbd, 0xdb, 0xbb, 0xcc, 0xcb, 0xbb, 0xbc, 0xbc, 0xbc, 0xcb,
+    0xac, 0xcb, 0xba, 0xbc, 0xbb, 0xbc, 0xbc, 0xbb, 0xbc, 0xcb, 0xbb, 0xbc, 0xbb, 0xbc, 0xbb, 0xac,
+    0xac, 0xba, 0xbb, 0xcb, 0xba, 0xab, 0xbb, 0xbb, 0xbb, 0xab, 0xaa, 0x99, 0x18, 0x31, 0x44, 0x35,
+    0x35, 0x44, 0x43, 0x43, 0x34, 0x53, 0x33, 0x34, 0x53, 0x33, 0x34, 0x43, 0x43, 0x33, 0x34, 0x34,
+    0x43, 0x33, 0x43, 0x24, 0x33, 0x34, 0x33, 0x34, 0x43, 0x33, 0x43, 0x33, 0x24, 0x43, 0x32, 0x32,
+    0x24, 0x23, 0x33, 0x43, 0x32, 0x22, 0x23, 0x23, 0x21, 0x11, 0x00, 0xa9, 0xca, 0xcc, 0xcc, 0xcb,
+    0xbc, 0xcc, 0xbb, 0xcc, 0xbb, 0xcc, 0xbb, 0xbc, 0xdb, 0xca, 0xba, 0xac, 0xcb, 0xbb, 0xbc, 0xcb,
+    0xbb, 0xbc, 0xcb, 0xbb, 0xbc, 0xcb, 0xbb, 0xcb, 0xcb, 0xba, 0xcb, 0xbb, 0xbb, 0xbc, 0xcb, 0xab,
+    0xac, 0xba, 0xbb, 0xbb, 0xac, 0xbb, 0xba, 0xab, 0xab, 0xaa, 0x99, 0x09, 0x20, 0x53, 0x53, 0x44,
+    0x43, 0x34, 0x34, 0x44, 0x33, 0x34, 0x44, 0x33, 0x34, 0x53, 0x42, 0x32, 0x24, 0x24, 0x33, 0x34,
+    0x43, 0x43, 0x42, 0x32, 0x43, 0x42, 0x32, 0x33, 0x34, 0x43, 0x33, 0x34, 0x33, 0x53, 0x32, 0x33,
+    0x34, 0x42, 0x32, 0x33, 0x33, 0x34, 0x33, 0x43, 0x32, 0x32, 0x23, 0x23, 0x32, 0x21, 0x10, 0x98,
+    0xb9, 0xbd, 0xbe, 0xbc, 0xbd, 0xcc, 0xbb, 0xcc, 0xcb, 0xbb, 0xbd, 0xcb, 0xbb, 0xbd, 0xbb, 0xcc,
+    0x6f, 0x15, 0x26, 0x00, 0xcb, 0xbb, 0xbc, 0xcb, 0xcb, 0xbb, 0xbc, 0xbb, 0xad, 0xbb, 0xbc, 0xcb,
+    0xbb, 0xcb, 0xcb, 0xba, 0xcb, 0xbb, 0xcb, 0xbb, 0xcb, 0xbb, 0xcb, 0xbb, 0xbb, 0xbc, 0xbb, 0xcb,
+    0xab, 0xbb, 0xbb, 0xbb, 0xbb, 0xbb, 0x9a, 0x99, 0x18, 0x32, 0x45, 0x34, 0x45, 0x43, 0x53, 0x33,
+    0x35, 0x43, 0x34, 0x43, 0x43, 0x43, 0x33, 0x44, 0x32, 0x34, 0x43, 0x33, 0x44, 0x32, 0x43, 0x33,
+    0x34, 0x24, 0x24, 0x33, 0x43, 0x33, 0x34, 0x24, 0x33, 0x34, 0x33, 0x34, 0x43, 0x33, 0x43, 0x42,
+    0x32, 0x32, 0x24, 0x33, 0x43, 0x32, 0x33, 0x33, 0x24, 0x33, 0x32, 0x32, 0x23, 0x22, 0x11, 0x80,
+    0xa8, 0xdb, 0xcc, 0xdb, 0xdb, 0xbb, 0xbd, 0xbc, 0xbc, 0xbc, 0xbc, 0xbc, 0xcb, 0xac, 0xac, 0xac,
+    0xbb, 0xbc, 0xac, 0xac, 0xcb, 0xca, 0xba, 0xcb, 0xca, 0xba, 0xcb, 0xbb, 0xbc, 0xbb, 0xbc, 0xbc,
+    0xbb, 0xbc, 0xcb, 0xbb, 0xcb, 0xbb, 0xbc, 0xbb, 0xbc, 0xbb, 0xcb, 0xbb, 0xbc, 0xba, 0xac, 0xab,
+    0xbb, 0xcb, 0xaa, 0xab, 0xba, 0xaa, 0xa9, 0x89, 0x08, 0x21, 0x53, 0x44, 0x53, 0x43, 0x34, 0x34,
+    0x34, 0x44, 0x42, 0x33, 0x34, 0x34, 0x53, 0x42, 0x32, 0x43, 0x43, 0x33, 0x34, 0x24, 0x24, 0x43,
+    0x32, 0x24, 0x43, 0x33, 0x43, 0x33, 0x34, 0x43, 0x33, 0x34, 0x43, 0x33, 0x43, 0x33, 0x34, 0x33,
+    0x34, 0x33, 0x34, 0x33, 0x34, 0x33, 0x34, 0x33, 0x43, 0x32, 0x33, 0x33, 0x24, 0x23, 0x23, 0x22,
+    0x12, 0x11, 0x88, 0xa9, 0xbc, 0xbe, 0xcc, 0xdb, 0xbb, 0xbd, 0xbc, 0xbc, 0xbc, 0xbc, 0xdb, 0xca,
+    0xca, 0xba, 0xcb, 0xcb, 0xbb, 0xbc, 0xbc, 0xcb, 0xbb, 0xbc, 0xcb, 0xac, 0xbb, 0xbc, 0xcb, 0xca,
+    0xba, 0xcb, 0xbb, 0xac, 0xcb, 0xbb, 0xbb, 0xad, 0xbb, 0xcb, 0xbb, 0xac, 0xcb, 0xba, 0xbb, 0xcb,
+    0x05, 0xef, 0x12, 0x00, 0xcf, 0xbb, 0xcb, 0xba, 0xbb, 0xbb, 0xcb, 0xba, 0xba, 0xaa, 0xaa, 0x99,
+    0x08, 0x20, 0x52, 0x53, 0x34, 0x44, 0x43, 0x34, 0x34, 0x34, 0x34, 0x34, 0x34, 0x43, 0x34, 0x43,
+    0x33, 0x25, 0x43, 0x33, 0x34, 0x43, 0x43, 0x33, 0x34, 0x43, 0x33, 0x34, 0x43, 0x43, 0x42, 0x32,
+    0x33, 0x34, 0x43, 0x33, 0x34, 0x33, 0x34, 0x43, 0x33, 0x43, 0x33, 0x43, 0x33, 0x24, 0x33, 0x24,
+    0x33, 0x43, 0x32, 0x33, 0x33, 0x43, 0x32, 0x32, 0x32, 0x22, 0x12, 0x01, 0x88, 0xba, 0xbd, 0xcd,
+    0xdb, 0xcb, 0xbc, 0xdb, 0xbb, 0xbd, 0xcb, 0xac, 0xac, 0xac, 0xcb, 0xbb, 0xbc, 0xac, 0xbc, 0xbb,
+    0xbc, 0xbc, 0xcb, 0xcb, 0xbb, 0xcb, 0xcb, 0xbb, 0xbc, 0xcb, 0xbb, 0xcb, 0xac, 0xbb, 0xbc, 0xbb,
+    0xbc, 0xcb, 0xbb, 0xcb, 0xbb, 0xbc, 0xbb, 0xbc, 0xbb, 0xbc, 0xbb, 0xcb, 0xbb, 0xcb, 0xab, 0xbb,
+    0xac, 0xab, 0xbb, 0xba, 0xab, 0xab, 0xa9, 0x89, 0x10, 0x32, 0x36, 0x44, 0x34, 0x35, 0x34, 0x34,
+    0x44, 0x33, 0x44, 0x33, 0x34, 0x34, 0x53, 0x42, 0x32, 0x24, 0x24, 0x43, 0x32, 0x34, 0x43, 0x33,
+    0x34, 0x43, 0x43, 0x32, 0x34, 0x33, 0x34, 0x34, 0x33, 0x34, 0x43, 0x33, 0x34, 0x33, 0x34, 0x24,
+    0x33, 0x34, 0x33, 0x43, 0x33, 0x24, 0x43, 0x32, 0x23, 0x24, 0x33, 0x33, 0x33, 0x24, 0x33, 0x23,
+    0x33, 0x32, 0x12, 0x11, 0x80, 0xaa, 0xcc, 0xcc, 0xeb, 0xbb, 0xcc, 0xcb, 0xcb, 0xbc, 0xcb, 0xcb,
+    0xcb, 0xcb, 0xbb, 0xbc, 0xbc, 0xbc, 0xcb, 0xbb, 0xcc, 0xba, 0xbc, 0xbb, 0xbc, 0xbc, 0xcb, 0xbb,
+    0xbc, 0xcb, 0xbb, 0xbc, 0xcb, 0xbb, 0xbc, 0xbb, 0xbc, 0xac, 0xcb, 0xba, 0xcb, 0xba, 0xac, 0xbb,
+    0xcb, 0xbb, 0xbb, 0xbc, 0xcb, 0xba, 0xbb, 0xac, 0xbb, 0xbb, 0xbb, 0xbb, 0xac, 0xab, 0x9a, 0x9a,
+    0x07, 0xf3, 0x0a, 0x00, 0x08, 0x11, 0x32, 0x35, 0x44, 0x34, 0x44, 0x33, 0x35, 0x53, 0x33, 0x34,
+    0x34, 0x34, 0x34, 0x43, 0x43, 0x33, 0x34, 0x34, 0x43, 0x43, 0x33, 0x34, 0x43, 0x33, 0x34, 0x34,
+    0x33, 0x34, 0x34, 0x33, 0x34, 0x34, 0x33, 0x34, 0x43, 0x33, 0x24, 0x24, 0x33, 0x33, 0x34, 0x24,
+    0x33, 0x24, 0x33, 0x24, 0x33, 0x43, 0x32, 0x33, 0x24, 0x23, 0x33, 0x33, 0x33, 0x24, 0x12, 0x12,
+    0x01, 0x90, 0xb9, 0xbc, 0xcd, 0xdb, 0xdb, 0xbb, 0xcc, 0xcb, 0xcb, 0xbb, 0xbd, 0xcb, 0xcb, 0xcb,
+    0xbb, 0xbc, 0xbc, 0xcb, 0xcb, 0xbb, 0xbc, 0xcb, 0xcb, 0xbb, 0xbc, 0xcb, 0xbb, 0xbc, 0xac, 0xcb,
+    0xca, 0xba, 0xbb, 0xbc, 0xbb, 0xbc, 0xbc, 0xbb, 0xbc, 0xbb, 0xbc, 0xac, 0xbb, 0xac, 0xbb, 0xac,
+    0xbb, 0xac, 0xbb, 0xbb, 0xac, 0xbb, 0xcb, 0xaa, 0xab, 0xbb, 0xba, 0xb9, 0xa9, 0x98, 0x01, 0x33,
+    0x35, 0x35, 0x34, 0x35, 0x34, 0x35, 0x43, 0x34, 0x43, 0x43, 0x43, 0x43, 0x33, 0x34, 0x34, 0x34,
+    0x43, 0x33, 0x34, 0x34, 0x43, 0x43, 0x42, 0x32, 0x43, 0x33, 0x34, 0x33, 0x25, 0x33, 0x34, 0x43,
+    0x33, 0x43, 0x43, 0x32, 0x24, 0x33, 0x24, 0x43, 0x32, 0x33, 0x34, 0x33, 0x34, 0x33, 0x43, 0x33,
+    0x24, 0x33, 0x33, 0x33, 0x34, 0x23, 0x33, 0x23, 0x23, 0x21, 0x01, 0x99, 0xbb, 0xbd, 0xdb, 0xdb,
+    0xcb, 0xcb, 0xbc, 0xdb, 0xbb, 0xbd, 0xbb, 0xbd, 0xcb, 0xcb, 0xbb, 0xad, 0xcb, 0xbb, 0xbc, 0xcb,
+    0xcb, 0xca, 0xba, 0xac, 0xcb, 0xbb, 0xcb, 0xcb, 0xbb, 0xcb, 0xbb, 0xad, 0xbb, 0xcb, 0xbb, 0xbc,
+    0xcb, 0xbb, 0xcb, 0xbb, 0xbc, 0xbb, 0xac, 0xac, 0xbb, 0xbb, 0xbc, 0xbb, 0xcb, 0xbb, 0xcb, 0xba,
+    0xbb, 0xbb, 0xac, 0xab, 0xaa, 0xaa, 0x9a, 0x89, 0x10, 0x33, 0x43, 0x53, 0x43, 0x53, 0x43, 0x53,
+    0x0c, 0xf9, 0x08, 0x00, 0x35, 0x35, 0x43, 0x43, 0x33, 0x35, 0x33, 0x44, 0x33, 0x34, 0x43, 0x43,
+    0x33, 0x34, 0x43, 0x43, 0x33, 0x34, 0x43, 0x33, 0x34, 0x43, 0x43, 0x32, 0x24, 0x43, 0x32, 0x43,
+    0x33, 0x43, 0x33, 0x34, 0x33, 0x34, 0x43, 0x33, 0x43, 0x32, 0x24, 0x33, 0x43, 0x32, 0x33, 0x24,
+    0x33, 0x33, 0x33, 0x43, 0x22, 0x23, 0x21, 0x02, 0x01, 0x99, 0xbb, 0xdb, 0xbb, 0xbd, 0xbc, 0xcc,
+    0xcb, 0xbb, 0xbd, 0xdb, 0xbb, 0xdb, 0xbb, 0xbc, 0xdb, 0xbb, 0xcb, 0xcb, 0xcb, 0xca, 0xba, 0xac,
+    0xcb, 0xbb, 0xcb, 0xcb, 0xbb, 0xdb, 0xba, 0xcb, 0xbb, 0xbc, 0xbb, 0xbc, 0xac, 0xcb, 0xba, 0xac,
+    0xbb, 0xcb, 0xbb, 0xbc, 0xca, 0xba, 0xbb, 0xbc, 0xbb, 0xcb, 0xbb, 0xcb, 0xba, 0xbb, 0xac, 0xbb,
+    0xba, 0xba, 0xab, 0xaa, 0xa9, 0x99, 0x10, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+};
+
+static const AudioSample sample_kick = {
+    sample_kick_data, 2756, 11025, 0, 0, 256, SAMPLE_IMA_ADPCM
+};
@@ -0,0 +1,77 @@
+// Generated by mixedtones_sampleconv from snare.wav
+// 1984 samples at 11025 Hz, IMA-ADPCM, 1024 bytes
+
+#pragma once
+
+#include "mixedtones.h"
+
+static const uint8_t sample_snare_data[1024] = {
+    0xf9, 0xdb, 0x45, 0x00, 0x97, 0x03, 0x8f, 0xa6, 0x48, 0x2a, 0x1a, 0x3b, 0xa1, 0x81, 0x3f, 0xa8,
+    0x59, 0x09, 0x91, 0xc1, 0xa2, 0x83, 0x8f, 0x40, 0x0a, 0x19, 0x88, 0x01, 0xa3, 0x82, 0xc2, 0x5e,
+    0x80, 0x09, 0x5b, 0x99, 0x69, 0xc0, 0x92, 0x08, 0x02, 0x2d, 0x3a, 0x3a, 0xb0, 0xe3, 0x39, 0x0b,
+    0x11, 0x8c, 0xa6, 0x02, 0x0b, 0x00, 0x88, 0x40, 0x8c, 0xc2, 0x60, 0x0a, 0x2a, 0xc1, 0x03, 0x3c,
+    0x18, 0x3a, 0xf0, 0x30, 0xd1, 0x01, 0x09, 0x88, 0xb2, 0x31, 0x2f, 0xa0, 0x49, 0x8b, 0x21, 0x1d,
+    0x38, 0x4b, 0x0d, 0x12, 0x9b, 0x49, 0x5a, 0xc0, 0x30, 0x19, 0x9b, 0x51, 0x0b, 0x81, 0x50, 0x8d,
+    0x04, 0xb0, 0x83, 0x2d, 0x80, 0x99, 0x90, 0x49, 0x4a, 0x4d, 0x19, 0x88, 0xc9, 0xa4, 0x10, 0x88,
+    0xa3, 0x9a, 0xa7, 0xa2, 0x29, 0xd2, 0x13, 0x08, 0x2f, 0xc1, 0x81, 0x81, 0x20, 0x0d, 0x08, 0x68,
+    0xb8, 0x92, 0x08, 0x92, 0x99, 0x90, 0x14, 0xac, 0x20, 0x12, 0x3d, 0xa9, 0x18, 0xd3, 0xb3, 0x4a,
+    0xf2, 0x01, 0x03, 0x3c, 0xc8, 0xa1, 0x86, 0x81, 0x19, 0xc9, 0xc3, 0x41, 0x0c, 0x48, 0x8b, 0xb4,
+    0x83, 0x00, 0x1a, 0x3f, 0x09, 0x4b, 0xd0, 0x01, 0xb1, 0x08, 0x12, 0x8a, 0x80, 0xc0, 0x35, 0x2c,
+    0x3c, 0x80, 0x09, 0x31, 0x8f, 0x13, 0x8b, 0xc2, 0x80, 0xa3, 0x69, 0xd1, 0x92, 0xa2, 0x8a, 0x49,
+    0x99, 0x81, 0xe4, 0xa4, 0x80, 0x82, 0x99, 0x12, 0x2c, 0xd2, 0x09, 0x03, 0x82, 0x8f, 0x00, 0x13,
+    0xe0, 0xb3, 0x21, 0x0d, 0xa4, 0x18, 0xd1, 0x01, 0xa0, 0x23, 0x1d, 0x1b, 0xc2, 0x85, 0x3c, 0x2a,
+    0xb8, 0x02, 0xc0, 0x13, 0x9a, 0x3c, 0x49, 0x88, 0x4c, 0xb8, 0x97, 0x4a, 0x1b, 0x92, 0x00, 0x89,
+    0x89, 0x06, 0x19, 0x8b, 0x41, 0x2f, 0x29, 0x8a, 0x00, 0xc2, 0xd3, 0x90, 0x40, 0xb8, 0x10, 0x02,
+    0x08, 0x03, 0x43, 0x00, 0xd9, 0xa2, 0x03, 0x0b, 0xc7, 0x03, 0xb0, 0x01, 0x30, 0xca, 0xa5, 0x01,
+    0x4d, 0x88, 0x88, 0x29, 0x3b, 0xa1, 0x51, 0xf8, 0x82, 0x1b, 0x98, 0x33, 0x3e, 0xc9, 0x94, 0x91,
+    0xa0, 0x03, 0xc8, 0x92, 0x9b, 0x11, 0x58, 0x92, 0x39, 0x2d, 0xb2, 0x7a, 0xa0, 0x18, 0xc1, 0x19,
+    0xb6, 0x91, 0x88, 0xa2, 0x09, 0x40, 0x8d, 0x83, 0xf3, 0x81, 0x7a, 0x8a, 0x91, 0x91, 0x89, 0xa5,
+    0xa3, 0xc3, 0x08, 0x94, 0x99, 0x24, 0xcb, 0x00, 0x80, 0x60, 0xc1, 0xa4, 0x01, 0xd0, 0x20, 0xd1,
+    0x20, 0x1b, 0x28, 0xe1, 0x82, 0x90, 0xc2, 0x90, 0xa4, 0x89, 0x84, 0xa0, 0xa0, 0xc5, 0x12, 0xc8,
+    0x31, 0x18, 0xc0, 0x94, 0x0a, 0x3a, 0xd5, 0xa2, 0x38, 0x9a, 0x50, 0xc8, 0x41, 0x1b, 0x29, 0x19,
+    0xba, 0x90, 0xb7, 0x68, 0x3b, 0x1c, 0x39, 0x09, 0x00, 0x1b, 0xb8, 0x97, 0xb1, 0x82, 0xd2, 0x11,
+    0x4b, 0xa1, 0x82, 0x1b, 0xb7, 0xa0, 0x81, 0x86, 0x00, 0x2a, 0x9b, 0x85, 0xc0, 0xb2, 0x84, 0x3c,
+    0x8c, 0xb3, 0x11, 0x3d, 0x1a, 0x39, 0xc0, 0x19, 0xb1, 0x70, 0x10, 0x90, 0xab, 0x12, 0x01, 0x7a,
+    0x1b, 0x83, 0x8d, 0xd5, 0x20, 0x98, 0x19, 0xa3, 0x94, 0xf1, 0x90, 0x82, 0x3a, 0x1b, 0x48, 0x9a,
+    0x4a, 0x01, 0x81, 0x8e, 0x84, 0x29, 0x9a, 0x99, 0x17, 0xa0, 0x11, 0x98, 0x1a, 0x8b, 0x27, 0x8b,
+    0x08, 0xb4, 0xd5, 0x10, 0x29, 0x00, 0xda, 0x83, 0xa8, 0x23, 0x1f, 0x09, 0x02, 0xba, 0xb6, 0x30,
+    0x0c, 0x03, 0x0c, 0x98, 0x61, 0x0c, 0x80, 0x12, 0x90, 0xf1, 0x31, 0x0c, 0x91, 0xa1, 0x50, 0x3b,
+    0x4c, 0x89, 0x8a, 0xb4, 0x30, 0xe0, 0x93, 0x99, 0x41, 0x8c, 0x80, 0x31, 0x0e, 0x03, 0xc8, 0x30,
+    0x1a, 0xaa, 0x33, 0xa0, 0x08, 0x18, 0xf5, 0x12, 0xd0, 0x84, 0x0b, 0x88, 0xa6, 0xb2, 0x38, 0x00,
+    0x09, 0x04, 0x3b, 0x00, 0x19, 0x2d, 0xa8, 0xa3, 0x91, 0x08, 0x52, 0x98, 0xe8, 0xb4, 0x29, 0xb2,
+    0xb2, 0xa7, 0x00, 0x12, 0x8c, 0xc1, 0x32, 0xe8, 0x94, 0xb2, 0x28, 0xb1, 0x94, 0x8a, 0x81, 0x28,
+    0xb2, 0x0f, 0x20, 0x8c, 0x81, 0x5a, 0xb2, 0x02, 0x18, 0x1f, 0x5b, 0x0a, 0xb2, 0x59, 0xa9, 0x28,
+    0x7a, 0x0a, 0x00, 0x10, 0x98, 0x7a, 0xb8, 0x12, 0xe1, 0x28, 0x28, 0xa8, 0x00, 0xe2, 0x90, 0xc3,
+    0x95, 0xa8, 0x01, 0xa2, 0x59, 0x99, 0x1a, 0xd4, 0x02, 0x29, 0x80, 0xc8, 0x39, 0x98, 0xb7, 0x13,
+    0x3d, 0x8a, 0x88, 0x93, 0x84, 0x1d, 0x90, 0x80, 0xa3, 0x0a, 0x12, 0x5c, 0x3c, 0xb9, 0xa5, 0x00,
+    0x90, 0x5c, 0xa0, 0x90, 0x94, 0x5b, 0xb0, 0xa4, 0x3a, 0x3a, 0xc8, 0x23, 0x1b, 0xd3, 0x10, 0xe2,
+    0x48, 0x99, 0x84, 0x29, 0x98, 0xbb, 0x07, 0x0a, 0xa0, 0x93, 0xb9, 0xa5, 0xd3, 0x91, 0x11, 0x8c,
+    0xa3, 0xb2, 0x58, 0x83, 0x9b, 0x2b, 0x71, 0x5c, 0x0a, 0x49, 0x2b, 0xa8, 0x60, 0x88, 0xc0, 0x83,
+    0x1a, 0xd3, 0xb2, 0xb3, 0x81, 0x94, 0x1a, 0x4a, 0x1d, 0x90, 0x1b, 0xb4, 0xa4, 0x94, 0xa8, 0x5b,
+    0x01, 0x0d, 0x94, 0x18, 0x2c, 0x00, 0x0b, 0x33, 0x8f, 0x30, 0x1a, 0xa3, 0x4b, 0x1d, 0xb2, 0x39,
+    0x69, 0x2c, 0x19, 0x09, 0x8a, 0x31, 0x8d, 0xa0, 0x22, 0x08, 0xbc, 0x30, 0x69, 0x5b, 0x08, 0xa0,
+    0x88, 0x7b, 0xa8, 0x96, 0x90, 0x59, 0x1b, 0xd3, 0x01, 0x39, 0xaa, 0xb2, 0x15, 0xd8, 0x92, 0x80,
+    0x98, 0xc3, 0xc5, 0xb3, 0x38, 0x08, 0x09, 0x4c, 0x39, 0x0e, 0x02, 0x1a, 0x88, 0x10, 0x1d, 0xb3,
+    0x91, 0x31, 0x30, 0xae, 0xa1, 0x32, 0xc0, 0x98, 0x41, 0x7b, 0x99, 0xb0, 0x86, 0x2a, 0x8b, 0x80,
+    0x03, 0xf0, 0x93, 0x19, 0xa8, 0x31, 0x30, 0x3f, 0x89, 0xf3, 0x02, 0x2c, 0xc2, 0x83, 0x9a, 0x50,
+    0x2e, 0x00, 0x25, 0x00, 0x29, 0xd7, 0x79, 0x0a, 0xb2, 0x48, 0x0b, 0xc3, 0xb3, 0x88, 0x82, 0x19,
+    0x5a, 0x90, 0xf0, 0x80, 0x58, 0x08, 0xaa, 0xa2, 0xa6, 0x38, 0x4b, 0x2b, 0x5b, 0x0a, 0x81, 0x99,
+    0xb4, 0xa5, 0x08, 0x18, 0x91, 0x88, 0x32, 0x3d, 0xcb, 0x60, 0x8a, 0x11, 0x8b, 0xb8, 0x86, 0x88,
+    0x20, 0x4e, 0x3c, 0x3b, 0x8b, 0x13, 0x00, 0xf0, 0x80, 0x93, 0x01, 0xa2, 0xb1, 0x7d, 0x0b, 0xa3,
+    0xb1, 0x31, 0x2d, 0xc2, 0x02, 0x19, 0xd9, 0x20, 0xd2, 0xa1, 0xa4, 0x00, 0x4b, 0x00, 0x8c, 0x58,
+    0x8a, 0x01, 0x0a, 0x03, 0x9d, 0x87, 0x98, 0xa3, 0x89, 0x21, 0x6a, 0x99, 0x81, 0x80, 0x08, 0xf3,
+    0xb3, 0xd3, 0x01, 0xc1, 0x80, 0x82, 0x0c, 0x60, 0x0a, 0x19, 0x91, 0x2d, 0xb0, 0xa5, 0x10, 0x90,
+    0xa3, 0xaa, 0x96, 0x91, 0x0a, 0x81, 0x87, 0x39, 0xd8, 0xa4, 0xc3, 0x00, 0x83, 0xaa, 0x21, 0x4e,
+    0x08, 0x89, 0xd2, 0x90, 0x30, 0x3c, 0x3a, 0x89, 0xf1, 0x00, 0x10, 0x81, 0xa1, 0x2b, 0x12, 0x0e,
+    0xc2, 0xc6, 0x82, 0x29, 0x38, 0xa8, 0x02, 0x3f, 0x18, 0xb9, 0x38, 0x4c, 0x19, 0x8b, 0x94, 0x1a,
+    0x29, 0xaa, 0x87, 0xb8, 0x59, 0x90, 0x4b, 0x99, 0x92, 0x02, 0xf3, 0x30, 0x8a, 0xf2, 0x83, 0x98,
+    0xb2, 0xa3, 0x86, 0x2a, 0x0a, 0x6a, 0x88, 0x4b, 0x2c, 0xa8, 0x22, 0xb9, 0xb4, 0xb4, 0x7a, 0x0b,
+    0xb2, 0x12, 0x9a, 0x03, 0x0a, 0x1b, 0x07, 0x0f, 0x20, 0x8a, 0xb3, 0xa5, 0x82, 0x4b, 0x8a, 0x59,
+    0x98, 0xb2, 0xa1, 0x42, 0xab, 0x40, 0x5b, 0x3d, 0x19, 0xaa, 0x30, 0x0d, 0x04, 0x88, 0x19, 0x89,
+    0xc9, 0x10, 0xc2, 0x97, 0x01, 0x3b, 0xd1, 0x38, 0x91, 0x1a, 0x1b, 0x41, 0x4e, 0x4b, 0x80, 0x08,
+    0x80, 0x08, 0x80, 0x08, 0x08, 0x80, 0x08, 0x80, 0x08, 0x08, 0x08, 0x08, 0x08, 0x80, 0x80, 0x80,
+};
+
+static const AudioSample sample_snare = {
+    sample_snare_data, 1984, 11025, 0, 0, 256, SAMPLE_IMA_ADPCM
+};
@@ -31,6 +31,13 @@ public:
   
   // Backlight control (0-255)
   void setBacklight(uint8_t brightness);
+  
+  // Power saving for a mostly black, still picture. Idle mode shows 8
+  // colours (the top bit of R, G and B). Partial mode only scans the gate
+  // lines of a band of columns (in landscape they run along x), the rest
+  // of the screen is black. w = 0 scans the whole screen again.
+  void idleMode(bool on);
+  void partialArea(int16_t x, int16_t w);
 
 protected:
   void tftInit() override;
@@ -0,0 +1,284 @@
+#include "flashlog.h"
+#include "flashstore.h"
+
+#define FLASHLOG_MAGIC  0x4C53  // "SL"
+
+// Start of every page. base holds the first record of the page, the
+// delta records follow right after the used part of base.
+struct FlashLogPage {
+  uint16_t magic;
+  uint8_t channels;
+  uint8_t count;       // records, the base one included
+  uint32_t seq;        // goes up by one per page written
+  uint32_t time;       // first record
+  uint32_t last_time;  // last record
+  int32_t base[FLASHLOG_MAX_CHANNELS];
+};
+
+#define PAGES_PER_SECTOR  (FLASH_STORE_SECTOR / FLASH_STORE_PAGE)
+#define NO_PAGE           0xFFFFFFFF
+
+static uint8_t logChannels = 0;
+static uint32_t logCapacity = 0;  // pages
+static uint32_t logHead = 0;      // next page to write
+static uint32_t logOldest = 0;    // oldest page with records
+static uint32_t logPages = 0;     // pages with records from logOldest on
+static uint32_t logSeq = 1;
+static uint32_t logRecords = 0;
+static uint32_t logErased = NO_PAGE;  // sector ahead of the head known blank
+
+// Page being filled
+static uint8_t ramPage[FLASH_STORE_PAGE] __attribute__((aligned(4)));
+static uint16_t ramUsed = 0;
+static int32_t ramPrev[FLASHLOG_MAX_CHANNELS];
+static uint32_t ramPrevTime = 0;
+
+static uint16_t headerSize(uint8_t channels) {
+  return offsetof(FlashLogPage, base) + channels * sizeof(int32_t);
+}
+
+static const FlashLogPage *flashPage(uint32_t page) {
+  return (const FlashLogPage *)flashStoreData(page * FLASH_STORE_PAGE);
+}
+
+static bool pageValid(const FlashLogPage *p) {
+  return p->magic == FLASHLOG_MAGIC && p->channels == logChannels && p->count > 0;
+}
+
+// Page at position index counted from the oldest one
+static const FlashLogPage *logPage(uint32_t index) {
+  return flashPage((logOldest + index) % logCapacity);
+}
+
+static uint8_t putVarint(uint8_t *out, uint32_t v) {
+  uint8_t n = 0;
+  while (v >= 0x80) {
+    out[n++] = (uint8_t)(v | 0x80);
+    v >>= 7;
+  }
+  out[n++] = (uint8_t)v;
+  return n;
+}
+
+static uint32_t getVarint(const uint8_t *&in, const uint8_t *end) {
+  uint32_t v = 0;
+  for (uint8_t shift = 0; in < end && shift < 35; shift += 7) {
+    uint8_t b = *in++;
+    v |= (uint32_t)(b & 0x7F) << shift;
+    if (!(b & 0x80)) break;
+  }
+  return v;
+}
+
+static inline uint32_t zigzag(int32_t v) {
+  return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static inline int32_t unzigzag(uint32_t v) {
+  return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+bool flashLogBegin(uint8_t channels, uint32_t reserve) {
+  if (channels == 0 || channels > FLASHLOG_MAX_CHANNELS) return false;
+  if (!flashStoreBegin()) return false;
+  reserve = (reserve + FLASH_STORE_SECTOR - 1) & ~(FLASH_STORE_SECTOR - 1);
+  if (flashStoreSize() < reserve + FLASH_STORE_SECTOR) return false;
+  logChannels = channels;
+  logCapacity = (flashStoreSize() - reserve) / FLASH_STORE_PAGE;
+  
+  // Newest page is the one with the highest sequence number, any channel
+  // count, so new pages always get a higher one
+  uint32_t newest = 0;
+  uint32_t maxSeq = 0;
+  bool found = false;
+  for (uint32_t i = 0; i < logCapacity; i++) {
+    const FlashLogPage *p = flashPage(i);
+    if (p->magic != FLASHLOG_MAGIC) continue;
+    if (!found || p->seq > maxSeq) {
+      maxSeq = p->seq;
+      newest = i;
+      found = true;
+    }
+  }
+  
+  logPages = 0;
+  logRecords = 0;
+  if (found) {
+    logHead = (newest + 1) % logCapacity;
+    logSeq = maxSeq + 1;
+    // Walk back from the newest page while the pages keep going
+    uint32_t page = newest;
+    uint32_t seq = maxSeq;
+    while (logPages < logCapacity) {
+      const FlashLogPage *p = flashPage(page);
+      if (!pageValid(p) || p->seq != seq) break;
+      logRecords += p->count;
+      logPages++;
+      logOldest = page;
+      page = (page + logCapacity - 1) % logCapacity;
+      seq--;
+    }
+  } else {
+    logHead = 0;
+    logSeq = 1;
+  }
+  if (logPages == 0) logOldest = logHead;
+  
+  logErased = NO_PAGE;
+  ramUsed = 0;
+  return true;
+}
+
+// Makes the sector starting at page blank, which drops its pages off the
+// old end
+static bool eraseSector(uint32_t page) {
+  while (logPages > 0 && (logOldest + logCapacity - page) % logCapacity < PAGES_PER_SECTOR) {
+    logRecords -= logPage(0)->count;
+    logOldest = (logOldest + 1) % logCapacity;
+    logPages--;
+  }
+  logErased = page;
+  if (flashStoreBlank(page * FLASH_STORE_PAGE, FLASH_STORE_SECTOR)) return false;
+  flashStoreErase(page * FLASH_STORE_PAGE);
+  return true;
+}
+
+bool flashLogEraseAhead() {
+  if (logChannels == 0) return false;
+  // First page of the sector the head is in or goes into next
+  uint32_t page = (logHead + PAGES_PER_SECTOR - 1) / PAGES_PER_SECTOR * PAGES_PER_SECTOR % logCapacity;
+  if (page == logErased) return false;
+  // A ring of one sector has nothing ahead
+  if (logHead % PAGES_PER_SECTOR && page / PAGES_PER_SECTOR == logHead / PAGES_PER_SECTOR) return false;
+  return eraseSector(page);
+}
+
+static void writeRamPage() {
+  if (ramUsed == 0) return;
+  
+  // Entering a new sector, unless flashLogEraseAhead() got to it first
+  if (logHead % PAGES_PER_SECTOR == 0 && logHead != logErased) eraseSector(logHead);
+  if (logHead == logErased) logErased = NO_PAGE;
+  
+  FlashLogPage *p = (FlashLogPage *)ramPage;
+  p->seq = logSeq++;
+  p->last_time = ramPrevTime;
+  memset(ramPage + ramUsed, 0xFF, FLASH_STORE_PAGE - ramUsed);
+  flashStoreProgram(logHead * FLASH_STORE_PAGE, ramPage);
+  
+  if (logPages == 0) logOldest = logHead;
+  logPages++;
+  logRecords += p->count;
+  logHead = (logHead + 1) % logCapacity;
+  ramUsed = 0;
+}
+
+bool flashLogAppend(uint32_t time, const int32_t *values) {
+  if (logChannels == 0) return false;
+  FlashLogPage *p = (FlashLogPage *)ramPage;
+  
+  if (ramUsed > 0) {
+    uint8_t rec[5 + FLASHLOG_MAX_CHANNELS * 5];
+    uint8_t len = putVarint(rec, time - ramPrevTime);
+    for (uint8_t c = 0; c < logChannels; c++) {
+      len += putVarint(rec + len, zigzag(values[c] - ramPrev[c]));
+    }
+    
+    if (ramUsed + len <= FLASH_STORE_PAGE && p->count < 255) {
+      memcpy(ramPage + ramUsed, rec, len);
+      ramUsed += len;
+      p->count++;
+      memcpy(ramPrev, values, logChannels * sizeof(int32_t));
+      ramPrevTime = time;
+      return true;
+    }
+    writeRamPage();
+  }
+  
+  // First record of a page goes into the header as is
+  p->magic = FLASHLOG_MAGIC;
+  p->channels = logChannels;
+  p->count = 1;
+  p->time = time;
+  memcpy(p->base, values, logChannels * sizeof(int32_t));
+  ramUsed = headerSize(logChannels);
+  memcpy(ramPrev, values, logChannels * sizeof(int32_t));
+  ramPrevTime = time;
+  return true;
+}
+
+void flashLogFlush() {
+  writeRamPage();
+}
+
+void flashLogGetStats(FlashLogStats &stats) {
+  const FlashLogPage *ram = (const FlashLogPage *)ramPage;
+  stats.pages = logPages;
+  stats.capacity = logCapacity;
+  stats.records = logRecords;
+  stats.pending = ramUsed ? ram->count : 0;
+  stats.oldest = logPages ? logPage(0)->time : (ramUsed ? ram->time : 0);
+  stats.newest = ramUsed ? ramPrevTime : (logPages ? logPage(logPages - 1)->last_time : 0);
+}
+
+// Decode one page and hand the records in range to the callback
+static uint32_t queryPage(const FlashLogPage *p, uint16_t used, uint32_t from, uint32_t to,
+                          FlashLogCallback callback, void *ctx) {
+  int32_t values[FLASHLOG_MAX_CHANNELS];
+  memcpy(values, p->base, p->channels * sizeof(int32_t));
+  uint32_t time = p->time;
+  const uint8_t *in = (const uint8_t *)p + headerSize(p->channels);
+  const uint8_t *end = (const uint8_t *)p + used;
+  uint32_t found = 0;
+  
+  for (uint8_t r = 0; r < p->count; r++) {
+    if (r > 0) {
+      time += getVarint(in, end);
+      for (uint8_t c = 0; c < p->channels; c++) {
+        values[c] += unzigzag(getVarint(in, end));
+      }
+    }
+    if (time > to) break;
+    if (time >= from) {
+      callback(time, values, p->channels, ctx);
+      found++;
+    }
+  }
+  return found;
+}
+
+uint32_t flashLogQuery(uint32_t from, uint32_t to, FlashLogCallback callback, void *ctx) {
+  // First page whose last record is not before from
+  uint32_t lo = 0, hi = logPages;
+  while (lo < hi) {
+    uint32_t mid = (lo + hi) / 2;
+    if (logPage(mid)->last_time < from) lo = mid + 1;
+    else hi = mid;
+  }
+  
+  uint32_t found = 0;
+  for (uint32_t i = lo; i < logPages; i++) {
+    const FlashLogPage *p = logPage(i);
+    if (p->time > to) return found;
+    found += queryPage(p, FLASH_STORE_PAGE, from, to, callback, ctx);
+  }
+  if (ramUsed > 0) {
+    found += queryPage((const FlashLogPage *)ramPage, ramUsed, from, to, callback, ctx);
+  }
+  return found;
+}
+
+static void exportRecord(uint32_t time, const int32_t *values, uint8_t channels, void *ctx) {
+  Print &out = *(Print *)ctx;
+  out.print(time);
+  for (uint8_t c = 0; c < channels; c++) {
+    out.print(',');
+    out.print(values[c]);
+  }
+  out.println();
+}
+
+uint32_t flashLogExport(Print &out, uint32_t from, uint32_t to, const char *header) {
+  out.println(header);
+  return flashLogQuery(from, to, exportRecord, &out);
+}
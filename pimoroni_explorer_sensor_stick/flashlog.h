@@ -0,0 +1,58 @@
+#ifndef _FLASHLOG_H_
+#define _FLASHLOG_H_
+
+#include <Arduino.h>
+
+// Time series logger on top of flashstore. Records are a timestamp plus a
+// fixed number of int32 channels (scaled readings, e.g. 0.01 C). They are
+// packed into 256 byte pages in RAM: the first record of a page is stored
+// in full in the page header, every following one as zigzag varint deltas
+// to the one before, so slow changing readings take a byte per channel.
+// Full pages are programmed into the flash area as a ring, oldest sector
+// erased when the ring wraps, which spreads the wear over the whole area.
+// Appending only touches RAM, the flash is programmed once per page. The
+// sector the ring goes into next is erased ahead by flashLogEraseAhead(),
+// so writing a page doesn't stall for the ~50 ms of an erase too.
+
+#define FLASHLOG_MAX_CHANNELS  10
+
+struct FlashLogStats {
+  uint32_t pages;      // pages holding records
+  uint32_t capacity;   // pages in the flash area
+  uint32_t records;    // records in the flash pages
+  uint16_t pending;    // records still in the RAM page
+  uint32_t oldest;     // time of the oldest record, 0 when empty
+  uint32_t newest;     // time of the newest record
+};
+
+typedef void (*FlashLogCallback)(uint32_t time, const int32_t *values, uint8_t channels, void *ctx);
+
+// Finds the pages of an earlier run. Pages written with another number
+// of channels are ignored and get overwritten in time. reserve bytes at the
+// end of the area (rounded up to whole sectors) are left to someone else.
+bool flashLogBegin(uint8_t channels, uint32_t reserve = 0);
+
+// Times should not go down, queries rely on the pages being in time order
+bool flashLogAppend(uint32_t time, const int32_t *values);
+
+// Erases the sector the ring goes into next, unless that was done already
+// or it reads as blank. The pages in it drop off the old end now. Call it
+// from a low priority task, true when it erased (~50 ms with the other
+// core stopped). Without it the sector is erased when the first page
+// goes in.
+bool flashLogEraseAhead();
+
+// Write the RAM page now, even if it is not full (the rest of it stays
+// unused)
+void flashLogFlush();
+
+void flashLogGetStats(FlashLogStats &stats);
+
+// All records with from <= time <= to, oldest first, RAM page included.
+// Pages are found with a binary search on their header. Returns the count.
+uint32_t flashLogQuery(uint32_t from, uint32_t to, FlashLogCallback callback, void *ctx);
+
+// Same as CSV lines "time,ch0,ch1,..." after the given header line
+uint32_t flashLogExport(Print &out, uint32_t from, uint32_t to, const char *header);
+
+#endif
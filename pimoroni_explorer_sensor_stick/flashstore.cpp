@@ -0,0 +1,54 @@
+#include "flashstore.h"
+#include "hardware/flash.h"
+
+// Set up by the arduino-pico linker script around the FS area
+extern uint8_t _FS_start;
+extern uint8_t _FS_end;
+
+static const uint8_t *storeBase = NULL;
+static uint32_t storeOffset = 0;  // from the start of the flash chip
+static uint32_t storeSize = 0;
+
+bool flashStoreBegin() {
+  storeBase = &_FS_start;
+  storeOffset = (uint32_t)((uintptr_t)&_FS_start - XIP_BASE);
+  storeSize = (uint32_t)(&_FS_end - &_FS_start);
+  // Whole sectors only
+  storeSize &= ~(FLASH_STORE_SECTOR - 1);
+  return storeSize >= FLASH_STORE_SECTOR;
+}
+
+uint32_t flashStoreSize() {
+  return storeSize;
+}
+
+const uint8_t *flashStoreData(uint32_t offset) {
+  return storeBase + offset;
+}
+
+void flashStoreErase(uint32_t offset) {
+  if (offset >= storeSize) return;
+  rp2040.idleOtherCore();
+  noInterrupts();
+  flash_range_erase(storeOffset + offset, FLASH_STORE_SECTOR);
+  interrupts();
+  rp2040.resumeOtherCore();
+}
+
+bool flashStoreBlank(uint32_t offset, uint32_t size) {
+  if (offset >= storeSize || size > storeSize - offset) return false;
+  const uint32_t *word = (const uint32_t *)(storeBase + offset);
+  for (uint32_t i = 0; i < size / 4; i++) {
+    if (word[i] != 0xFFFFFFFF) return false;
+  }
+  return true;
+}
+
+void flashStoreProgram(uint32_t offset, const uint8_t *data) {
+  if (offset >= storeSize) return;
+  rp2040.idleOtherCore();
+  noInterrupts();
+  flash_range_program(storeOffset + offset, data, FLASH_STORE_PAGE);
+  interrupts();
+  rp2040.resumeOtherCore();
+}
@@ -0,0 +1,30 @@
+#ifndef _FLASHSTORE_H_
+#define _FLASHSTORE_H_
+
+#include <Arduino.h>
+
+// Raw access to the flash area arduino-pico reserves for a filesystem
+// (Tools > Flash Size, the "FS" part), without LittleFS on top. Don't use
+// LittleFS in the same sketch. Reads are plain memory reads through XIP,
+// erasing and programming pause the other core and interrupts for the
+// time the flash is busy (~0.5 ms per page, ~50 ms per sector).
+
+#define FLASH_STORE_PAGE    256
+#define FLASH_STORE_SECTOR  4096
+
+// False when the board was built without an FS area
+bool flashStoreBegin();
+uint32_t flashStoreSize();
+
+// Pointer to offset in the area, valid for reads only
+const uint8_t *flashStoreData(uint32_t offset);
+
+// offset must be sector aligned
+void flashStoreErase(uint32_t offset);
+// True when it reads as erased (all 0xFF), so erasing it again can be
+// skipped. offset and size multiples of 4.
+bool flashStoreBlank(uint32_t offset, uint32_t size);
+// Program one page, offset page aligned, data must be in RAM
+void flashStoreProgram(uint32_t offset, const uint8_t *data);
+
+#endif
@@ -0,0 +1,1118 @@
+#include "i2csim.h"
+#include <Arduino.h>
+#include <Wire.h>
+#include <stdarg.h>
+#include <algorithm>
+#include "pico/time.h"
+
+// ═══════════════════════════════════════════════════════════
+// Clock, timers and pins
+// ═══════════════════════════════════════════════════════════
+
+static uint64_t nowUs = 0;
+static std::vector<repeating_timer_t *> timers;
+
+struct SimAlarm {
+  alarm_id_t id;
+  uint64_t at_us;
+  alarm_callback_t callback;
+  void *user_data;
+};
+static std::vector<SimAlarm> alarms;
+static alarm_id_t lastAlarmId = 0;
+static std::vector<SimDevice *> devices;
+
+static bool asyncPending = false;
+static uint64_t asyncDoneUs = 0;
+
+struct SimPin {
+  int pin;
+  void (*isr)(void);
+};
+static std::vector<SimPin> pins;
+static std::vector<int> lowPins;  // inputs are pulled up
+
+uint64_t simNow() {
+  return nowUs;
+}
+
+// Time of the earliest thing due: a timer, an alarm, the end of the DMA
+// transfer or a device
+static uint64_t nextEvent(repeating_timer_t *&timer, int &alarm, SimDevice *&device) {
+  uint64_t next = UINT64_MAX;
+  timer = NULL;
+  alarm = -1;
+  device = NULL;
+  for (repeating_timer_t *rt : timers) {
+    if (rt->next_us < next) {
+      next = rt->next_us;
+      timer = rt;
+    }
+  }
+  for (size_t i = 0; i < alarms.size(); i++) {
+    if (alarms[i].at_us < next) {
+      next = alarms[i].at_us;
+      timer = NULL;
+      alarm = i;
+    }
+  }
+  if (asyncPending && asyncDoneUs < next) {
+    next = asyncDoneUs;
+    timer = NULL;
+    alarm = -1;
+  }
+  for (SimDevice *dev : devices) {
+    uint64_t at = dev->nextEvent();
+    if (at < next) {
+      next = at;
+      timer = NULL;
+      alarm = -1;
+      device = dev;
+    }
+  }
+  return next;
+}
+
+void simAdvanceTo(uint64_t t) {
+  static bool running = false;
+  if (running) {
+    // Waiting inside an interrupt handler, time can't run twice
+    fprintf(stderr, "i2csim: wait inside an interrupt at %llu us\n", (unsigned long long)nowUs);
+    abort();
+  }
+  running = true;
+  
+  while (true) {
+    repeating_timer_t *timer;
+    int alarm;
+    SimDevice *device;
+    uint64_t next = nextEvent(timer, alarm, device);
+    if (next > t) break;
+    
+    nowUs = next;
+    if (device) {
+      device->update(nowUs);
+    } else if (timer) {
+      timer->next_us += timer->delay_us;
+      if (!timer->callback(timer)) cancel_repeating_timer(timer);
+    } else if (alarm >= 0) {
+      SimAlarm a = alarms[alarm];
+      alarms.erase(alarms.begin() + alarm);
+      // Alarms fire on time here, so from now and from the due time (what
+      // the SDK counts a positive value from) are the same
+      int64_t again = a.callback(a.id, a.user_data);
+      if (again != 0) {
+        a.at_us = nowUs + (again > 0 ? again : -again);
+        alarms.push_back(a);
+      }
+    } else {
+      asyncPending = false;
+      Wire.completeAsync();
+    }
+  }
+  
+  if (t > nowUs) nowUs = t;
+  running = false;
+}
+
+void simAdvance(uint64_t us) {
+  simAdvanceTo(nowUs + us);
+}
+
+uint32_t millis() {
+  return (uint32_t)(nowUs / 1000);
+}
+
+uint32_t micros() {
+  return (uint32_t)nowUs;
+}
+
+void delay(uint32_t ms) {
+  simAdvance((uint64_t)ms * 1000);
+}
+
+void delayMicroseconds(uint32_t us) {
+  simAdvance(us);
+}
+
+void tight_loop_contents() {
+  simAdvance(1);
+}
+
+void __wfi() {
+  repeating_timer_t *timer;
+  int alarm;
+  SimDevice *device;
+  uint64_t next = nextEvent(timer, alarm, device);
+  if (next == UINT64_MAX) {
+    fprintf(stderr, "i2csim: WFI with nothing to wake it at %llu us\n", (unsigned long long)nowUs);
+    abort();
+  }
+  simAdvanceTo(next);
+}
+
+bool add_repeating_timer_us(int64_t delay_us, repeating_timer_callback_t callback, void *user_data,
+                            repeating_timer_t *out) {
+  if (delay_us < 0) delay_us = -delay_us;
+  if (delay_us == 0) return false;
+  out->delay_us = delay_us;
+  out->callback = callback;
+  out->user_data = user_data;
+  out->next_us = nowUs + delay_us;
+  timers.push_back(out);
+  return true;
+}
+
+bool cancel_repeating_timer(repeating_timer_t *timer) {
+  auto it = std::find(timers.begin(), timers.end(), timer);
+  if (it == timers.end()) return false;
+  timers.erase(it);
+  return true;
+}
+
+alarm_id_t add_alarm_in_us(uint64_t us, alarm_callback_t callback, void *user_data, bool fire_if_past) {
+  if (us == 0) {
+    if (!fire_if_past) return 0;
+    int64_t again = callback(0, user_data);
+    if (again <= 0) return 0;
+    us = again;
+  }
+  alarms.push_back({ ++lastAlarmId, nowUs + us, callback, user_data });
+  return lastAlarmId;
+}
+
+bool cancel_alarm(alarm_id_t alarm_id) {
+  for (size_t i = 0; i < alarms.size(); i++) {
+    if (alarms[i].id == alarm_id) {
+      alarms.erase(alarms.begin() + i);
+      return true;
+    }
+  }
+  return false;
+}
+
+void pinMode(int pin, int mode) {
+  (void)pin;
+  (void)mode;
+}
+
+void attachInterrupt(int pin, void (*isr)(void), int mode) {
+  (void)mode;
+  detachInterrupt(pin);
+  pins.push_back({ pin, isr });
+}
+
+void detachInterrupt(int pin) {
+  for (size_t i = 0; i < pins.size(); i++) {
+    if (pins[i].pin == pin) {
+      pins.erase(pins.begin() + i);
+      return;
+    }
+  }
+}
+
+void simPinRaise(int pin) {
+  for (const SimPin &p : pins) {
+    if (p.pin == pin) p.isr();
+  }
+}
+
+int digitalRead(int pin) {
+  return std::find(lowPins.begin(), lowPins.end(), pin) == lowPins.end() ? HIGH : LOW;
+}
+
+void simPinSet(int pin, int level) {
+  if (digitalRead(pin) == level) return;
+  if (level == LOW) lowPins.push_back(pin);
+  else lowPins.erase(std::find(lowPins.begin(), lowPins.end(), pin));
+  simPinRaise(pin);
+}
+
+// ═══════════════════════════════════════════════════════════
+// Serial
+// ═══════════════════════════════════════════════════════════
+
+SimSerial Serial;
+SimRP2040 rp2040;
+
+size_t Print::printf(const char *format, ...) {
+  char buf[256];
+  va_list args;
+  va_start(args, format);
+  int len = vsnprintf(buf, sizeof(buf), format, args);
+  va_end(args);
+  if (len < 0) return 0;
+  if (len >= (int)sizeof(buf)) len = sizeof(buf) - 1;
+  return write((const uint8_t *)buf, len);
+}
+
+size_t SimSerial::write(uint8_t c) {
+  if (echo && c != '\r') putchar(c);
+  return 1;
+}
+
+int SimSerial::read() {
+  if (input.empty()) return -1;
+  int c = (uint8_t)input[0];
+  input.erase(0, 1);
+  return c;
+}
+
+// ═══════════════════════════════════════════════════════════
+// Bus
+// ═══════════════════════════════════════════════════════════
+
+TwoWire Wire;
+
+static SimBusStats busStats;
+// Register pointer of every address, kept across transactions
+static uint8_t regPointer[128];
+// Inside a transaction that ended without STOP
+static bool repeatedStart = false;
+
+void simBusAttach(SimDevice *dev) {
+  devices.push_back(dev);
+}
+
+void simBusDetach(SimDevice *dev) {
+  auto it = std::find(devices.begin(), devices.end(), dev);
+  if (it != devices.end()) devices.erase(it);
+}
+
+void simBusResetStats() {
+  memset(&busStats, 0, sizeof(busStats));
+}
+
+SimBusStats simBusStats() {
+  return busStats;
+}
+
+static SimDevice *findDevice(uint8_t addr) {
+  for (SimDevice *dev : devices) {
+    if (dev->addr == addr) return dev;
+  }
+  return NULL;
+}
+
+// Bus time of a segment: START/repeated START, address, bytes with ACK
+static uint64_t segmentUs(size_t bytes, uint32_t clock) {
+  return ((1 + bytes) * 9 + 2) * 1000000ull / clock;
+}
+
+static void countSegment(size_t bytes, bool stop) {
+  busStats.bytes += 1 + bytes;
+  if (!repeatedStart) busStats.transactions++;
+  repeatedStart = !stop;
+}
+
+// First byte of a write sets the register pointer, the rest are data
+static bool busWrite(uint8_t addr, const uint8_t *data, size_t len) {
+  SimDevice *dev = findDevice(addr);
+  if (!dev) return false;
+  dev->update(nowUs);
+  if (len == 0) return true;
+  uint8_t &reg = regPointer[addr & 0x7F];
+  reg = data[0];
+  for (size_t i = 1; i < len; i++) {
+    dev->write(reg, data[i]);
+  }
+  return true;
+}
+
+static bool busRead(uint8_t addr, uint8_t *data, size_t len) {
+  SimDevice *dev = findDevice(addr);
+  if (!dev) return false;
+  dev->update(nowUs);
+  uint8_t &reg = regPointer[addr & 0x7F];
+  for (size_t i = 0; i < len; i++) {
+    data[i] = dev->read(reg);
+  }
+  return true;
+}
+
+// Blocking transfers hold the CPU for as long as the bus is busy
+static void blockFor(uint64_t us) {
+  busStats.busy_us += us;
+  busStats.blocked_us += us;
+  simAdvance(us);
+}
+
+TwoWire::TwoWire()
+  : clock(100000), txAddr(0), txLen(0), rxLen(0), rxPos(0), asyncWrite(NULL), asyncWriteLen(0),
+    asyncRead(NULL), asyncReadLen(0), asyncAddr(0), asyncCallback(NULL) {}
+
+void TwoWire::beginTransmission(uint8_t addr) {
+  txAddr = addr;
+  txLen = 0;
+}
+
+size_t TwoWire::write(uint8_t value) {
+  if (txLen >= sizeof(txBuf)) return 0;
+  txBuf[txLen++] = value;
+  return 1;
+}
+
+size_t TwoWire::write(const uint8_t *data, size_t len) {
+  size_t n = 0;
+  while (n < len && write(data[n])) n++;
+  return n;
+}
+
+uint8_t TwoWire::endTransmission(bool stop) {
+  countSegment(txLen, stop);
+  bool ack = busWrite(txAddr, txBuf, txLen);
+  blockFor(segmentUs(ack ? txLen : 0, clock));
+  if (!ack) {
+    busStats.nacks++;
+    repeatedStart = false;
+    return 2;
+  }
+  return 0;
+}
+
+size_t TwoWire::requestFrom(uint8_t addr, size_t len, bool stop) {
+  if (len > sizeof(rxBuf)) len = sizeof(rxBuf);
+  countSegment(len, stop);
+  rxPos = 0;
+  rxLen = busRead(addr, rxBuf, len) ? len : 0;
+  blockFor(segmentUs(rxLen, clock));
+  if (rxLen == 0) {
+    busStats.nacks++;
+    repeatedStart = false;
+  }
+  return rxLen;
+}
+
+int TwoWire::available() {
+  return (int)(rxLen - rxPos);
+}
+
+int TwoWire::read() {
+  if (rxPos >= rxLen) return -1;
+  return rxBuf[rxPos++];
+}
+
+// The transfer happens when it finishes, so a device sees it at the time
+// the last byte goes over the bus. A device that does not answer never
+// calls back, like a DMA transfer stuck on a NACK, and needs an abort.
+bool TwoWire::writeReadAsync(uint8_t addr, const void *wbuffer, size_t wbytes, const void *rbuffer, size_t rbytes,
+                             bool stop) {
+  (void)stop;
+  if (asyncPending) return false;
+  asyncAddr = addr;
+  asyncWrite = (const uint8_t *)wbuffer;
+  asyncWriteLen = wbytes;
+  asyncRead = (uint8_t *)rbuffer;
+  asyncReadLen = rbytes;
+  
+  uint64_t us = segmentUs(wbytes, clock) + (rbytes ? segmentUs(rbytes, clock) : 0);
+  busStats.transactions++;
+  busStats.async++;
+  busStats.bytes += 1 + wbytes + (rbytes ? 1 + rbytes : 0);
+  busStats.busy_us += us;
+  if (!findDevice(addr)) {
+    busStats.nacks++;
+    return true;
+  }
+  asyncPending = true;
+  asyncDoneUs = nowUs + us;
+  return true;
+}
+
+bool TwoWire::writeAsync(uint8_t addr, const void *buffer, size_t bytes, bool stop) {
+  return writeReadAsync(addr, buffer, bytes, NULL, 0, stop);
+}
+
+bool TwoWire::readAsync(uint8_t addr, void *buffer, size_t bytes, bool stop) {
+  return writeReadAsync(addr, NULL, 0, buffer, bytes, stop);
+}
+
+bool TwoWire::finishedAsync() {
+  return !asyncPending;
+}
+
+void TwoWire::abortAsync() {
+  asyncPending = false;
+}
+
+void TwoWire::completeAsync() {
+  if (asyncWriteLen) busWrite(asyncAddr, asyncWrite, asyncWriteLen);
+  if (asyncReadLen) busRead(asyncAddr, asyncRead, asyncReadLen);
+  if (asyncCallback) asyncCallback();
+}
+
+// ═══════════════════════════════════════════════════════════
+// Waveforms
+// ═══════════════════════════════════════════════════════════
+
+// Repeatable noise, every run sees the same
+static double gaussian() {
+  static uint64_t state = 0x853c49e6748fea9bull;
+  double u[2];
+  for (int i = 0; i < 2; i++) {
+    state = state * 6364136223846793005ull + 1442695040888963407ull;
+    u[i] = ((state >> 11) + 0.5) / 9007199254740992.0;
+  }
+  return sqrt(-2.0 * log(u[0])) * cos(2.0 * PI * u[1]);
+}
+
+SimEnvScript::SimEnvScript() : temperature_noise(0), pressure_noise(0), humidity_noise(0) {}
+
+void SimEnvScript::add(double t, const SimEnv &env) {
+  times.push_back(t);
+  frames.push_back(env);
+}
+
+double SimEnvScript::duration() const {
+  return times.empty() ? 0 : times.back();
+}
+
+SimEnv SimEnvScript::at(double t) const {
+  if (frames.empty()) return { 21.0, 101325.0, 45.0, 300.0, 0.25, 0 };
+  if (t <= times[0]) return frames[0];
+  if (t >= times.back()) return frames.back();
+  
+  size_t i = std::upper_bound(times.begin(), times.end(), t) - times.begin();
+  double f = (t - times[i - 1]) / (times[i] - times[i - 1]);
+  const SimEnv &a = frames[i - 1];
+  const SimEnv &b = frames[i];
+  SimEnv e;
+  e.temperature = a.temperature + (b.temperature - a.temperature) * f;
+  e.pressure = a.pressure + (b.pressure - a.pressure) * f;
+  e.humidity = a.humidity + (b.humidity - a.humidity) * f;
+  e.lux = a.lux + (b.lux - a.lux) * f;
+  e.ir_ratio = a.ir_ratio + (b.ir_ratio - a.ir_ratio) * f;
+  e.proximity = a.proximity + (b.proximity - a.proximity) * f;
+  return e;
+}
+
+bool SimEnvScript::load(const char *path) {
+  FILE *f = fopen(path, "r");
+  if (!f) {
+    fprintf(stderr, "Cannot open %s\n", path);
+    return false;
+  }
+  
+  // Column index to the field it fills and the scale to its unit
+  enum { COL_NONE, COL_TEMP, COL_PRESS, COL_HUM, COL_LUX, COL_PROX };
+  std::vector<int> field;
+  std::vector<double> scale;
+  double start = 0;
+  char line[512];
+  bool header = true;
+  SimEnv env = at(0);
+  times.clear();
+  frames.clear();
+  
+  while (fgets(line, sizeof(line), f)) {
+    if (line[0] == '#' || line[0] == '\n' || line[0] == '\r') continue;
+    if (header) {
+      // Export of the sketches: "Log: 1234 records" lines come first
+      if (!strchr(line, ',')) continue;
+      for (char *name = strtok(line, ",\r\n"); name; name = strtok(NULL, ",\r\n")) {
+        int col = COL_NONE;
+        double s = 1;
+        if (strcmp(name, "temp_cC") == 0) col = COL_TEMP, s = 0.01;
+        else if (strcmp(name, "temp_C") == 0) col = COL_TEMP;
+        else if (strcmp(name, "pressure_Pa") == 0) col = COL_PRESS;
+        else if (strcmp(name, "pressure_hPa") == 0) col = COL_PRESS, s = 100;
+        else if (strcmp(name, "humidity_c%") == 0) col = COL_HUM, s = 0.01;
+        else if (strcmp(name, "humidity") == 0) col = COL_HUM;
+        else if (strcmp(name, "lux_x10") == 0) col = COL_LUX, s = 0.1;
+        else if (strcmp(name, "lux") == 0) col = COL_LUX;
+        else if (strcmp(name, "proximity") == 0) col = COL_PROX;
+        field.push_back(col);
+        scale.push_back(s);
+      }
+      header = false;
+      continue;
+    }
+    
+    double t = 0;
+    size_t col = 0;
+    for (char *v = strtok(line, ",\r\n"); v; v = strtok(NULL, ",\r\n"), col++) {
+      double x = atof(v);
+      if (col == 0) {
+        if (frames.empty()) start = x;
+        t = x - start;
+        continue;
+      }
+      if (col >= field.size()) break;
+      x *= scale[col];
+      switch (field[col]) {
+        case COL_TEMP: env.temperature = x; break;
+        case COL_PRESS: env.pressure = x; break;
+        case COL_HUM: env.humidity = x; break;
+        case COL_LUX: env.lux = x; break;
+        case COL_PROX: env.proximity = x; break;
+      }
+    }
+    if (col > 1) add(t, env);
+  }
+  fclose(f);
+  
+  if (frames.empty()) {
+    fprintf(stderr, "No data in %s\n", path);
+    return false;
+  }
+  return true;
+}
+
+SimMotionScript::SimMotionScript()
+  : roll_deg(25), pitch_deg(15), roll_s(4), pitch_s(6), yaw_dps(10), gyro_noise(0), accel_noise(0), rate(0) {}
+
+bool SimMotionScript::load(const char *path) {
+  FILE *f = fopen(path, "r");
+  if (!f) {
+    fprintf(stderr, "Cannot open %s\n", path);
+    return false;
+  }
+  char line[256];
+  trace.clear();
+  while (fgets(line, sizeof(line), f)) {
+    float r;
+    int v[6];
+    if (sscanf(line, "# rate %f", &r) == 1) {
+      rate = r;
+    } else if (sscanf(line, "%d,%d,%d,%d,%d,%d", &v[0], &v[1], &v[2], &v[3], &v[4], &v[5]) == 6) {
+      for (int i = 0; i < 6; i++) trace.push_back((int16_t)v[i]);
+    }
+  }
+  fclose(f);
+  if (trace.empty() || rate <= 0) {
+    fprintf(stderr, "%s is not an IMU trace\n", path);
+    return false;
+  }
+  return true;
+}
+
+bool SimMotionScript::recorded(double t, int16_t raw[6]) const {
+  if (trace.empty()) return false;
+  size_t i = (size_t)(t * rate);
+  if (i * 6 >= trace.size()) return false;
+  memcpy(raw, &trace[i * 6], 6 * sizeof(int16_t));
+  return true;
+}
+
+// Tilt back and forth around X and Y while turning around Z. Gyro from
+// the Euler rates, accel is gravity seen from the tilted board.
+SimMotion SimMotionScript::at(double t) const {
+  double wr = 2 * PI / roll_s, wp = 2 * PI / pitch_s;
+  SimMotion m;
+  m.roll = roll_deg * DEG_TO_RAD * sin(wr * t);
+  m.pitch = pitch_deg * DEG_TO_RAD * sin(wp * t);
+  m.yaw = fmod(yaw_dps * DEG_TO_RAD * t + PI, 2 * PI) - PI;
+  double droll = roll_deg * DEG_TO_RAD * wr * cos(wr * t);
+  double dpitch = pitch_deg * DEG_TO_RAD * wp * cos(wp * t);
+  double dyaw = yaw_dps * DEG_TO_RAD;
+  
+  double sr = sin(m.roll), cr = cos(m.roll), sp = sin(m.pitch), cp = cos(m.pitch);
+  m.gyro[0] = droll - dyaw * sp;
+  m.gyro[1] = dpitch * cr + dyaw * cp * sr;
+  m.gyro[2] = -dpitch * sr + dyaw * cp * cr;
+  m.accel[0] = -9.80665 * sp;
+  m.accel[1] = 9.80665 * sr * cp;
+  m.accel[2] = 9.80665 * cr * cp;
+  for (int i = 0; i < 3; i++) {
+    if (gyro_noise > 0) m.gyro[i] += gyro_noise * gaussian();
+    if (accel_noise > 0) m.accel[i] += accel_noise * gaussian();
+  }
+  return m;
+}
+
+// ═══════════════════════════════════════════════════════════
+// BME280
+// ═══════════════════════════════════════════════════════════
+
+// Datasheet example trimming plus typical humidity values
+const uint8_t simBme280Calib[26 + 7] = {
+  0x70, 0x6B, 0x43, 0x67, 0x18, 0xFC, 0x7D, 0x8E, 0x43, 0xD6, 0xD0, 0x0B, 0x27,
+  0x0B, 0x8C, 0x00, 0xF9, 0xFF, 0x8C, 0x3C, 0xF8, 0xC6, 0x70, 0x17, 0x00, 0x4B,
+  0x6A, 0x01, 0x00, 0x13, 0x29, 0x03, 0x1E,
+};
+
+static const uint8_t *bc = simBme280Calib;
+#define CAL_U16(i) ((double)(uint16_t)(bc[i] | (bc[i + 1] << 8)))
+#define CAL_S16(i) ((double)(int16_t)(bc[i] | (bc[i + 1] << 8)))
+
+// Floating point compensation, datasheet section 8.1
+double simBme280Temperature(int32_t adc_t, double &t_fine) {
+  double T1 = CAL_U16(0), T2 = CAL_S16(2), T3 = CAL_S16(4);
+  double v1 = (adc_t / 16384.0 - T1 / 1024.0) * T2;
+  double v2 = (adc_t / 131072.0 - T1 / 8192.0) * (adc_t / 131072.0 - T1 / 8192.0) * T3;
+  t_fine = v1 + v2;
+  return t_fine / 5120.0;
+}
+
+double simBme280Pressure(int32_t adc_p, double t_fine) {
+  double P1 = CAL_U16(6), P2 = CAL_S16(8), P3 = CAL_S16(10), P4 = CAL_S16(12), P5 = CAL_S16(14);
+  double P6 = CAL_S16(16), P7 = CAL_S16(18), P8 = CAL_S16(20), P9 = CAL_S16(22);
+  double v1 = t_fine / 2.0 - 64000.0;
+  double v2 = v1 * v1 * P6 / 32768.0;
+  v2 = v2 + v1 * P5 * 2.0;
+  v2 = v2 / 4.0 + P4 * 65536.0;
+  v1 = (P3 * v1 * v1 / 524288.0 + P2 * v1) / 524288.0;
+  v1 = (1.0 + v1 / 32768.0) * P1;
+  if (v1 == 0) return 0;
+  double p = 1048576.0 - adc_p;
+  p = (p - v2 / 4096.0) * 6250.0 / v1;
+  v1 = P9 * p * p / 2147483648.0;
+  v2 = p * P8 / 32768.0;
+  return p + (v1 + v2 + P7) / 16.0;
+}
+
+double simBme280Humidity(int32_t adc_h, double t_fine) {
+  double H1 = bc[25], H2 = CAL_S16(26), H3 = bc[28];
+  double H4 = (int16_t)((int8_t)bc[29] * 16 | (bc[30] & 0x0F));
+  double H5 = (int16_t)((int8_t)bc[31] * 16 | (bc[30] >> 4));
+  double H6 = (int8_t)bc[32];
+  double h = t_fine - 76800.0;
+  h = (adc_h - (H4 * 64.0 + H5 / 16384.0 * h)) *
+      (H2 / 65536.0 * (1.0 + H6 / 67108864.0 * h * (1.0 + H3 / 67108864.0 * h)));
+  h = h * (1.0 - H1 * h / 524288.0);
+  if (h > 100) h = 100;
+  if (h < 0) h = 0;
+  return h;
+}
+
+// The ADC value that compensates to the wanted value, by bisection:
+// temperature and humidity grow with their ADC value, pressure shrinks
+static int32_t bisect(double want, int32_t lo, int32_t hi, bool rising, double (*f)(int32_t, double), double arg) {
+  while (hi - lo > 1) {
+    int32_t mid = lo + (hi - lo) / 2;
+    if ((f(mid, arg) < want) == rising) lo = mid;
+    else hi = mid;
+  }
+  return lo;
+}
+
+static double tempOf(int32_t adc, double unused) {
+  (void)unused;
+  double t_fine;
+  return simBme280Temperature(adc, t_fine);
+}
+
+SimBME280::SimBME280(const SimEnvScript &script, uint8_t addr)
+  : SimDevice(addr), conversions(0), active_us(0), script(script), measure_start(0), measure_end(0),
+    normal_next(0), nvm_until(0), measuring(false), filt_t(0), filt_p(0), filt_valid(false) {
+  memset(regs, 0, sizeof(regs));
+  uint8_t reset = 0xB6;
+  uint8_t reg = 0xE0;
+  write(reg, reset);
+}
+
+static const uint8_t bmeSamples[8] = { 0, 1, 2, 4, 8, 16, 16, 16 };
+
+// Typical conversion time, datasheet section 9.1
+uint32_t SimBME280::measureUs() const {
+  uint8_t t = bmeSamples[regs[0xF4] >> 5];
+  uint8_t p = bmeSamples[(regs[0xF4] >> 2) & 7];
+  uint8_t h = bmeSamples[regs[0xF2] & 7];
+  uint32_t us = 1000 + 2000 * t;
+  if (p) us += 2000 * p + 500;
+  if (h) us += 2000 * h + 500;
+  return us;
+}
+
+uint32_t SimBME280::periodUs() const {
+  static const uint32_t standby[8] = { 500, 62500, 125000, 250000, 500000, 1000000, 10000, 20000 };
+  return measureUs() + standby[regs[0xF5] >> 5];
+}
+
+void SimBME280::convert(uint64_t at) {
+  SimEnv env = script.at(at / 1e6);
+  if (script.temperature_noise > 0) env.temperature += script.temperature_noise * gaussian();
+  if (script.pressure_noise > 0) env.pressure += script.pressure_noise * gaussian();
+  if (script.humidity_noise > 0) env.humidity += script.humidity_noise * gaussian();
+  
+  int32_t adc_t = bisect(env.temperature, 0, 1 << 20, true, tempOf, 0);
+  double t_fine;
+  simBme280Temperature(adc_t, t_fine);
+  int32_t adc_p = bisect(env.pressure, 0, 1 << 20, false, simBme280Pressure, t_fine);
+  int32_t adc_h = bisect(env.humidity, 0, 1 << 16, true, simBme280Humidity, t_fine);
+  
+  // 16 bit at 1x oversampling, one bit more per step up to 20 bit, and
+  // 20 bit with the IIR filter on
+  uint8_t osrs_t = regs[0xF4] >> 5, osrs_p = (regs[0xF4] >> 2) & 7, osrs_h = regs[0xF2] & 7;
+  uint8_t filter = (regs[0xF5] >> 2) & 7;
+  if (filter == 0) {
+    if (osrs_t) adc_t &= ~((1 << (5 - std::min<int>(osrs_t, 5))) - 1);
+    if (osrs_p) adc_p &= ~((1 << (5 - std::min<int>(osrs_p, 5))) - 1);
+  } else {
+    double coef = 1 << std::min<int>(filter, 4);
+    if (!filt_valid) {
+      filt_t = adc_t;
+      filt_p = adc_p;
+      filt_valid = true;
+    } else {
+      filt_t += (adc_t - filt_t) / coef;
+      filt_p += (adc_p - filt_p) / coef;
+    }
+    adc_t = (int32_t)lround(filt_t);
+    adc_p = (int32_t)lround(filt_p);
+  }
+  if (!osrs_t) adc_t = 0x80000;
+  if (!osrs_p) adc_p = 0x80000;
+  if (!osrs_h) adc_h = 0x8000;
+  
+  regs[0xF7] = adc_p >> 12;
+  regs[0xF8] = adc_p >> 4;
+  regs[0xF9] = (adc_p & 0x0F) << 4;
+  regs[0xFA] = adc_t >> 12;
+  regs[0xFB] = adc_t >> 4;
+  regs[0xFC] = (adc_t & 0x0F) << 4;
+  regs[0xFD] = adc_h >> 8;
+  regs[0xFE] = adc_h;
+  conversions++;
+  active_us += measureUs();
+}
+
+void SimBME280::update(uint64_t now) {
+  uint8_t mode = regs[0xF4] & 3;
+  if (mode == 1 || mode == 2) {
+    // Forced: one conversion, then back to sleep
+    if (measuring && now >= measure_end) {
+      convert(measure_end);
+      measuring = false;
+      regs[0xF4] &= ~3;
+    }
+  } else if (mode == 3) {
+    uint64_t period = periodUs();
+    // Long gaps: only the last few conversions matter for the filter
+    if (now > normal_next + 64 * period) {
+      normal_next += (now - normal_next) / period * period - 64 * period;
+    }
+    while (normal_next <= now) {
+      convert(normal_next);
+      normal_next += period;
+    }
+    measure_start = normal_next - period;
+    measure_end = measure_start + measureUs();
+  }
+  
+  // Status: measuring, im_update while the NVM is copied after a reset
+  uint8_t status = 0;
+  if (mode == 3 ? now >= measure_start && now < measure_end : measuring) status |= 0x08;
+  if (now < nvm_until) status |= 0x01;
+  regs[0xF3] = status;
+}
+
+uint8_t SimBME280::read(uint8_t &reg) {
+  uint8_t value = regs[reg];
+  reg++;
+  return value;
+}
+
+void SimBME280::write(uint8_t &reg, uint8_t value) {
+  uint64_t now = simNow();
+  switch (reg) {
+    case 0xE0:
+      if (value == 0xB6) {
+        // Power on state, the NVM copy takes ~2 ms
+        memset(regs, 0, sizeof(regs));
+        regs[0xD0] = 0x60;
+        memcpy(&regs[0x88], simBme280Calib, 26);
+        memcpy(&regs[0xE1], simBme280Calib + 26, 7);
+        regs[0xF7] = regs[0xFA] = regs[0xFD] = 0x80;
+        measuring = false;
+        filt_valid = false;
+        nvm_until = now + 2000;
+      }
+      break;
+    case 0xF2:
+      // Takes effect with the next ctrl_meas write
+      regs[0xF2] = (regs[0xF2] & 0xF8) | (value & 0x07);
+      break;
+    case 0xF4:
+      regs[0xF4] = value;
+      if ((value & 3) == 1 || (value & 3) == 2) {
+        measuring = true;
+        measure_start = now;
+        measure_end = now + measureUs();
+      } else if ((value & 3) == 3) {
+        measuring = false;
+        normal_next = now + measureUs();
+        measure_start = now;
+        measure_end = normal_next;
+      } else {
+        measuring = false;
+      }
+      break;
+    case 0xF5:
+      // Only written in sleep mode
+      if ((regs[0xF4] & 3) == 0) regs[0xF5] = value & 0xFD;
+      break;
+  }
+  reg++;
+}
+
+// ═══════════════════════════════════════════════════════════
+// LTR-559
+// ═══════════════════════════════════════════════════════════
+
+static const uint8_t ltrGain[8] = { 1, 2, 4, 8, 1, 1, 48, 96 };
+static const uint16_t ltrIntegration[8] = { 100, 50, 200, 400, 150, 250, 300, 350 };
+static const uint16_t ltrRepeat[8] = { 50, 100, 200, 500, 1000, 2000, 2000, 2000 };
+static const uint16_t ltrPsRepeat[16] = { 50, 70, 100, 200, 500, 1000, 2000, 2000,
+                                          10, 2000, 2000, 2000, 2000, 2000, 2000, 2000 };
+
+SimLTR559::SimLTR559(const SimEnvScript &script, uint8_t addr)
+  : SimDevice(addr), conversions(0), script(script), next_als(UINT64_MAX), next_ps(UINT64_MAX), clear_flags(0) {
+  memset(regs, 0, sizeof(regs));
+  regs[0x82] = 0x7F;
+  regs[0x83] = 0x01;
+  regs[0x84] = 0x02;
+  regs[0x85] = 0x03;
+  regs[0x86] = 0x92;
+  regs[0x87] = 0x05;
+}
+
+void SimLTR559::update(uint64_t now) {
+  // Called at the start of every transaction, so the status read in the
+  // same burst as the data still shows the flags
+  regs[0x8C] &= ~clear_flags;
+  clear_flags = 0;
+  
+  if ((regs[0x80] & 1) && next_als <= now) {
+    // Latest finished integration. The channels are counts for the lux
+    // formula of the driver, times gain and integration time.
+    uint8_t gain_code = (regs[0x80] >> 2) & 7;
+    uint16_t integration = ltrIntegration[(regs[0x85] >> 3) & 7];
+    uint64_t period = std::max(ltrRepeat[regs[0x85] & 7], integration) * 1000ull;
+    uint64_t at = next_als + (now - next_als) / period * period;
+    next_als = at + period;
+    
+    SimEnv env = script.at(at / 1e6);
+    double r = std::min(std::max(env.ir_ratio, 0.0), 0.99);
+    double k = r / (1 - r);
+    double c0, c1;
+    if (r < 0.45) c0 = 17743, c1 = -11059;
+    else if (r < 0.64) c0 = 42785, c1 = 19548;
+    else c0 = 5926, c1 = -1185;
+    double scale = ltrGain[gain_code] * integration / 100.0;
+    double ch0 = env.lux * 10000.0 / (c0 - k * c1) * scale;
+    double ch1 = ch0 * k;
+    uint16_t c0_counts = (uint16_t)std::min(lround(ch0), 65535l);
+    uint16_t c1_counts = (uint16_t)std::min(lround(ch1), 65535l);
+    // Saturated: the data invalid flag
+    uint8_t invalid = c0_counts == 65535 || c1_counts == 65535 ? 0x80 : 0;
+    regs[0x88] = c1_counts;
+    regs[0x89] = c1_counts >> 8;
+    regs[0x8A] = c0_counts;
+    regs[0x8B] = c0_counts >> 8;
+    regs[0x8C] = (regs[0x8C] & 0x03) | invalid | (gain_code << 4) | 0x04;
+    conversions++;
+  }
+  if ((regs[0x81] & 2) && next_ps <= now) {
+    uint64_t period = ltrPsRepeat[regs[0x84] & 15] * 1000ull;
+    uint64_t at = next_ps + (now - next_ps) / period * period;
+    next_ps = at + period;
+    SimEnv env = script.at(at / 1e6);
+    uint16_t ps = (uint16_t)std::min(std::max(lround(env.proximity), 0l), 2047l);
+    regs[0x8D] = ps;
+    regs[0x8E] = ps >> 8;
+    regs[0x8C] |= 0x01;
+  }
+}
+
+uint8_t SimLTR559::read(uint8_t &reg) {
+  uint8_t value = regs[reg];
+  // Reading the data clears the new data flags
+  if (reg == 0x8B) clear_flags |= 0x04;
+  if (reg == 0x8E) clear_flags |= 0x01;
+  reg++;
+  return value;
+}
+
+void SimLTR559::write(uint8_t &reg, uint8_t value) {
+  uint64_t now = simNow();
+  switch (reg) {
+    case 0x80:
+      // Software reset bit
+      if (value & 0x02) {
+        uint8_t part = regs[0x86];
+        memset(regs + 0x80, 0, 0x20);
+        regs[0x84] = 0x02;
+        regs[0x85] = 0x03;
+        regs[0x86] = part;
+        regs[0x87] = 0x05;
+        next_als = next_ps = UINT64_MAX;
+        break;
+      }
+      if ((value & 1) && !(regs[0x80] & 1)) {
+        next_als = now + ltrIntegration[(regs[0x85] >> 3) & 7] * 1000ull;
+      }
+      regs[0x80] = value & 0x1D;
+      break;
+    case 0x81:
+      if ((value & 2) && !(regs[0x81] & 2)) next_ps = now + 10000;
+      regs[0x81] = value & 0x23;
+      break;
+    case 0x82:
+    case 0x83:
+    case 0x84:
+    case 0x85:
+      regs[reg] = value;
+      break;
+  }
+  reg++;
+}
+
+// ═══════════════════════════════════════════════════════════
+// LSM6DS3TR-C
+// ═══════════════════════════════════════════════════════════
+
+static const uint32_t lsmPeriodUs[16] = { 0, 80000, 38462, 19231, 9615, 4808, 2404, 1202, 602, 0, 0, 0, 0, 0, 0, 0 };
+static const double lsmAccelMg[4] = { 0.061, 0.488, 0.122, 0.244 };
+static const double lsmGyroMdps[4] = { 8.75, 17.5, 35, 70 };
+
+#define LSM_FIFO_WORDS 2048
+
+SimLSM6DS3::SimLSM6DS3(const SimMotionScript &script, uint8_t addr, int int1_pin)
+  : SimDevice(addr), fifo_samples(0), fifo_lost(0), keep_history(false), script(script), int1_pin(int1_pin),
+    next_out(UINT64_MAX), next_fifo(UINT64_MAX), fifo_read(0), overrun(false), watermark_irq(false) {
+  memset(regs, 0, sizeof(regs));
+  regs[0x0F] = 0x6A;
+  regs[0x12] = 0x04;
+}
+
+uint32_t SimLSM6DS3::odrPeriodUs(uint8_t ctrl) const {
+  return lsmPeriodUs[ctrl >> 4];
+}
+
+void SimLSM6DS3::sample(uint64_t at, int16_t out[6], bool record) {
+  double t = at / 1e6;
+  if (script.recorded(t, out)) return;
+  
+  SimMotion m = script.at(t);
+  if (record && keep_history) history.push_back(m);
+  double gyro_lsb = (regs[0x11] & 2) ? 4.375 : lsmGyroMdps[(regs[0x11] >> 2) & 3];
+  double accel_lsb = lsmAccelMg[(regs[0x10] >> 2) & 3];
+  for (int i = 0; i < 3; i++) {
+    double g = m.gyro[i] * RAD_TO_DEG * 1000.0 / gyro_lsb;
+    double a = m.accel[i] / 9.80665 * 1000.0 / accel_lsb;
+    out[i] = (int16_t)std::min(std::max(lround(g), -32768l), 32767l);
+    out[i + 3] = (int16_t)std::min(std::max(lround(a), -32768l), 32767l);
+  }
+}
+
+void SimLSM6DS3::update(uint64_t now) {
+  // Output registers hold the latest sample of the gyro ODR
+  if (next_out <= now) {
+    uint64_t period = odrPeriodUs(regs[0x11]);
+    uint64_t at = next_out + (now - next_out) / period * period;
+    next_out = at + period;
+    int16_t s[6];
+    sample(at, s, false);
+    for (int i = 0; i < 6; i++) {
+      regs[0x22 + i * 2] = s[i];
+      regs[0x23 + i * 2] = s[i] >> 8;
+    }
+  }
+  
+  // Continuous mode FIFO, both sensors undecimated: gyro XYZ, accel XYZ
+  while (next_fifo <= now) {
+    int16_t s[6];
+    sample(next_fifo, s, true);
+    next_fifo += lsmPeriodUs[(regs[0x0A] >> 3) & 15];
+    if (fifo.size() + 6 > LSM_FIFO_WORDS) {
+      // Full: the oldest sample goes, a partly read one included
+      size_t drop = 6 - fifo_read % 6;
+      fifo.erase(fifo.begin(), fifo.begin() + drop);
+      fifo_read += drop;
+      fifo_lost++;
+      overrun = true;
+    }
+    for (int i = 0; i < 6; i++) fifo.push_back((uint16_t)s[i]);
+    fifo_samples++;
+  }
+  
+  // Status: unread words, watermark, overrun, empty, pattern
+  uint16_t level = (uint16_t)fifo.size();
+  uint16_t threshold = regs[0x06] | ((regs[0x07] & 7) << 8);
+  bool wm = threshold && level >= threshold;
+  regs[0x3A] = level;
+  regs[0x3B] = ((level >> 8) & 7) | (wm ? 0x80 : 0) | (overrun ? 0x40 : 0) | (level ? 0 : 0x10);
+  uint16_t pattern = fifo_read % 6;
+  regs[0x3C] = pattern;
+  regs[0x3D] = pattern >> 8;
+  
+  if (wm && !watermark_irq && (regs[0x0D] & 0x08) && int1_pin >= 0) {
+    watermark_irq = true;
+    simPinRaise(int1_pin);
+  }
+  if (!wm) watermark_irq = false;
+}
+
+uint64_t SimLSM6DS3::nextEvent() {
+  // Only needed to raise INT1 on time, reads catch up by themselves
+  if (int1_pin >= 0 && (regs[0x0D] & 0x08)) return next_fifo;
+  return UINT64_MAX;
+}
+
+uint8_t SimLSM6DS3::read(uint8_t &reg) {
+  uint8_t r = reg;
+  bool inc = regs[0x12] & 0x04;
+  
+  // FIFO output: low byte, then the high byte pops the word and the
+  // address rolls back to the low byte
+  if (r == 0x3E || r == 0x3F) {
+    uint8_t value = 0;
+    if (!fifo.empty()) value = r == 0x3E ? fifo[0] & 0xFF : fifo[0] >> 8;
+    if (r == 0x3F && !fifo.empty()) {
+      fifo.erase(fifo.begin());
+      fifo_read++;
+      overrun = false;
+    }
+    if (inc) reg = r == 0x3E ? 0x3F : 0x3E;
+    return value;
+  }
+  
+  if (inc) reg++;
+  return r < sizeof(regs) ? regs[r] : 0;
+}
+
+void SimLSM6DS3::write(uint8_t &reg, uint8_t value) {
+  uint64_t now = simNow();
+  uint8_t r = reg;
+  if (regs[0x12] & 0x04) reg++;
+  if (r >= sizeof(regs)) return;
+  
+  switch (r) {
+    case 0x06:
+    case 0x07:
+    case 0x08:
+    case 0x0D:
+      regs[r] = value;
+      break;
+    case 0x0A:
+      regs[r] = value;
+      if ((value & 7) == 0) {
+        // Bypass mode empties the FIFO
+        fifo.clear();
+        fifo_read = 0;
+        overrun = false;
+        next_fifo = UINT64_MAX;
+      } else if ((value & 7) == 6 && lsmPeriodUs[(value >> 3) & 15] && (regs[0x08] & 0x3F) == 0x09) {
+        next_fifo = now + lsmPeriodUs[(value >> 3) & 15];
+      }
+      break;
+    case 0x10:
+    case 0x11:
+      regs[r] = value;
+      if (r == 0x11) next_out = odrPeriodUs(value) ? now + odrPeriodUs(value) : UINT64_MAX;
+      break;
+    case 0x12:
+      // Software reset bit
+      if (value & 0x01) {
+        memset(regs, 0, sizeof(regs));
+        regs[0x0F] = 0x6A;
+        value = 0x04;
+        fifo.clear();
+        fifo_read = 0;
+        next_out = next_fifo = UINT64_MAX;
+      }
+      regs[r] = value;
+      break;
+  }
+}
@@ -0,0 +1,203 @@
+#ifndef _I2CSIM_H_
+#define _I2CSIM_H_
+
+// Register level simulation of the Multi Sensor Stick for building the
+// sketch's sensor code on Linux: a fake I2C bus behind the Wire object,
+// models of the BME280, LTR-559 and LSM6DS3TR-C register maps, and the
+// waveforms they measure. See sensorstick_sim.cpp for what it is used for.
+//
+// Time is simulated in microseconds and only moves when the code under
+// test waits (delay, a blocking transfer, a busy loop) or when simAdvance()
+// is called. Timers, DMA completions and pin interrupts fire on the way.
+
+#include <stdint.h>
+#include <deque>
+#include <vector>
+
+// ═══════════════════════════════════════════════════════════
+// Clock
+// ═══════════════════════════════════════════════════════════
+
+uint64_t simNow();
+void simAdvance(uint64_t us);
+void simAdvanceTo(uint64_t t);
+
+// ═══════════════════════════════════════════════════════════
+// Waveforms
+// ═══════════════════════════════════════════════════════════
+
+// What the sensors see at a moment
+struct SimEnv {
+  double temperature;  // C
+  double pressure;     // Pa
+  double humidity;     // %
+  double lux;
+  double ir_ratio;     // CH1 / (CH0 + CH1) of the LTR-559, ~0.25 daylight
+  double proximity;    // 0-2047
+};
+
+struct SimMotion {
+  double roll, pitch, yaw;  // rad, the truth for the orientation filter
+  double gyro[3];           // rad/s
+  double accel[3];          // m/s^2
+};
+
+// Environment keyframes with linear interpolation in between. Loads the
+// CSV the sketches export (d on the serial port) or a hand written script
+// with the same kind of header: a time column in seconds first, then any
+// of temp_cC/temp_C, humidity_c%/humidity, pressure_Pa/pressure_hPa,
+// lux_x10/lux, proximity. Missing columns keep the default.
+class SimEnvScript {
+public:
+  SimEnvScript();
+  bool load(const char *path);
+  void add(double t, const SimEnv &env);
+  SimEnv at(double t) const;
+  double duration() const;
+  
+  // Per reading gaussian noise added by the models, 0 for none
+  double temperature_noise, pressure_noise, humidity_noise;
+
+private:
+  std::vector<double> times;
+  std::vector<SimEnv> frames;
+};
+
+// Board motion: a scripted tilt and turn, or a trace recorded with
+// DUMP_IMU_TRACE played back sample by sample (raw values, ±4 g / 2000 dps)
+class SimMotionScript {
+public:
+  SimMotionScript();
+  bool load(const char *path);
+  SimMotion at(double t) const;
+  // Raw sample i of the recording, false without one or past its end
+  bool recorded(double t, int16_t raw[6]) const;
+  
+  double roll_deg, pitch_deg;   // tilt amplitudes
+  double roll_s, pitch_s;       // and their periods
+  double yaw_dps;               // steady turn
+  double gyro_noise, accel_noise;
+
+private:
+  double rate;
+  std::vector<int16_t> trace;
+};
+
+// ═══════════════════════════════════════════════════════════
+// Bus and devices
+// ═══════════════════════════════════════════════════════════
+
+// A device on the bus. The bus keeps the register pointer and hands it to
+// every access, so the model decides how it moves on (auto-increment,
+// roll-back on FIFO registers).
+class SimDevice {
+public:
+  SimDevice(uint8_t addr) : addr(addr) {}
+  virtual ~SimDevice() {}
+  virtual uint8_t read(uint8_t &reg) = 0;
+  virtual void write(uint8_t &reg, uint8_t value) = 0;
+  // Catch up with the simulated time
+  virtual void update(uint64_t now) { (void)now; }
+  // Next time the device wants update() called, for pin interrupts
+  virtual uint64_t nextEvent() { return UINT64_MAX; }
+  
+  uint8_t addr;
+};
+
+struct SimBusStats {
+  uint32_t transactions;  // START ... STOP, a write-read counts as one
+  uint32_t bytes;         // on the wire, address bytes included
+  uint32_t async;         // transactions started through the async API
+  uint32_t nacks;
+  uint64_t busy_us;       // time the bus was driven
+  uint64_t blocked_us;    // time the CPU spent in blocking transfers
+};
+
+void simBusAttach(SimDevice *dev);
+void simBusDetach(SimDevice *dev);
+void simBusResetStats();
+SimBusStats simBusStats();
+
+// Pin interrupts attached by the code under test
+void simPinRaise(int pin);
+// Input level, an edge calls the pin's interrupt
+void simPinSet(int pin, int level);
+
+class SimBME280 : public SimDevice {
+public:
+  SimBME280(const SimEnvScript &script, uint8_t addr = 0x76);
+  uint8_t read(uint8_t &reg) override;
+  void write(uint8_t &reg, uint8_t value) override;
+  void update(uint64_t now) override;
+  
+  // Conversions done and time spent converting, the current draw follows it
+  uint32_t conversions;
+  uint64_t active_us;
+
+private:
+  void convert(uint64_t at);
+  uint32_t measureUs() const;
+  uint32_t periodUs() const;
+  
+  const SimEnvScript &script;
+  uint8_t regs[256];
+  uint64_t measure_start, measure_end;  // current or last conversion
+  uint64_t normal_next;                 // next conversion end in normal mode
+  uint64_t nvm_until;                   // NVM copy after a reset
+  bool measuring;
+  double filt_t, filt_p;                // IIR state, raw ADC values
+  bool filt_valid;
+};
+
+class SimLTR559 : public SimDevice {
+public:
+  SimLTR559(const SimEnvScript &script, uint8_t addr = 0x23);
+  uint8_t read(uint8_t &reg) override;
+  void write(uint8_t &reg, uint8_t value) override;
+  void update(uint64_t now) override;
+  
+  uint32_t conversions;
+
+private:
+  const SimEnvScript &script;
+  uint8_t regs[256];
+  uint64_t next_als, next_ps;
+  uint8_t clear_flags;  // new data flags read out, cleared after the burst
+};
+
+class SimLSM6DS3 : public SimDevice {
+public:
+  SimLSM6DS3(const SimMotionScript &script, uint8_t addr = 0x6A, int int1_pin = -1);
+  uint8_t read(uint8_t &reg) override;
+  void write(uint8_t &reg, uint8_t value) override;
+  void update(uint64_t now) override;
+  uint64_t nextEvent() override;
+  
+  uint32_t fifo_samples;   // pushed into the FIFO
+  uint32_t fifo_lost;      // overwritten before they were read
+  // Truth at the time of every FIFO sample, for checking fusion
+  std::vector<SimMotion> history;
+  bool keep_history;
+
+private:
+  void sample(uint64_t at, int16_t out[6], bool record);
+  uint32_t odrPeriodUs(uint8_t ctrl) const;
+  
+  const SimMotionScript &script;
+  int int1_pin;
+  uint8_t regs[128];
+  uint64_t next_out, next_fifo;
+  std::deque<uint16_t> fifo;   // words, gyro xyz accel xyz per sample
+  uint32_t fifo_read;          // words popped in total, for the pattern
+  bool overrun, watermark_irq;
+};
+
+// Same calibration as a typical part, the models use it and the driver
+// reads it back like from a real one
+extern const uint8_t simBme280Calib[26 + 7];
+// The datasheet's compensation in double precision, for checking the driver
+double simBme280Temperature(int32_t adc_t, double &t_fine);
+double simBme280Pressure(int32_t adc_p, double t_fine);
+double simBme280Humidity(int32_t adc_h, double t_fine);
+
+#endif
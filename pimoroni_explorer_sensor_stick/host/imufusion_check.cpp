@@ -0,0 +1,276 @@
+// Checks the orientation filter in imufusion.cpp against known motion and
+// measures what one update costs.
+//
+// Build on Linux from this directory:
+//   g++ -O2 -o imufusion_check imufusion_check.cpp ../imufusion.cpp
+//
+// Synthetic run: tilts and turns a virtual board, feeds the filter gyro and
+// accel with noise, bias and shakes, and compares roll/pitch with the truth:
+//   ./imufusion_check [-r rate_hz] [-s seconds] [-b beta]
+// Recorded run: a trace printed by the sketch with DUMP_IMU_TRACE, one raw
+// sample per line "gx,gy,gz,ax,ay,az" and a "# rate <hz>" line. Lines with
+// three more values are taken as reference roll,pitch,yaw in degrees.
+// Prints the angles as CSV with -v:
+//   ./imufusion_check [-b beta] [-v] trace.csv
+// -o writes the synthetic run as a trace with its reference angles.
+// tilt_trace.csv is 10 s of it at 416 Hz, shakes included, so the check
+// does not depend on the host's rand():
+//   ./imufusion_check -s 10 -o tilt_trace.csv
+//
+// Exits with 1 when the roll or pitch error is above the limits below,
+// with the default beta and rate that is a regression in the filter.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+#include <vector>
+#include "../imufusion.h"
+
+// Same scales as sensorstick.h (±4 g, 2000 dps)
+#define ACCEL_SCALE  (0.122e-3f * 9.80665f)
+#define GYRO_SCALE   (70e-3f * 3.14159265f / 180.0f)
+
+// Degrees, after the filter has settled. Yaw has no limit, it drifts.
+#define ROLL_RMS_LIMIT   0.45
+#define ROLL_MAX_LIMIT   2.0
+#define PITCH_RMS_LIMIT  0.30
+#define PITCH_MAX_LIMIT  2.0
+
+struct Sample {
+  float g[3];
+  float a[3];
+  float ref[3];
+  bool has_ref;
+};
+
+struct Errors {
+  double sum_sq;
+  double max;
+  uint32_t count;
+};
+
+static void addError(Errors &e, double err) {
+  while (err > 180) err -= 360;
+  while (err < -180) err += 360;
+  e.sum_sq += err * err;
+  if (fabs(err) > e.max) e.max = fabs(err);
+  e.count++;
+}
+
+static double gauss() {
+  double u = (rand() + 1.0) / (RAND_MAX + 2.0);
+  double v = (rand() + 1.0) / (RAND_MAX + 2.0);
+  return sqrt(-2 * log(u)) * cos(2 * M_PI * v);
+}
+
+// Angles of the virtual board at time t, radians
+static void truth(double t, double &roll, double &pitch, double &yaw) {
+  roll = 0.6 * sin(0.5 * t) + 0.2 * sin(2.3 * t);
+  pitch = 0.4 * sin(0.3 * t + 1.0);
+  yaw = 0.8 * t;
+}
+
+static void eulerToQuat(double roll, double pitch, double yaw, double q[4]) {
+  double cr = cos(roll / 2), sr = sin(roll / 2);
+  double cp = cos(pitch / 2), sp = sin(pitch / 2);
+  double cy = cos(yaw / 2), sy = sin(yaw / 2);
+  q[0] = cr * cp * cy + sr * sp * sy;
+  q[1] = sr * cp * cy - cr * sp * sy;
+  q[2] = cr * sp * cy + sr * cp * sy;
+  q[3] = cr * cp * sy - sr * sp * cy;
+}
+
+// Body rates from two orientations dt apart: w = 2 * conj(q) * dq/dt
+static void bodyRate(const double a[4], const double b[4], double dt, double w[3]) {
+  double d[4];
+  for (int i = 0; i < 4; i++) d[i] = (b[i] - a[i]) / dt;
+  double q[4] = { (a[0] + b[0]) / 2, (a[1] + b[1]) / 2, (a[2] + b[2]) / 2, (a[3] + b[3]) / 2 };
+  w[0] = 2 * (q[0] * d[1] - q[1] * d[0] - q[2] * d[3] + q[3] * d[2]);
+  w[1] = 2 * (q[0] * d[2] + q[1] * d[3] - q[2] * d[0] - q[3] * d[1]);
+  w[2] = 2 * (q[0] * d[3] - q[1] * d[2] + q[2] * d[1] - q[3] * d[0]);
+}
+
+static void makeSynthetic(float rate, float seconds, std::vector<Sample> &out) {
+  const double g = 9.80665;
+  double dt = 1.0 / rate;
+  uint32_t count = (uint32_t)(rate * seconds);
+  double bias[3] = { 0.004, -0.003, 0.002 };  // rad/s
+  
+  for (uint32_t i = 0; i < count; i++) {
+    double t = i * dt;
+    double r0, p0, y0, r1, p1, y1;
+    truth(t, r0, p0, y0);
+    truth(t + dt, r1, p1, y1);
+    double qa[4], qb[4], w[3];
+    eulerToQuat(r0, p0, y0, qa);
+    eulerToQuat(r1, p1, y1, qb);
+    bodyRate(qa, qb, dt, w);
+    
+    // Gravity in the sensor frame, plus a shake now and then
+    double acc[3] = { -g * sin(p1), g * sin(r1) * cos(p1), g * cos(r1) * cos(p1) };
+    if (fmod(t, 10.0) > 8.0) {
+      acc[0] += 4.0 * sin(40 * t);
+      acc[1] += 3.0 * sin(33 * t);
+    }
+    
+    // Quantised like the real sensor
+    Sample s;
+    for (int k = 0; k < 3; k++) {
+      double gyro = w[k] + bias[k] + gauss() * 0.005;
+      double accel = acc[k] + gauss() * 0.02;
+      s.g[k] = (int16_t)lrint(gyro / GYRO_SCALE) * GYRO_SCALE;
+      s.a[k] = (int16_t)lrint(accel / ACCEL_SCALE) * ACCEL_SCALE;
+    }
+    s.ref[0] = (float)(r1 * 180 / M_PI);
+    s.ref[1] = (float)(p1 * 180 / M_PI);
+    s.ref[2] = (float)(y1 * 180 / M_PI);
+    s.has_ref = true;
+    out.push_back(s);
+  }
+}
+
+static bool readTrace(const char *path, float &rate, std::vector<Sample> &out) {
+  FILE *f = fopen(path, "r");
+  if (!f) {
+    fprintf(stderr, "Cannot open %s\n", path);
+    return false;
+  }
+  
+  char line[256];
+  while (fgets(line, sizeof(line), f)) {
+    float r;
+    if (sscanf(line, "# rate %f", &r) == 1) {
+      rate = r;
+      continue;
+    }
+    int raw[6];
+    Sample s;
+    int n = sscanf(line, "%d,%d,%d,%d,%d,%d,%f,%f,%f", &raw[0], &raw[1], &raw[2], &raw[3], &raw[4], &raw[5],
+                   &s.ref[0], &s.ref[1], &s.ref[2]);
+    if (n < 6) continue;
+    for (int k = 0; k < 3; k++) {
+      s.g[k] = raw[k] * GYRO_SCALE;
+      s.a[k] = raw[3 + k] * ACCEL_SCALE;
+    }
+    s.has_ref = n == 9;
+    out.push_back(s);
+  }
+  fclose(f);
+  return true;
+}
+
+// Same lines as DUMP_IMU_TRACE, plus the reference angles
+static bool writeTrace(const char *path, float rate, const std::vector<Sample> &samples) {
+  FILE *f = fopen(path, "w");
+  if (!f) {
+    fprintf(stderr, "Cannot write %s\n", path);
+    return false;
+  }
+  fprintf(f, "# rate %.0f\n", rate);
+  for (size_t i = 0; i < samples.size(); i++) {
+    const Sample &s = samples[i];
+    fprintf(f, "%ld,%ld,%ld,%ld,%ld,%ld,%.2f,%.2f,%.2f\n", lrintf(s.g[0] / GYRO_SCALE), lrintf(s.g[1] / GYRO_SCALE),
+            lrintf(s.g[2] / GYRO_SCALE), lrintf(s.a[0] / ACCEL_SCALE), lrintf(s.a[1] / ACCEL_SCALE),
+            lrintf(s.a[2] / ACCEL_SCALE), s.ref[0], s.ref[1], s.ref[2]);
+  }
+  fclose(f);
+  return true;
+}
+
+// Prints the rms and max error, false when either is above its limit
+static bool report(const char *name, const Errors &e, double rms_limit, double max_limit) {
+  double rms = sqrt(e.sum_sq / e.count);
+  bool ok = rms <= rms_limit && e.max <= max_limit;
+  printf("%-5s error: rms %.2f, max %.2f deg", name, rms, e.max);
+  if (ok) printf("\n");
+  else printf("  FAIL, limits %.2f and %.2f\n", rms_limit, max_limit);
+  return ok;
+}
+
+int main(int argc, char **argv) {
+  float rate = 416;
+  float seconds = 60;
+  float beta = FUSION_BETA;
+  bool verbose = false;
+  const char *trace = NULL;
+  const char *out = NULL;
+  
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+      rate = (float)atof(argv[++i]);
+    } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+      seconds = (float)atof(argv[++i]);
+    } else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+      beta = (float)atof(argv[++i]);
+    } else if (strcmp(argv[i], "-v") == 0) {
+      verbose = true;
+    } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+      out = argv[++i];
+    } else if (argv[i][0] != '-' && !trace) {
+      trace = argv[i];
+    } else {
+      fprintf(stderr, "usage: imufusion_check [-r rate_hz] [-s seconds] [-b beta] [-v] [-o out.csv] [trace.csv]\n");
+      return 1;
+    }
+  }
+  
+  std::vector<Sample> samples;
+  if (trace) {
+    if (!readTrace(trace, rate, samples)) return 1;
+  } else {
+    makeSynthetic(rate, seconds, samples);
+  }
+  if (samples.empty()) {
+    fprintf(stderr, "No samples\n");
+    return 1;
+  }
+  if (out) {
+    if (!writeTrace(out, rate, samples)) return 1;
+    printf("Wrote %zu samples to %s\n", samples.size(), out);
+    return 0;
+  }
+  
+  // Accuracy, leaving out the first 2 s while the filter settles
+  ImuFusion f;
+  fusionInit(f, rate, beta);
+  Errors roll = {}, pitch = {}, yaw = {};
+  uint32_t settle = (uint32_t)(2 * rate);
+  if (verbose) printf("n,roll,pitch,yaw\n");
+  for (size_t i = 0; i < samples.size(); i++) {
+    const Sample &s = samples[i];
+    fusionUpdate(f, s.g[0], s.g[1], s.g[2], s.a[0], s.a[1], s.a[2]);
+    float r, p, y;
+    fusionEuler(f, r, p, y);
+    if (verbose) printf("%zu,%.2f,%.2f,%.2f\n", i, r, p, y);
+    if (s.has_ref && i >= settle) {
+      addError(roll, r - s.ref[0]);
+      addError(pitch, p - s.ref[1]);
+      addError(yaw, y - s.ref[2]);
+    }
+  }
+  
+  printf("%zu samples at %.0f Hz, beta %.3f, %u accel corrections skipped\n",
+         samples.size(), rate, beta, f.rejected);
+  bool ok = true;
+  if (roll.count) {
+    ok = report("roll", roll, ROLL_RMS_LIMIT, ROLL_MAX_LIMIT) && ok;
+    ok = report("pitch", pitch, PITCH_RMS_LIMIT, PITCH_MAX_LIMIT) && ok;
+    printf("yaw   error: rms %.2f, max %.2f deg (gyro only, drifts)\n", sqrt(yaw.sum_sq / yaw.count), yaw.max);
+  }
+  
+  // Speed, the same samples over and over
+  const int passes = 20;
+  fusionInit(f, rate, beta);
+  auto start = std::chrono::steady_clock::now();
+  for (int pass = 0; pass < passes; pass++) {
+    for (size_t i = 0; i < samples.size(); i++) {
+      const Sample &s = samples[i];
+      fusionUpdate(f, s.g[0], s.g[1], s.g[2], s.a[0], s.a[1], s.a[2]);
+    }
+  }
+  double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+  printf("%.1f ns per update on this machine (q0 %.3f)\n", ns / (passes * samples.size()), f.q0);
+  return ok ? 0 : 1;
+}
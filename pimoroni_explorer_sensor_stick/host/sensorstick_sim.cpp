@@ -0,0 +1,1202 @@
+// Runs the sketch's sensor code (sensorstick.cpp, imufusion.cpp, the loop
+// scheduler, the weather forecast, its pressure history, barograph and
+// buttons) against the register models in i2csim.cpp, checks what comes out
+// against the simulated truth and reports the bus traffic.
+//
+// Build on Linux from this directory:
+//   g++ -O2 -I sim -o sensorstick_sim sensorstick_sim.cpp i2csim.cpp ../sensorstick.cpp ../imufusion.cpp ../scheduler.cpp ../../pimoroni_explorer_weather_forecast/forecast.cpp ../../pimoroni_explorer_weather_forecast/pressurehistory.cpp ../../pimoroni_explorer_weather_forecast/barograph.cpp ../../pimoroni_explorer_weather_forecast/buttons.cpp
+//
+// All checks with built-in scripts, exits with 1 if one fails:
+//   ./sensorstick_sim [-v]
+// Replay: run the sensor stick setup (or the weather clock one with
+// --weather) on a recorded or hand written environment and/or an IMU trace,
+// print a reading every period seconds as CSV and the bus statistics:
+//   ./sensorstick_sim [--weather] [--env log.csv] [--imu trace.csv] [-s seconds] [-p period]
+// The environment file is what d on the serial port of either sketch
+// prints, or a script in the same format, the IMU trace is a DUMP_IMU_TRACE
+// recording. -v echoes the sketch's Serial output.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <math.h>
+#include <vector>
+#include <algorithm>
+#include "i2csim.h"
+#include "pico/time.h"
+#include "../sensorstick.h"
+#include "../imufusion.h"
+#include "../scheduler.h"
+#include "../../pimoroni_explorer_weather_forecast/forecast.h"
+#include "../../pimoroni_explorer_weather_forecast/pressurehistory.h"
+#include "../../pimoroni_explorer_weather_forecast/barograph.h"
+#include "../../pimoroni_explorer_weather_forecast/buttons.h"
+
+// Settings of the two sketches
+#define STICK_PROFILE       BME280_PROFILE_INDOOR
+#define STICK_IMU_RATE_HZ   416
+#define STICK_IMU_WATERMARK 32
+#define STICK_IMU_PERIOD_MS 20
+#define WEATHER_PROFILE     BME280_PROFILE_WEATHER
+#define PRESSURE_SAMPLES    36
+#define SAMPLE_INTERVAL     300000
+
+#define INT1_PIN            3
+
+static int failures = 0;
+
+static void check(bool ok, const char *format, ...) __attribute__((format(printf, 2, 3)));
+static void check(bool ok, const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  printf("%s ", ok ? "ok  " : "FAIL");
+  vprintf(format, args);
+  printf("\n");
+  va_end(args);
+  if (!ok) failures++;
+}
+
+static void section(const char *name) {
+  printf("\n== %s\n", name);
+}
+
+// Everything on the bus, one world per check so they don't share state
+struct World {
+  SimEnvScript env;
+  SimMotionScript motion;
+  SimBME280 bme;
+  SimLTR559 ltr;
+  SimLSM6DS3 imu;
+  
+  World(int int1_pin = -1) : bme(env), ltr(env), imu(motion, 0x6A, int1_pin) {
+    simBusAttach(&bme);
+    simBusAttach(&ltr);
+    simBusAttach(&imu);
+  }
+  ~World() {
+    simBusDetach(&bme);
+    simBusDetach(&ltr);
+    simBusDetach(&imu);
+  }
+};
+
+static double seconds() {
+  return simNow() / 1e6;
+}
+
+// ═══════════════════════════════════════════════════════════
+// Blocking reads
+// ═══════════════════════════════════════════════════════════
+
+static void checkBME280() {
+  section("BME280 blocking reads");
+  static const char *names[] = { "continuous", "weather", "indoor" };
+  
+  for (int profile = 0; profile < BME280_PROFILE_COUNT; profile++) {
+    World w;
+    w.env.add(0, { 23.4, 98765.0, 61.0, 300, 0.25, 0 });
+    w.env.add(1e6, { 23.4, 98765.0, 61.0, 300, 0.25, 0 });
+    w.env.add(2e6, { -12.5, 103000.0, 8.0, 300, 0.25, 0 });
+    
+    if (!initBME280((Bme280Profile)profile)) {
+      check(false, "%s: init", names[profile]);
+      continue;
+    }
+    // Let normal mode and the IIR filter settle
+    delay(2000);
+    
+    for (double at : { 3.0, 1e6 + 2.0 }) {
+      simAdvanceTo((uint64_t)(at * 1e6));
+      for (int i = 0; i < 40; i++) {
+        delay(bme280PeriodMs());
+        SensorData d = {};
+        readBME280(d);
+      }
+      SensorData d = {};
+      bool ok = readBME280(d);
+      SimEnv truth = w.env.at(seconds());
+      float dt = d.temperature - truth.temperature;
+      float dp = d.pressure - truth.pressure / 100;
+      float dh = d.humidity - truth.humidity;
+      check(ok && fabsf(dt) < 0.02f && fabsf(dp) < 0.05f && fabsf(dh) < 0.1f,
+            "%-10s %6.2f C %8.2f hPa %5.1f %%, off by %+.3f C %+.3f hPa %+.3f %%", names[profile],
+            d.temperature, d.pressure, d.humidity, dt, dp, dh);
+    }
+  }
+}
+
+// Lux formula of pimoroni/ltr559-python in doubles, the reference for the
+// driver's integer version
+static double referenceLux(uint16_t ch0, uint16_t ch1, uint8_t gain, uint16_t integration_ms) {
+  if (ch0 + ch1 == 0) return 0;
+  double ratio = ch1 / (double)(ch0 + ch1);
+  double lux;
+  if (ratio < 0.45) lux = (ch0 * 17743.0 + ch1 * 11059.0) / 10000;
+  else if (ratio < 0.64) lux = (ch0 * 42785.0 - ch1 * 19548.0) / 10000;
+  else if (ratio < 0.85) lux = (ch0 * 5926.0 + ch1 * 1185.0) / 10000;
+  else lux = 0;
+  return fmax(lux, 0) / (integration_ms / 100.0) / gain;
+}
+
+static void checkLuxFixedPoint() {
+  section("LTR-559 fixed point lux");
+  static const uint8_t gains[] = { 1, 2, 4, 8, 48, 96 };
+  static const uint16_t times[] = { 50, 100, 150, 200, 250, 300, 350, 400 };
+  double worst = 0;
+  uint32_t cases = 0;
+  for (uint32_t ch0 = 0; ch0 <= 65535; ch0 += 97) {
+    for (uint32_t ch1 = 0; ch1 <= 65535; ch1 += 89) {
+      for (uint8_t gain : gains) {
+        for (uint16_t ms : times) {
+          double ref = referenceLux(ch0, ch1, gain, ms);
+          double got = ltr559MilliLux(ch0, ch1, gain, ms) / 1000.0;
+          worst = fmax(worst, fabs(got - ref));
+          cases++;
+        }
+      }
+    }
+  }
+  // Only the last division truncates
+  check(worst < 0.001, "%u cases, worst %.4f lux off the float formula", cases, worst);
+}
+
+static void checkLTR559() {
+  section("LTR-559 blocking reads, auto-ranging");
+  World w;
+  static const double levels[] = { 0.05, 0.5, 8, 50, 350, 4000, 30000, 100000, 2 };
+  const int count = sizeof(levels) / sizeof(levels[0]);
+  const double hold = 5;
+  // One level every 5 s, 0.3 IR ratio, proximity rising
+  for (int i = 0; i < count; i++) {
+    SimEnv e = { 21, 101325, 45, levels[i], 0.3, 100.0 * i };
+    w.env.add(seconds() + i * hold, e);
+    w.env.add(seconds() + i * hold + hold - 0.001, e);
+  }
+  double start = seconds();
+  if (!initLTR559()) {
+    check(false, "init");
+    return;
+  }
+  
+  SensorData d = {};
+  for (int i = 0; i < count; i++) {
+    // Read like the async job does, the range has settled by the end
+    bool ok = true;
+    while (seconds() < start + i * hold + hold - 0.1) {
+      delay(ltr559PeriodMs());
+      ok = readLTR559(d) && ok;
+    }
+    uint8_t gain;
+    uint16_t ms;
+    ltr559GetRange(gain, ms);
+    double err = d.lux - levels[i];
+    check(ok && fabs(err) <= levels[i] * 0.01 + 0.01, "%9.2f lux reads %9.2f (%+.3f) at %2ux %3u ms, proximity %u",
+          levels[i], d.lux, err, gain, ms, d.proximity);
+  }
+}
+
+static void checkLSM6DS3() {
+  section("LSM6DS3TR-C blocking reads");
+  World w;
+  w.motion.roll_s = 60;
+  w.motion.pitch_s = 90;
+  w.motion.yaw_dps = 0;
+  if (!initLSM6DS3()) {
+    check(false, "init");
+    return;
+  }
+  
+  double max_a = 0, max_g = 0;
+  for (int i = 0; i < 50; i++) {
+    delay(97);
+    SensorData d = {};
+    readLSM6DS3(d);
+    SimMotion m = w.motion.at(seconds());
+    double a[3] = { d.accelX - m.accel[0], d.accelY - m.accel[1], d.accelZ - m.accel[2] };
+    double g[3] = { d.gyroX - m.gyro[0], d.gyroY - m.gyro[1], d.gyroZ - m.gyro[2] };
+    for (int k = 0; k < 3; k++) {
+      max_a = fmax(max_a, fabs(a[k]));
+      max_g = fmax(max_g, fabs(g[k]));
+    }
+  }
+  check(max_a < 0.02 && max_g < 0.005, "50 samples, accel off by %.4f m/s^2, gyro by %.4f rad/s at most", max_a, max_g);
+}
+
+// ═══════════════════════════════════════════════════════════
+// Async engine
+// ═══════════════════════════════════════════════════════════
+
+// What the sensor stick's loop did with the IMU samples
+struct StickLoop {
+  ImuFusion f;
+  uint32_t n;           // samples taken
+  uint32_t mismatches;  // samples not what the model put in its FIFO
+  double sum_sq_roll, sum_sq_pitch, max_error;
+  uint32_t count;       // samples in the error sums
+};
+
+// The sensor stick's loop: drain the IMU ring into the filter every 10 ms.
+// Samples are compared one by one with what the model put in its FIFO.
+static void runStick(World &w, double duration, StickLoop &loop) {
+  static ImuSample samples[64];
+  double end = seconds() + duration;
+  while (seconds() < end) {
+    delay(10);
+    uint16_t got;
+    while ((got = imuFifoRead(samples, 64)) > 0) {
+      for (uint16_t i = 0; i < got; i++) {
+        uint32_t n = loop.n++;
+        SensorData d;
+        imuSampleToSensorData(samples[i], d);
+        fusionUpdate(loop.f, d.gyroX, d.gyroY, d.gyroZ, d.accelX, d.accelY, d.accelZ);
+        if (n >= w.imu.history.size()) {
+          loop.mismatches++;
+          continue;
+        }
+        const SimMotion &m = w.imu.history[n];
+        if (fabs(d.accelX - m.accel[0]) > 0.01 || fabs(d.gyroZ - m.gyro[2]) > 0.002) loop.mismatches++;
+        
+        // After the filter settled
+        if (n < 2 * STICK_IMU_RATE_HZ) continue;
+        float roll, pitch, yaw;
+        fusionEuler(loop.f, roll, pitch, yaw);
+        double er = roll - m.roll * RAD_TO_DEG, ep = pitch - m.pitch * RAD_TO_DEG;
+        loop.sum_sq_roll += er * er;
+        loop.sum_sq_pitch += ep * ep;
+        loop.max_error = fmax(loop.max_error, fmax(fabs(er), fabs(ep)));
+        loop.count++;
+      }
+    }
+  }
+}
+
+static bool startStick(World &w, int int1_pin, uint32_t imu_period_ms = STICK_IMU_PERIOD_MS) {
+  Wire.setClock(400000);
+  w.imu.keep_history = true;
+  if (!initBME280(STICK_PROFILE) || !initLTR559()) return false;
+  if (!initLSM6DS3Fifo(STICK_IMU_RATE_HZ, STICK_IMU_WATERMARK, int1_pin)) return false;
+  sensorAsyncSetRate(SENSOR_BME280, bme280PeriodMs());
+  sensorAsyncSetRate(SENSOR_LSM6DS3, imu_period_ms);
+  sensorAsyncSetRate(SENSOR_LTR559, ltr559PeriodMs());
+  return sensorAsyncBegin();
+}
+
+static void stopStick() {
+  sensorAsyncEnd();
+  for (int i = 0; i < SENSOR_COUNT; i++) {
+    sensorAsyncSetRate((SensorId)i, 0);
+  }
+  Wire.setClock(100000);
+}
+
+static void printBus(const char *name, const SimBusStats &bus, double duration) {
+  printf("%-28s %7.1f transactions/s %8.0f bytes/s  bus busy %5.1f%%  CPU blocked %6.1f ms/s\n", name,
+         bus.transactions / duration, bus.bytes / duration, bus.busy_us / duration / 1e4,
+         bus.blocked_us / duration / 1e3);
+}
+
+static void checkAsync(int int1_pin) {
+  section(int1_pin < 0 ? "Async engine, sensor stick setup" : "Async engine, FIFO watermark on INT1");
+  World w(int1_pin);
+  w.env.add(0, { 22, 100900, 50, 420, 0.25, 30 });
+  w.motion.gyro_noise = 0.01;
+  w.motion.accel_noise = 0.05;
+  // With INT1 the period is only a fallback, the watermark starts drains
+  if (!startStick(w, int1_pin, int1_pin < 0 ? STICK_IMU_PERIOD_MS : 1000)) {
+    check(false, "start");
+    return;
+  }
+  
+  const double duration = 30;
+  simBusResetStats();
+  SensorAsyncStats before;
+  sensorAsyncGetStats(before);
+  uint32_t bme_before = w.bme.conversions;
+  uint32_t ltr_before = w.ltr.conversions;
+  uint32_t fifo_before = w.imu.fifo_samples - imuFifoAvailable();
+  
+  StickLoop loop = {};
+  fusionInit(loop.f, STICK_IMU_RATE_HZ);
+  runStick(w, duration, loop);
+  
+  SensorAsyncStats st;
+  sensorAsyncGetStats(st);
+  SimBusStats bus = simBusStats();
+  uint32_t bme = st.updates[SENSOR_BME280] - before.updates[SENSOR_BME280];
+  uint32_t imu = st.updates[SENSOR_LSM6DS3] - before.updates[SENSOR_LSM6DS3];
+  uint32_t ltr = st.updates[SENSOR_LTR559] - before.updates[SENSOR_LTR559];
+  uint32_t expect_bme = (uint32_t)(duration * 1000 / bme280PeriodMs());
+  uint32_t expect_ltr = (uint32_t)(duration * 1000 / ltr559PeriodMs());
+  
+  check(st.errors == before.errors, "%u errors", st.errors - before.errors);
+  check(bme >= expect_bme * 95 / 100 && bme <= expect_bme + 1, "BME280 %u updates, %u expected, %u conversions",
+        bme, expect_bme, w.bme.conversions - bme_before);
+  uint32_t ltr_conversions = w.ltr.conversions - ltr_before;
+  check(ltr >= expect_ltr * 95 / 100 && ltr <= expect_ltr + 1 && ltr <= ltr_conversions + 1,
+        "LTR-559 %u updates, %u expected, %u conversions", ltr, expect_ltr, ltr_conversions);
+  uint32_t made = w.imu.fifo_samples - fifo_before;
+  uint32_t taken = st.imu_samples - before.imu_samples;
+  check(w.imu.fifo_lost == 0 && st.imu_overruns == 0 && st.imu_dropped == 0 && taken + 64 >= made,
+        "IMU %u samples made, %u taken in %u drains, %u lost, %u overruns, %u dropped", made, taken, imu,
+        w.imu.fifo_lost, st.imu_overruns, st.imu_dropped);
+  if (int1_pin >= 0) {
+    // One drain per watermark, none left to the 1 s period
+    uint32_t expect = made / STICK_IMU_WATERMARK;
+    check(imu >= expect * 9 / 10 && imu <= expect * 11 / 10, "%u IMU drains, %u expected from the watermark",
+          imu, expect);
+  }
+  check(loop.mismatches == 0, "IMU samples in order and unchanged, %u mismatches", loop.mismatches);
+  if (loop.count) {
+    check(loop.max_error < 3, "fusion roll rms %.2f, pitch rms %.2f, max %.2f deg",
+          sqrt(loop.sum_sq_roll / loop.count), sqrt(loop.sum_sq_pitch / loop.count), loop.max_error);
+  }
+  printBus("async engine", bus, duration);
+  stopStick();
+}
+
+// Same rates with blocking reads in the loop, what the engine replaced
+static void benchBlocking() {
+  World w;
+  Wire.setClock(400000);
+  initBME280(STICK_PROFILE);
+  initLTR559();
+  initLSM6DS3Fifo(STICK_IMU_RATE_HZ, STICK_IMU_WATERMARK);
+  writeRegister(LSM6DS3_ADDR, 0x0A, 0x00);
+  
+  const double duration = 10;
+  simBusResetStats();
+  uint64_t next_bme = simNow(), next_ltr = simNow(), next_imu = simNow();
+  uint64_t end = simNow() + (uint64_t)(duration * 1e6);
+  while (simNow() < end) {
+    SensorData d;
+    if (simNow() >= next_imu) {
+      readLSM6DS3(d);
+      next_imu += 1000000 / STICK_IMU_RATE_HZ;
+    }
+    if (simNow() >= next_bme) {
+      readBME280(d);
+      next_bme += bme280PeriodMs() * 1000;
+    }
+    if (simNow() >= next_ltr) {
+      readLTR559(d);
+      next_ltr += ltr559PeriodMs() * 1000;
+    }
+    tight_loop_contents();
+  }
+  printBus("blocking reads, same rates", simBusStats(), duration);
+  Wire.setClock(100000);
+}
+
+static void checkLightRange() {
+  section("Async engine, LTR-559 range changes");
+  World w;
+  static const double levels[] = { 300, 100000, 0.2, 1500 };
+  const int count = sizeof(levels) / sizeof(levels[0]);
+  const double hold = 6;
+  for (int i = 0; i < count; i++) {
+    SimEnv e = { 22, 100900, 50, levels[i], 0.25, 30 };
+    w.env.add(seconds() + i * hold, e);
+    w.env.add(seconds() + i * hold + hold - 0.001, e);
+  }
+  double start = seconds();
+  if (!startStick(w, -1)) {
+    check(false, "start");
+    return;
+  }
+  
+  StickLoop loop = {};
+  fusionInit(loop.f, STICK_IMU_RATE_HZ);
+  for (int i = 0; i < count; i++) {
+    // From saturated back to a sensitive range takes up to 3.5 s: down to
+    // the least sensitive one, two readings there, then up. Then it holds.
+    runStick(w, start + i * hold + 4 - seconds(), loop);
+    uint8_t gain_settled;
+    uint16_t ms_settled;
+    ltr559GetRange(gain_settled, ms_settled);
+    runStick(w, start + i * hold + hold - 0.1 - seconds(), loop);
+    uint8_t gain;
+    uint16_t ms;
+    ltr559GetRange(gain, ms);
+    SensorData d;
+    sensorAsyncSnapshot(d);
+    double err = d.lux - levels[i];
+    check(fabs(err) <= levels[i] * 0.01 + 0.01 && gain == gain_settled && ms == ms_settled,
+          "%9.2f lux reads %9.2f (%+.3f) at %2ux %3u ms", levels[i], d.lux, err, gain, ms);
+  }
+  SensorAsyncStats st;
+  sensorAsyncGetStats(st);
+  check(st.errors == 0, "%u errors", st.errors);
+  stopStick();
+}
+
+static void checkTimeout() {
+  section("Async engine, LTR-559 gone for 2 s");
+  World w;
+  if (!startStick(w, -1)) {
+    check(false, "start");
+    return;
+  }
+  StickLoop loop = {};
+  fusionInit(loop.f, STICK_IMU_RATE_HZ);
+  runStick(w, 1, loop);
+  
+  SensorAsyncStats before, during, after;
+  sensorAsyncGetStats(before);
+  simBusDetach(&w.ltr);
+  runStick(w, 2, loop);
+  sensorAsyncGetStats(during);
+  simBusAttach(&w.ltr);
+  runStick(w, 1, loop);
+  sensorAsyncGetStats(after);
+  
+  uint32_t errors = during.errors - before.errors;
+  uint32_t periods = 2000 / ltr559PeriodMs();
+  check(errors >= periods - 1 && errors <= periods + 1, "%u timed out reads while gone, one per period", errors);
+  check(during.updates[SENSOR_BME280] - before.updates[SENSOR_BME280] > 2000 / bme280PeriodMs() * 9 / 10 &&
+        during.updates[SENSOR_LSM6DS3] - before.updates[SENSOR_LSM6DS3] > 2000 / STICK_IMU_PERIOD_MS * 9 / 10,
+        "BME280 and IMU kept going: %u and %u updates", during.updates[SENSOR_BME280] - before.updates[SENSOR_BME280],
+        during.updates[SENSOR_LSM6DS3] - before.updates[SENSOR_LSM6DS3]);
+  check(after.updates[SENSOR_LTR559] - during.updates[SENSOR_LTR559] >= 1000 / ltr559PeriodMs() - 1 &&
+        after.errors == during.errors,
+        "LTR-559 back with %u updates", after.updates[SENSOR_LTR559] - during.updates[SENSOR_LTR559]);
+  check(during.imu_dropped == after.imu_dropped && w.imu.fifo_lost == 0 && loop.mismatches == 0,
+        "no IMU samples lost, %u taken in order", loop.n);
+  stopStick();
+}
+
+// ═══════════════════════════════════════════════════════════
+// Loop scheduler
+// ═══════════════════════════════════════════════════════════
+
+// The sensor stick's loop tasks with made up costs: a frame takes 30 ms,
+// the filter 1 ms, a log record 5 ms, with a 120 ms stall once
+static uint32_t taskRuns[4];
+static bool stall = false;
+
+static void fakeRender() {
+  taskRuns[0]++;
+  delayMicroseconds(stall ? 120000 : 30000);
+  stall = false;
+}
+
+static void fakeImu() {
+  taskRuns[1]++;
+  delayMicroseconds(1000);
+}
+
+static void fakeLog() {
+  taskRuns[2]++;
+  delayMicroseconds(5000);
+}
+
+static void fakeSerial() {
+  taskRuns[3]++;
+}
+
+static void checkScheduler() {
+  section("Loop scheduler, sensor stick tasks");
+  int8_t render = schedAdd(fakeRender, 50);
+  int8_t imu = schedAdd(fakeImu, 10);
+  int8_t log = schedAdd(fakeLog, 1000);
+  int8_t serial = schedAdd(fakeSerial, 0);
+  
+  const double duration = 10;
+  double end = seconds() + duration;
+  uint32_t triggered = millis() / 250;
+  schedLoad();
+  while (seconds() < end) {
+    schedRun();
+    if (taskRuns[0] == 100) stall = true;
+    // A byte comes in every 250 ms
+    if (millis() / 250 != triggered) {
+      triggered = millis() / 250;
+      schedTrigger(serial);
+    }
+  }
+  uint8_t load = schedLoad();
+  
+  SchedStats r, i, l, s;
+  schedGetStats(render, r);
+  schedGetStats(imu, i);
+  schedGetStats(log, l);
+  schedGetStats(serial, s);
+  check(r.runs >= 195 && r.runs <= 201 && r.skipped >= 1 && r.skipped <= 3,
+        "render %u runs, %u late, %u periods dropped after the stall", r.runs, r.late, r.skipped);
+  // Tasks don't preempt each other, the filter drops the periods a frame
+  // takes and catches up from the IMU ring afterwards
+  check(i.runs >= 550 && i.max_late_ms <= 125, "filter %u runs, %u periods dropped, worst %u ms late", i.runs,
+        i.skipped, i.max_late_ms);
+  check(l.runs == 10 || l.runs == 11, "log %u runs", l.runs);
+  check(s.runs >= 38 && s.runs <= 41 && s.max_late_ms <= 120, "serial %u triggered runs, worst %u ms late", s.runs,
+        s.max_late_ms);
+  double expect = (r.runs * 30.0 + 90 + i.runs * 1.0 + l.runs * 5.0) / (duration * 10);
+  check(fabs(load - expect) < 2, "loop busy %u%%, %.0f%% expected, asleep the rest", load, expect);
+  
+  // Leave the loop to the next check
+  schedSetPeriod(render, 0);
+  schedSetPeriod(imu, 0);
+  schedSetPeriod(log, 0);
+}
+
+// The weather clock's event driven loop: a frame on every clock tick and
+// when a reading comes in, 3 ms each (drawing and the band of rows that
+// changed), nothing in between
+static int8_t weatherRender, weatherTick, weatherSensor;
+static uint32_t weatherFrames = 0, weatherReadings = 0;
+
+static void weatherFrame() {
+  weatherFrames++;
+  delayMicroseconds(3000);
+}
+
+static void weatherClockTick() {
+  schedTrigger(weatherRender);
+}
+
+static void weatherReading() {
+  weatherReadings++;
+  schedTrigger(weatherRender);
+}
+
+static bool aonTick(repeating_timer_t *rt) {
+  (void)rt;
+  schedTrigger(weatherTick);
+  return true;
+}
+
+static void bmeUpdated(SensorId id) {
+  (void)id;
+  schedTrigger(weatherSensor);
+}
+
+// ═══════════════════════════════════════════════════════════
+// Weather clock
+// ═══════════════════════════════════════════════════════════
+
+static bool startWeather() {
+  if (!initBME280(WEATHER_PROFILE)) return false;
+  sensorAsyncSetRate(SENSOR_BME280, bme280PeriodMs());
+  return sensorAsyncBegin();
+}
+
+static void checkWeatherLoop() {
+  section("Loop scheduler, weather clock tasks");
+  World w;
+  w.env.add(0, { 18, 101000, 70, 0, 0.25, 0 });
+  if (!startWeather()) {
+    check(false, "start");
+    return;
+  }
+  sensorAsyncOnUpdate(bmeUpdated);
+  weatherRender = schedAdd(weatherFrame, 0);
+  weatherTick = schedAdd(weatherClockTick, 0);
+  weatherSensor = schedAdd(weatherReading, 0);
+  repeating_timer_t aon;
+  add_repeating_timer_ms(1000, aonTick, NULL, &aon);
+  
+  // The last reading comes a few ms after the full period
+  const double duration = 600;
+  double end = seconds() + duration + 0.1;
+  uint32_t passes = 0;
+  schedLoad();
+  while (seconds() < end) {
+    schedRun();
+    passes++;
+  }
+  uint16_t load = schedLoad(10000);
+  cancel_repeating_timer(&aon);
+  sensorAsyncOnUpdate(NULL);
+  sensorAsyncEnd();
+  sensorAsyncSetRate(SENSOR_BME280, 0);
+  
+  check(weatherReadings == 10 && weatherFrames >= 600 && weatherFrames <= 610,
+        "%u frames for %u ticks and %u readings", weatherFrames, (unsigned)duration, weatherReadings);
+  // A pass runs a task or sleeps until the next one
+  check(passes <= 2 * (weatherFrames * 2 + weatherReadings) + 10, "%.1f loop passes a second, asleep in between",
+        passes / duration);
+  double expect = weatherFrames * 3.0 / (duration * 10);
+  check(fabs(load / 100.0 - expect) < 0.02, "loop busy %.2f%%, %.2f%% expected", load / 100.0, expect);
+}
+
+static uint32_t buttonWakes = 0;
+
+static void buttonWake() {
+  buttonWakes++;
+}
+
+// Contacts bounce for 4 ms on both edges
+static void pressButton(int pin, uint32_t hold_ms) {
+  for (int i = 0; i < 5; i++) {
+    simPinSet(pin, i % 2 ? HIGH : LOW);
+    delay(1);
+  }
+  simPinSet(pin, LOW);
+  delay(hold_ms);
+  for (int i = 0; i < 5; i++) {
+    simPinSet(pin, i % 2 ? LOW : HIGH);
+    delay(1);
+  }
+  simPinSet(pin, HIGH);
+  delay(50);
+}
+
+static std::string buttonEvents() {
+  static const char types[] = "PRLT";
+  std::string s;
+  ButtonEvent e;
+  while (buttonsRead(e)) {
+    s += types[e.type];
+    s += (char)('0' + e.button);
+  }
+  return s;
+}
+
+static void checkButtons() {
+  section("Buttons, GPIO interrupts and debounce alarms");
+  static const uint8_t pins[] = { 14, 15, 16, 17 };
+  buttonsBegin(pins, 4, buttonWake);
+  
+  // Bouncy press and release: one of each, 20 ms after the bouncing stops
+  uint32_t start = millis();
+  pressButton(pins[1], 100);
+  ButtonEvent press, release;
+  bool got = buttonsRead(press) && buttonsRead(release);
+  check(got && press.type == BUTTON_PRESS && release.type == BUTTON_RELEASE && press.button == 1 &&
+        press.ms - start == 4 + BUTTON_DEBOUNCE_MS && buttonWakes == 2 && !buttonsRead(press),
+        "bouncy press: pressed after %u ms, released %u ms later, %u wake ups", press.ms - start,
+        release.ms - press.ms, buttonWakes);
+  
+  // Shorter than a loop with the old 200 ms debounce delay
+  pressButton(pins[0], 30);
+  std::string s = buttonEvents();
+  check(s == "P0R0", "30 ms press: %s", s.c_str());
+  
+  // Held for 1.5 s: long press at 800 ms, a repeat every 150 ms after
+  pressButton(pins[2], 1500);
+  s = buttonEvents();
+  check(s == "P2L2T2T2T2T2R2", "held 1.5 s: %s", s.c_str());
+  
+  // Two at once
+  simPinSet(pins[2], LOW);
+  simPinSet(pins[3], LOW);
+  delay(100);
+  bool both = buttonDown(2) && buttonDown(3) && !buttonDown(0);
+  simPinSet(pins[2], HIGH);
+  simPinSet(pins[3], HIGH);
+  delay(100);
+  s = buttonEvents();
+  check(both && s == "P2P3R2R3", "X and Y together: %s", s.c_str());
+  
+  // Nobody reading: the queue fills up, the rest is counted
+  for (int i = 0; i < BUTTON_QUEUE_SIZE; i++) pressButton(pins[0], 30);
+  s = buttonEvents();
+  check(s.size() == 2 * (BUTTON_QUEUE_SIZE - 1) && buttonsDropped() == BUTTON_QUEUE_SIZE + 1,
+        "%d presses unread: %zu events kept, %u dropped", BUTTON_QUEUE_SIZE, s.size() / 2, buttonsDropped());
+  for (uint8_t pin : pins) detachInterrupt(pin);
+}
+
+static void checkForcedMode() {
+  section("BME280 forced mode, weather clock setup");
+  World w;
+  w.env.add(0, { 18, 101000, 70, 0, 0.25, 0 });
+  if (!startWeather()) {
+    check(false, "start");
+    return;
+  }
+  
+  const double duration = 600;
+  simBusResetStats();
+  uint32_t conversions = w.bme.conversions;
+  uint64_t active = w.bme.active_us;
+  SensorAsyncStats before, after;
+  sensorAsyncGetStats(before);
+  // The last shot is read a few ms after the full period
+  delay((uint32_t)(duration * 1000) + 100);
+  sensorAsyncGetStats(after);
+  SimBusStats bus = simBusStats();
+  
+  uint32_t updates = after.updates[SENSOR_BME280] - before.updates[SENSOR_BME280];
+  uint32_t expect = (uint32_t)(duration * 1000 / bme280PeriodMs());
+  check(updates == expect && after.errors == before.errors, "%u updates in %.0f s, %u expected, %u errors", updates,
+        duration, expect, after.errors - before.errors);
+  check(bus.transactions == 2 * updates, "%u transactions, trigger and read per update", bus.transactions);
+  double duty = (w.bme.active_us - active) / (duration * 1e4);
+  check(w.bme.conversions - conversions == updates, "%u conversions, converting %.4f%% of the time",
+        w.bme.conversions - conversions, duty);
+  
+  SensorData d;
+  sensorAsyncSnapshot(d);
+  check(fabsf(d.pressure - 1010.0f) < 0.05f && fabsf(d.temperature - 18.0f) < 0.02f, "snapshot %.2f C %.2f hPa",
+        d.temperature, d.pressure);
+  sensorAsyncEnd();
+  sensorAsyncSetRate(SENSOR_BME280, 0);
+}
+
+// Least squares line through the samples in the newest window slots in
+// doubles, the reference for the running sums
+static PressureTrend batchTrend(uint16_t window) {
+  double sx = 0, sy = 0, sxx = 0, sxy = 0;
+  std::vector<double> xs, ys;
+  for (uint16_t age = 0; age < window; age++) {
+    PressureBucket b;
+    if (!pressureHistoryAt(PRESSURE_RAW, age, b)) break;
+    if (isnan(b.avg)) continue;
+    // The stored 0.01 hPa steps, without the float rounding
+    double x = -(double)age, y = round(b.avg * 100.0) / 100.0;
+    xs.push_back(x);
+    ys.push_back(y);
+    sx += x;
+    sy += y;
+    sxx += x * x;
+    sxy += x * y;
+  }
+  int n = xs.size();
+  double slope = (n * sxy - sx * sy) / (n * sxx - sx * sx);
+  double icept = (sy - slope * sx) / n;
+  double sse = 0;
+  for (int i = 0; i < n; i++) {
+    double r = ys[i] - (icept + slope * xs[i]);
+    sse += r * r;
+  }
+  PressureTrend t;
+  t.slope = slope * 3600000.0 / SAMPLE_INTERVAL;
+  t.now = icept;
+  t.variance = n > 2 ? sse / (n - 2) : 0;
+  t.samples = n;
+  return t;
+}
+
+static double gauss() {
+  // Sum of uniforms, close enough
+  double g = 0;
+  for (int i = 0; i < 12; i++) g += rand() / (double)RAND_MAX;
+  return g - 6;
+}
+
+static void checkPressureTrend() {
+  section("Pressure trend, running least squares");
+  struct Window {
+    const char *name;
+    PressureWindow window;
+    uint16_t size;
+  };
+  static const Window windows[] = {
+    { "1 h", PRESSURE_WINDOW_1H, PRESSURE_1H_SAMPLES },
+    { "3 h", PRESSURE_WINDOW_3H, PRESSURE_3H_SAMPLES },
+  };
+  
+  // After every sample of 3 days, wrapping the raw ring, with the station
+  // off for 5 minutes to 4 hours now and then
+  pressureHistoryClear();
+  srand(7);
+  double worst_slope = 0, worst_now = 0, worst_var = 0;
+  uint32_t compared = 0, gaps = 0;
+  for (int i = 0; i < 3 * 288; i++) {
+    if (i % 97 == 96) {
+      pressureHistoryGap(1 + (i * 7) % 48);
+      gaps++;
+    }
+    pressureHistoryAdd(1008 + 9 * sin(i / 50.0) + 0.3 * gauss());
+    for (const Window &w : windows) {
+      PressureTrend t;
+      if (!pressureHistoryTrend(w.window, t)) continue;
+      PressureTrend ref = batchTrend(w.size);
+      worst_slope = fmax(worst_slope, fabs(t.slope - ref.slope));
+      worst_now = fmax(worst_now, fabs(t.now - ref.now));
+      worst_var = fmax(worst_var, fabs(t.variance - ref.variance) / fmax(ref.variance, 1e-6));
+      compared++;
+    }
+  }
+  check(worst_slope < 1e-4 && worst_now < 1e-3 && worst_var < 1e-4,
+        "%u fits with %u gaps like the batch fit: slope %.1e hPa/h, line %.1e hPa, variance %.1e relative",
+        compared, gaps, worst_slope, worst_now, worst_var);
+  
+  // Saved and loaded back, the way the weather clock restores it
+  uint32_t size;
+  std::vector<uint8_t> saved(0);
+  void *state = pressureHistoryState(size);
+  saved.assign((uint8_t *)state, (uint8_t *)state + size);
+  PressureTrend before, after;
+  pressureHistoryTrend(PRESSURE_WINDOW_3H, before);
+  pressureHistoryClear();
+  memcpy(pressureHistoryState(size), saved.data(), size);
+  bool loaded = pressureHistoryLoaded();
+  pressureHistoryTrend(PRESSURE_WINDOW_3H, after);
+  check(loaded && after.slope == before.slope && after.variance == before.variance &&
+        after.samples == before.samples, "%u bytes saved and loaded, trend %+.3f hPa/h from %u samples", size,
+        after.slope, after.samples);
+  memset(pressureHistoryState(size), 0xA5, size);
+  check(!pressureHistoryLoaded() && pressureHistoryCount(PRESSURE_RAW) == 0, "garbage loaded: history cleared");
+  
+  // Off for longer than the window: no trend until new samples come in
+  pressureHistoryClear();
+  for (int i = 0; i < 50; i++) pressureHistoryAdd(1010);
+  pressureHistoryGap(PRESSURE_3H_SAMPLES);
+  PressureTrend t;
+  bool stale = !pressureHistoryTrend(PRESSURE_WINDOW_3H, t) && t.samples == 0;
+  pressureHistoryAdd(1011);
+  pressureHistoryAdd(1012);
+  bool fresh = pressureHistoryTrend(PRESSURE_WINDOW_3H, t);
+  check(stale && fresh && t.samples == 2 && fabs(t.slope - 12) < 0.01,
+        "3 h gap ages the window out, then %+.2f hPa/h from %u new samples", t.slope, t.samples);
+  
+  // Noisy samples: the old trend from the oldest to the newest sample
+  // against the line
+  for (double noise : { 0.03, 0.1 }) {
+    double sq_ends = 0, sq_fit = 0;
+    const int trials = 2000;
+    for (int k = 0; k < trials; k++) {
+      double slope = (k % 9 - 4) * 0.6;
+      pressureHistoryClear();
+      double p = 0;
+      for (int i = 0; i < PRESSURE_SAMPLES; i++) {
+        p = 1010 + slope * i * SAMPLE_INTERVAL / 3600000.0 + noise * gauss();
+        pressureHistoryAdd(p);
+      }
+      PressureBucket oldest;
+      pressureHistoryAt(PRESSURE_RAW, PRESSURE_SAMPLES - 1, oldest);
+      double ends = (p - oldest.avg) / (PRESSURE_SAMPLES * (double)SAMPLE_INTERVAL / 3600000.0);
+      PressureTrend t;
+      pressureHistoryTrend(PRESSURE_WINDOW_3H, t);
+      sq_ends += (ends - slope) * (ends - slope);
+      sq_fit += (t.slope - slope) * (t.slope - slope);
+    }
+    double rms_ends = sqrt(sq_ends / trials), rms_fit = sqrt(sq_fit / trials);
+    check(rms_fit < rms_ends / 2, "%.2f hPa noise: trend off by %.3f hPa/h rms, %.3f from the two ends", noise,
+          rms_fit, rms_ends);
+  }
+}
+
+// Truth of a bucket in doubles
+struct Truth {
+  double min, max, sum;
+  int count;
+  
+  void add(double v) {
+    if (count == 0 || v < min) min = v;
+    if (count == 0 || v > max) max = v;
+    sum += v;
+    count++;
+  }
+  
+  double offBy(const PressureBucket &b) const {
+    return fmax(fabs(b.min - min), fmax(fabs(b.avg - sum / count), fabs(b.max - max)));
+  }
+};
+
+static void checkPressureHistory() {
+  section("Pressure history tiers, 100 days of samples");
+  // Fronts passing every few days, a daily tide and sensor noise
+  const int days = 100;
+  const int per_hour = 3600000 / PRESSURE_SAMPLE_MS;
+  std::vector<double> samples;
+  srand(42);
+  for (int i = 0; i < days * 24 * per_hour; i++) {
+    double h = i / (double)per_hour;
+    double p = 1013 + 18 * sin(h / 70) + 6 * sin(h / 19) + 1.2 * sin(h * 2 * M_PI / 12) +
+               (rand() / (double)RAND_MAX - 0.5) * 0.1;
+    samples.push_back(p);
+  }
+  
+  pressureHistoryClear();
+  for (double p : samples) pressureHistoryAdd(p);
+  const int n = samples.size();
+  
+  // Raw: the last day as it was
+  double worst = 0;
+  PressureBucket b;
+  for (uint16_t age = 0; pressureHistoryAt(PRESSURE_RAW, age, b); age++) {
+    worst = fmax(worst, fabs(b.avg - samples[n - 1 - age]));
+  }
+  check(pressureHistoryCount(PRESSURE_RAW) == PRESSURE_RAW_SAMPLES && worst <= 0.006,
+        "raw: %u samples, worst %.4f hPa off", pressureHistoryCount(PRESSURE_RAW), worst);
+  
+  // Hours and days against the truth of their samples
+  struct Tier {
+    const char *name;
+    PressureTier tier;
+    int samples_per_bucket;
+    uint16_t size;
+  };
+  static const Tier tiers[] = {
+    { "hourly", PRESSURE_HOURLY, per_hour, PRESSURE_HOURLY_BUCKETS },
+    { "daily", PRESSURE_DAILY, per_hour * 24, PRESSURE_DAILY_BUCKETS },
+  };
+  for (const Tier &t : tiers) {
+    worst = 0;
+    uint16_t count = pressureHistoryCount(t.tier);
+    int closed = n / t.samples_per_bucket;
+    for (uint16_t age = 0; pressureHistoryAt(t.tier, age, b); age++) {
+      Truth truth = {};
+      int first = (closed - 1 - age) * t.samples_per_bucket;
+      for (int i = first; i < first + t.samples_per_bucket; i++) truth.add(samples[i]);
+      worst = fmax(worst, truth.offBy(b));
+    }
+    uint16_t expect = closed < t.size ? closed : t.size;
+    check(count == expect && worst <= 0.006, "%s: %u buckets, %u expected, min/avg/max worst %.4f hPa off", t.name,
+          count, expect, worst);
+  }
+  
+  // Half an hour into a new hour: the open buckets
+  for (int i = 0; i < per_hour / 2; i++) pressureHistoryAdd(1001.5 + i * 0.1);
+  bool open = pressureHistoryOpen(PRESSURE_HOURLY, b);
+  check(open && fabs(b.min - 1001.5) < 0.006 && fabs(b.max - (1001.5 + (per_hour / 2 - 1) * 0.1)) < 0.006,
+        "open hour %.2f to %.2f hPa", b.min, b.max);
+  
+  // Out of the int16 range: clamped, not wrapped
+  pressureHistoryClear();
+  pressureHistoryAdd(1400);
+  pressureHistoryAdd(600);
+  PressureBucket high, low;
+  pressureHistoryAt(PRESSURE_RAW, 1, high);
+  pressureHistoryAt(PRESSURE_RAW, 0, low);
+  check(high.avg > 1340 && low.avg < 687, "1400 and 600 hPa stored as %.2f and %.2f", high.avg, low.avg);
+  
+  size_t bytes = PRESSURE_RAW_SAMPLES * 2 + (PRESSURE_HOURLY_BUCKETS + PRESSURE_DAILY_BUCKETS) * 6;
+  printf("%zu bytes for %d h of samples, %d days of hours, %d days\n", bytes, PRESSURE_RAW_SAMPLES / per_hour,
+         PRESSURE_HOURLY_BUCKETS / 24, PRESSURE_DAILY_BUCKETS);
+}
+
+static void checkBarograph() {
+  section("Barograph, 3 days of samples");
+  const int height = 32;
+  const int per_hour = 3600000 / PRESSURE_SAMPLE_MS;
+  pressureHistoryClear();
+  barographBegin(height);
+  
+  // Shifted column by column, against plotting all of it again now and then
+  uint32_t added = 0, replots = 0, compared = 0, differ = 0, outside = 0;
+  srand(7);
+  for (int i = 0; i < 3 * 24 * per_hour; i++) {
+    double h = i / (double)per_hour;
+    double p = 1009 + 9 * sin(h / 15) + 0.8 * sin(h * 2 * M_PI / 12) + (rand() / (double)RAND_MAX - 0.5) * 0.1;
+    pressureHistoryAdd(p);
+    int16_t low, high;
+    barographRange(low, high);
+    bool replot = barographShift();
+    int16_t new_low, new_high;
+    barographRange(new_low, new_high);
+    if (replot != (low != new_low || high != new_high)) outside++;
+    PressureBucket stored;
+    pressureHistoryAt(PRESSURE_RAW, 0, stored);
+    if (stored.avg < new_low || stored.avg > new_high) outside++;
+    replots += replot;
+    added++;
+    
+    if (i % 50 == 49) {
+      BarographSpan shifted[BAROGRAPH_COLUMNS];
+      for (uint16_t x = 0; x < BAROGRAPH_COLUMNS; x++) shifted[x] = barographColumn(x);
+      barographBegin(height);
+      for (uint16_t x = 0; x < BAROGRAPH_COLUMNS; x++) {
+        BarographSpan full = barographColumn(x);
+        differ += full.top != shifted[x].top || full.bottom != shifted[x].bottom;
+      }
+      compared++;
+    }
+  }
+  check(differ == 0 && compared > 0, "%u comparisons with a full plot, %u columns differ", compared, differ);
+  check(outside == 0 && replots < added / 10, "%u samples, %u full plots when the envelope moved", added, replots);
+  
+  // The newest sample is plotted at its row, joined to the one before
+  PressureBucket b0, b1;
+  pressureHistoryAt(PRESSURE_RAW, 0, b0);
+  pressureHistoryAt(PRESSURE_RAW, 1, b1);
+  int16_t low, high;
+  barographRange(low, high);
+  BarographSpan newest = barographColumn(BAROGRAPH_COLUMNS - 1);
+  int row0 = lround((height - 1) - (b0.avg - low) * (height - 1) / (high - low));
+  int row1 = lround((height - 1) - (b1.avg - low) * (height - 1) / (high - low));
+  check(newest.top == std::min(row0, row1) && newest.bottom == std::max(row0, row1),
+        "%.2f hPa after %.2f in %d to %d hPa: rows %u to %u", b0.avg, b1.avg, low, high, newest.top, newest.bottom);
+  
+  // Half an hour off: empty columns, a dot where it picks up again
+  pressureHistoryGap(per_hour / 2);
+  barographBegin(height);
+  pressureHistoryAdd(b0.avg);
+  barographShift();
+  uint16_t empty = 0;
+  for (uint16_t x = 0; x < BAROGRAPH_COLUMNS; x++) {
+    BarographSpan span = barographColumn(x);
+    empty += span.top > span.bottom;
+  }
+  BarographSpan dot = barographColumn(BAROGRAPH_COLUMNS - 1);
+  check(empty == per_hour / 2 && dot.top == dot.bottom, "%u empty columns after a %d min gap, then a dot", empty,
+        per_hour / 2 * PRESSURE_SAMPLE_MS / 60000);
+}
+
+static void checkForecast() {
+  section("Forecast, 3 hours of weather clock per case");
+  struct Case {
+    const char *name;
+    double start_hpa, hpa_per_hour;
+    Forecast expect;
+  };
+  static const Case cases[] = {
+    { "rising fast", 1004, 2.5, FORECAST_FAIR },
+    { "rising, high", 1021, 1.0, FORECAST_SUNNY },
+    { "steady, high", 1025, 0.0, FORECAST_SUNNY },
+    { "steady", 1012, 0.1, FORECAST_FAIR },
+    { "steady, low", 995, -0.2, FORECAST_CHANGING },
+    { "falling, high", 1022, -1.0, FORECAST_CHANGING },
+    { "falling, low", 1008, -1.2, FORECAST_RAIN },
+    { "falling fast", 1012, -2.6, FORECAST_RAIN },
+    { "falling fast, low", 1003, -3.5, FORECAST_STORM },
+  };
+  
+  for (const Case &c : cases) {
+    World w;
+    double t0 = seconds();
+    w.env.pressure_noise = 3;
+    w.env.add(t0, { 15, c.start_hpa * 100, 60, 0, 0.25, 0 });
+    w.env.add(t0 + 4 * 3600, { 15, (c.start_hpa + 4 * c.hpa_per_hour) * 100, 60, 0, 0.25, 0 });
+    if (!startWeather()) {
+      check(false, "%s: start", c.name);
+      continue;
+    }
+    
+    pressureHistoryClear();
+    SensorData d;
+    for (int i = 0; i < PRESSURE_SAMPLES; i++) {
+      delay(SAMPLE_INTERVAL);
+      sensorAsyncSnapshot(d);
+      pressureHistoryAdd(d.pressure);
+    }
+    PressureTrend trend;
+    pressureHistoryTrend(PRESSURE_WINDOW_3H, trend);
+    ForecastResult r = classifyForecast(d.pressure, trend.slope);
+    check(r.forecast == c.expect, "%-18s %7.1f hPa %+5.2f hPa/h: %s", c.name, d.pressure, trend.slope, r.text);
+    sensorAsyncEnd();
+    sensorAsyncSetRate(SENSOR_BME280, 0);
+  }
+}
+
+static void checkProfileCost() {
+  section("BME280 profiles, 60 s each");
+  static const char *names[] = { "continuous", "weather", "indoor" };
+  for (int profile = 0; profile < BME280_PROFILE_COUNT; profile++) {
+    World w;
+    initBME280((Bme280Profile)profile);
+    sensorAsyncSetRate(SENSOR_BME280, bme280PeriodMs());
+    sensorAsyncBegin();
+    simBusResetStats();
+    uint32_t conversions = w.bme.conversions;
+    uint64_t active = w.bme.active_us;
+    delay(60100);
+    SimBusStats bus = simBusStats();
+    printf("%-10s %5u conversions, converting %7.3f%% of the time, %5u transactions\n", names[profile],
+           w.bme.conversions - conversions, (w.bme.active_us - active) / 6e5, bus.transactions);
+    sensorAsyncEnd();
+    sensorAsyncSetRate(SENSOR_BME280, 0);
+  }
+}
+
+// ═══════════════════════════════════════════════════════════
+// Replay
+// ═══════════════════════════════════════════════════════════
+
+static int replay(World &w, bool weather, double duration, double period) {
+  bool ok = weather ? startWeather() : startStick(w, -1);
+  if (!ok) {
+    fprintf(stderr, "Sensors did not start\n");
+    return 1;
+  }
+  
+  ImuFusion f;
+  fusionInit(f, STICK_IMU_RATE_HZ);
+  static ImuSample samples[64];
+  simBusResetStats();
+  double start = seconds(), next = start + period;
+  printf("time_s,temp_C,humidity,pressure_hPa,lux,proximity%s\n", weather ? "" : ",roll,pitch");
+  while (seconds() < start + duration) {
+    delay(10);
+    uint16_t got;
+    while (!weather && (got = imuFifoRead(samples, 64)) > 0) {
+      for (uint16_t i = 0; i < got; i++) {
+        SensorData d;
+        imuSampleToSensorData(samples[i], d);
+        fusionUpdate(f, d.gyroX, d.gyroY, d.gyroZ, d.accelX, d.accelY, d.accelZ);
+      }
+    }
+    if (seconds() < next) continue;
+    next += period;
+    
+    SensorData d;
+    sensorAsyncSnapshot(d);
+    printf("%.0f,%.2f,%.2f,%.2f,%.1f,%u", seconds() - start, d.temperature, d.humidity, d.pressure, d.lux,
+           d.proximity);
+    if (!weather) {
+      float roll, pitch, yaw;
+      fusionEuler(f, roll, pitch, yaw);
+      printf(",%.1f,%.1f", roll, pitch);
+    }
+    printf("\n");
+  }
+  
+  SensorAsyncStats st;
+  sensorAsyncGetStats(st);
+  fprintf(stderr, "%u BME280, %u IMU, %u LTR-559 updates, %u errors, %u IMU samples\n", st.updates[SENSOR_BME280],
+          st.updates[SENSOR_LSM6DS3], st.updates[SENSOR_LTR559], st.errors, st.imu_samples);
+  SimBusStats bus = simBusStats();
+  fprintf(stderr, "%u transactions, %u bytes, bus busy %.2f%%, BME280 converting %.3f%%\n", bus.transactions,
+          bus.bytes, bus.busy_us / duration / 1e4, w.bme.active_us / duration / 1e4);
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  const char *env_path = NULL;
+  const char *imu_path = NULL;
+  bool weather = false;
+  double duration = 0, period = 60;
+  
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-v") == 0) {
+      Serial.echo = true;
+    } else if (strcmp(argv[i], "--weather") == 0) {
+      weather = true;
+    } else if (strcmp(argv[i], "--env") == 0 && i + 1 < argc) {
+      env_path = argv[++i];
+    } else if (strcmp(argv[i], "--imu") == 0 && i + 1 < argc) {
+      imu_path = argv[++i];
+    } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+      duration = atof(argv[++i]);
+    } else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+      period = atof(argv[++i]);
+    } else {
+      fprintf(stderr, "usage: sensorstick_sim [-v]\n"
+                      "       sensorstick_sim [--weather] [--env log.csv] [--imu trace.csv] [-s seconds] [-p period]\n");
+      return 1;
+    }
+  }
+  
+  if (env_path || imu_path || duration > 0) {
+    World w;
+    if (env_path && !w.env.load(env_path)) return 1;
+    if (imu_path && !w.motion.load(imu_path)) return 1;
+    if (duration <= 0) duration = env_path ? w.env.duration() : 60;
+    if (period <= 0) period = 60;
+    return replay(w, weather, duration, period);
+  }
+  
+  checkBME280();
+  checkLuxFixedPoint();
+  checkLTR559();
+  checkLSM6DS3();
+  checkAsync(-1);
+  checkAsync(INT1_PIN);
+  benchBlocking();
+  checkLightRange();
+  checkTimeout();
+  checkScheduler();
+  checkWeatherLoop();
+  checkButtons();
+  checkForcedMode();
+  checkProfileCost();
+  checkPressureHistory();
+  checkPressureTrend();
+  checkBarograph();
+  checkForecast();
+  
+  printf("\n%s, %d failed\n", failures ? "FAILED" : "all passed", failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,99 @@
+#ifndef _SIM_ARDUINO_H_
+#define _SIM_ARDUINO_H_
+
+// The bits of the Arduino core the sensor code uses, on top of the
+// simulated clock in i2csim.cpp
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+
+#define INPUT         0
+#define OUTPUT        1
+#define INPUT_PULLUP  2
+#define LOW           0
+#define HIGH          1
+#define RISING        3
+#define FALLING       2
+#define CHANGE        4
+
+#define PI            3.14159265358979323846
+#define DEG_TO_RAD    0.017453292519943295769236907684886
+#define RAD_TO_DEG    57.295779513082320876798154814105
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+#define digitalPinToInterrupt(p) (p)
+#define __not_in_flash_func(x) x
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+
+void pinMode(int pin, int mode);
+int digitalRead(int pin);
+void attachInterrupt(int pin, void (*isr)(void), int mode);
+void detachInterrupt(int pin);
+
+static inline void noInterrupts() {}
+static inline void interrupts() {}
+
+// Busy loops are where the simulated time moves on by itself
+void tight_loop_contents();
+
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  
+  size_t write(const uint8_t *buf, size_t len) {
+    for (size_t i = 0; i < len; i++) write(buf[i]);
+    return len;
+  }
+  size_t print(const char *s) { return write((const uint8_t *)s, strlen(s)); }
+  size_t print(const std::string &s) { return print(s.c_str()); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(int v) { return printf("%d", v); }
+  size_t print(unsigned int v) { return printf("%u", v); }
+  size_t print(long v) { return printf("%ld", v); }
+  size_t print(unsigned long v) { return printf("%lu", v); }
+  size_t print(double v, int digits = 2) { return printf("%.*f", digits, v); }
+  
+  template <typename T> size_t println(T v) { return print(v) + println(); }
+  size_t println(double v, int digits) { return print(v, digits) + println(); }
+  size_t println() { return print("\r\n"); }
+  
+  size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+// Output goes to stdout when echo is on, input comes from feed()
+class SimSerial : public Print {
+public:
+  SimSerial() : echo(false) {}
+  size_t write(uint8_t c) override;
+  void begin(unsigned long baud) { (void)baud; }
+  int available() { return (int)input.size(); }
+  int read();
+  void feed(const char *s) { input += s; }
+  operator bool() { return true; }
+  
+  bool echo;
+
+private:
+  std::string input;
+};
+
+extern SimSerial Serial;
+
+struct SimRP2040 {
+  void idleOtherCore() {}
+  void resumeOtherCore() {}
+};
+
+extern SimRP2040 rp2040;
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef _SIM_WIRE_H_
+#define _SIM_WIRE_H_
+
+// arduino-pico's TwoWire on the simulated bus in i2csim.cpp, blocking and
+// async (DMA) calls with the same signatures
+
+#include <Arduino.h>
+
+class TwoWire {
+public:
+  TwoWire();
+  void begin() {}
+  void end() {}
+  void setClock(uint32_t hz) { clock = hz; }
+  
+  void beginTransmission(uint8_t addr);
+  size_t write(uint8_t value);
+  size_t write(const uint8_t *data, size_t len);
+  uint8_t endTransmission(bool stop = true);
+  size_t requestFrom(uint8_t addr, size_t len, bool stop = true);
+  int available();
+  int read();
+  
+  bool writeReadAsync(uint8_t addr, const void *wbuffer, size_t wbytes, const void *rbuffer, size_t rbytes,
+                      bool stop = true);
+  bool writeAsync(uint8_t addr, const void *buffer, size_t bytes, bool stop = true);
+  bool readAsync(uint8_t addr, void *buffer, size_t bytes, bool stop = true);
+  bool finishedAsync();
+  void abortAsync();
+  void onFinishedAsync(void (*cb)(void)) { asyncCallback = cb; }
+  
+  // Called by the simulated clock when the async transfer is done
+  void completeAsync();
+  
+  uint32_t clock;
+
+private:
+  uint8_t txAddr;
+  uint8_t txBuf[256];
+  size_t txLen;
+  uint8_t rxBuf[256];
+  size_t rxLen, rxPos;
+  
+  const uint8_t *asyncWrite;
+  size_t asyncWriteLen;
+  uint8_t *asyncRead;
+  size_t asyncReadLen;
+  uint8_t asyncAddr;
+  void (*asyncCallback)(void);
+};
+
+extern TwoWire Wire;
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef _SIM_HARDWARE_SYNC_H_
+#define _SIM_HARDWARE_SYNC_H_
+
+// Interrupts only fire while the simulated clock moves, never in the
+// middle of a critical section, so there is nothing to disable
+
+#include <stdint.h>
+
+static inline uint32_t save_and_disable_interrupts() { return 0; }
+static inline void restore_interrupts(uint32_t status) { (void)status; }
+static inline void __dmb() { __atomic_signal_fence(__ATOMIC_SEQ_CST); }
+
+// Sleeps until the next timer, alarm, transfer or device event
+void __wfi();
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef _SIM_PICO_TIME_H_
+#define _SIM_PICO_TIME_H_
+
+// Timers and alarms of the pico SDK, fired by the simulated clock
+
+#include <stdint.h>
+
+typedef struct repeating_timer repeating_timer_t;
+typedef bool (*repeating_timer_callback_t)(repeating_timer_t *rt);
+
+struct repeating_timer {
+  int64_t delay_us;
+  repeating_timer_callback_t callback;
+  void *user_data;
+  uint64_t next_us;
+};
+
+bool add_repeating_timer_us(int64_t delay_us, repeating_timer_callback_t callback, void *user_data,
+                            repeating_timer_t *out);
+static inline bool add_repeating_timer_ms(int32_t delay_ms, repeating_timer_callback_t callback, void *user_data,
+                                          repeating_timer_t *out) {
+  return add_repeating_timer_us((int64_t)delay_ms * 1000, callback, user_data, out);
+}
+bool cancel_repeating_timer(repeating_timer_t *timer);
+
+// One shot alarms, the callback returns 0 or the microseconds to the next
+typedef int32_t alarm_id_t;
+typedef int64_t (*alarm_callback_t)(alarm_id_t id, void *user_data);
+
+alarm_id_t add_alarm_in_us(uint64_t us, alarm_callback_t callback, void *user_data, bool fire_if_past);
+static inline alarm_id_t add_alarm_in_ms(uint32_t ms, alarm_callback_t callback, void *user_data,
+                                         bool fire_if_past) {
+  return add_alarm_in_us((uint64_t)ms * 1000, callback, user_data, fire_if_past);
+}
+bool cancel_alarm(alarm_id_t alarm_id);
+
+#endif
@@ -0,0 +1,100 @@
+#include "imufusion.h"
+#include <math.h>
+
+#define FUSION_GRAVITY     9.80665f
+// Accel magnitude outside 1 g ± this share is not used for correction
+#define FUSION_ACCEL_GATE  0.15f
+
+void fusionInit(ImuFusion &f, float rate_hz, float beta) {
+  f.q0 = 1.0f;
+  f.q1 = f.q2 = f.q3 = 0.0f;
+  f.beta = beta;
+  f.dt = 1.0f / rate_hz;
+  f.started = false;
+  f.updates = 0;
+  f.rejected = 0;
+}
+
+// Quaternion for the tilt measured by the accel, yaw zero
+static void fusionStart(ImuFusion &f, float ax, float ay, float az) {
+  float roll = atan2f(ay, az);
+  float pitch = atan2f(-ax, sqrtf(ay * ay + az * az));
+  float cr = cosf(roll * 0.5f), sr = sinf(roll * 0.5f);
+  float cp = cosf(pitch * 0.5f), sp = sinf(pitch * 0.5f);
+  f.q0 = cr * cp;
+  f.q1 = sr * cp;
+  f.q2 = cr * sp;
+  f.q3 = -sr * sp;
+  f.started = true;
+}
+
+void fusionUpdate(ImuFusion &f, float gx, float gy, float gz, float ax, float ay, float az) {
+  float accelSq = ax * ax + ay * ay + az * az;
+  if (!f.started) {
+    if (accelSq == 0.0f) return;
+    fusionStart(f, ax, ay, az);
+  }
+  f.updates++;
+  
+  float q0 = f.q0, q1 = f.q1, q2 = f.q2, q3 = f.q3;
+  
+  // Rate of change from the gyro
+  float qDot0 = 0.5f * (-q1 * gx - q2 * gy - q3 * gz);
+  float qDot1 = 0.5f * (q0 * gx + q2 * gz - q3 * gy);
+  float qDot2 = 0.5f * (q0 * gy - q1 * gz + q3 * gx);
+  float qDot3 = 0.5f * (q0 * gz + q1 * gy - q2 * gx);
+  
+  // Gradient descent step towards the accel direction, only when the
+  // accel is close to gravity. The gate compares squares to skip a sqrt.
+  const float lo = (1.0f - FUSION_ACCEL_GATE) * (1.0f - FUSION_ACCEL_GATE) * FUSION_GRAVITY * FUSION_GRAVITY;
+  const float hi = (1.0f + FUSION_ACCEL_GATE) * (1.0f + FUSION_ACCEL_GATE) * FUSION_GRAVITY * FUSION_GRAVITY;
+  if (accelSq > lo && accelSq < hi) {
+    float recipNorm = 1.0f / sqrtf(accelSq);
+    ax *= recipNorm;
+    ay *= recipNorm;
+    az *= recipNorm;
+    
+    float _2q0 = 2.0f * q0, _2q1 = 2.0f * q1, _2q2 = 2.0f * q2, _2q3 = 2.0f * q3;
+    float _4q0 = 4.0f * q0, _4q1 = 4.0f * q1, _4q2 = 4.0f * q2;
+    float _8q1 = 8.0f * q1, _8q2 = 8.0f * q2;
+    float q0q0 = q0 * q0, q1q1 = q1 * q1, q2q2 = q2 * q2, q3q3 = q3 * q3;
+    
+    float s0 = _4q0 * q2q2 + _2q2 * ax + _4q0 * q1q1 - _2q1 * ay;
+    float s1 = _4q1 * q3q3 - _2q3 * ax + 4.0f * q0q0 * q1 - _2q0 * ay - _4q1 + _8q1 * q1q1 + _8q1 * q2q2 + _4q1 * az;
+    float s2 = 4.0f * q0q0 * q2 + _2q0 * ax + _4q2 * q3q3 - _2q3 * ay - _4q2 + _8q2 * q1q1 + _8q2 * q2q2 + _4q2 * az;
+    float s3 = 4.0f * q1q1 * q3 - _2q1 * ax + 4.0f * q2q2 * q3 - _2q2 * ay;
+    float sNorm = s0 * s0 + s1 * s1 + s2 * s2 + s3 * s3;
+    
+    // Zero when the estimate already matches the accel exactly
+    if (sNorm > 0.0f) {
+      recipNorm = f.beta / sqrtf(sNorm);
+      qDot0 -= recipNorm * s0;
+      qDot1 -= recipNorm * s1;
+      qDot2 -= recipNorm * s2;
+      qDot3 -= recipNorm * s3;
+    }
+  } else {
+    f.rejected++;
+  }
+  
+  q0 += qDot0 * f.dt;
+  q1 += qDot1 * f.dt;
+  q2 += qDot2 * f.dt;
+  q3 += qDot3 * f.dt;
+  
+  float recipNorm = 1.0f / sqrtf(q0 * q0 + q1 * q1 + q2 * q2 + q3 * q3);
+  f.q0 = q0 * recipNorm;
+  f.q1 = q1 * recipNorm;
+  f.q2 = q2 * recipNorm;
+  f.q3 = q3 * recipNorm;
+}
+
+void fusionEuler(const ImuFusion &f, float &roll, float &pitch, float &yaw) {
+  const float toDeg = 57.2957795f;
+  float sinPitch = 2.0f * (f.q0 * f.q2 - f.q1 * f.q3);
+  if (sinPitch > 1.0f) sinPitch = 1.0f;
+  if (sinPitch < -1.0f) sinPitch = -1.0f;
+  roll = atan2f(f.q0 * f.q1 + f.q2 * f.q3, 0.5f - f.q1 * f.q1 - f.q2 * f.q2) * toDeg;
+  pitch = asinf(sinPitch) * toDeg;
+  yaw = atan2f(f.q1 * f.q2 + f.q0 * f.q3, 0.5f - f.q2 * f.q2 - f.q3 * f.q3) * toDeg;
+}
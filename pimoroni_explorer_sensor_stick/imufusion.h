@@ -0,0 +1,36 @@
+#ifndef _IMUFUSION_H_
+#define _IMUFUSION_H_
+
+#include <stdint.h>
+
+// Madgwick orientation filter (gyro + accel, no magnetometer) in single
+// precision, which the M33 FPU does in hardware. Feed it every IMU sample
+// at the full FIFO rate. Plain C++ without Arduino so the host checker in
+// host/ runs the exact same code.
+
+struct ImuFusion {
+  float q0, q1, q2, q3;  // orientation, sensor frame to earth frame
+  float beta;            // accel correction gain, higher follows accel faster
+  float dt;              // seconds per sample
+  bool started;          // first sample sets roll/pitch straight from accel
+  uint32_t updates;
+  uint32_t rejected;     // samples where the accel was not trusted
+};
+
+// Default gain, ~0.05 rad/s of correction: enough to cancel a few deg/s of
+// gyro bias while hand movements barely pull the horizon. Picked with
+// host/imufusion_check.
+#define FUSION_BETA  0.05f
+
+void fusionInit(ImuFusion &f, float rate_hz, float beta = FUSION_BETA);
+
+// Gyro in rad/s, accel in m/s^2. The accel correction is skipped while the
+// measured acceleration is far from 1 g (the board is being moved), then
+// the gyro carries the orientation on its own.
+void fusionUpdate(ImuFusion &f, float gx, float gy, float gz, float ax, float ay, float az);
+
+// Angles in degrees: roll around X, pitch around Y, yaw around Z. Yaw
+// drifts with the gyro bias since there is no magnetometer.
+void fusionEuler(const ImuFusion &f, float &roll, float &pitch, float &yaw);
+
+#endif
@@ -1,13 +1,23 @@
 #include <Wire.h>
-#include <Adafruit_BME280.h>
-#include <Adafruit_LSM6DS3TRC.h>
 #include <Arduino_GFX_Library.h>
 #include "Arduino_PimoroniPAR8.h"
 #include "Arduino_ST7789_Parallel.h"
+#include <hardware/structs/m33.h>
+#include "sensorstick.h"
+#include "imufusion.h"
+#include "flashlog.h"
+#include "scheduler.h"
 
 // Define this to use Arduino_Canvas (framebuffer), comment out for direct drawing
 #define USE_CANVAS
 
+// Run the orientation filter on core1, comment out to run it from loop()
+#define FUSION_ON_CORE1
+
+// Print every raw IMU sample on the serial port, the output can be fed to
+// host/imufusion_check
+//#define DUMP_IMU_TRACE
+
 // COLOR macro - swaps bytes for canvas mode, normal for direct mode
 #ifdef USE_CANVAS
   #define COLOR(c) ((uint16_t)(((c) >> 8) | ((c) << 8)))
@@ -27,23 +37,6 @@
 #define ORANGE  0xFD20
 #define PURPLE  0x780F
 
-// I2C Addresses
-#define LTR559_ADDR     0x23  // Light/Proximity
-#define BME280_ADDR     0x76  // Temp/Humidity/Pressure
-#define LSM6DS3_ADDR    0x6A  // IMU
-
-// LTR-559 registers
-#define LTR559_ALS_CONTR      0x80
-#define LTR559_PS_CONTR       0x81
-#define LTR559_ALS_MEAS_RATE  0x85
-#define LTR559_ALS_DATA_CH1_0 0x88
-#define LTR559_ALS_DATA_CH0_0 0x8A
-#define LTR559_PS_DATA_0      0x8D
-
-// BME280 and LSM6DS3 objects
-Adafruit_BME280 bme;
-Adafruit_LSM6DS3TRC lsm6ds3;
-
 // Display objects
 Arduino_PimoroniPAR8 *bus;
 Arduino_ST7789_Parallel *display;
@@ -58,17 +51,62 @@ Arduino_ST7789_Parallel *gfx;
 const int16_t SCREEN_WIDTH = 320;
 const int16_t SCREEN_HEIGHT = 240;
 
-// Sensor data structure
-struct SensorData {
-  float temperature;
-  float humidity;
-  float pressure;
-  float altitude;
-  float accelX, accelY, accelZ;
-  float gyroX, gyroY, gyroZ;
-  float lux;
-  uint16_t proximity;
-} sensorData;
+// Read rates of the asynchronous acquisition. The BME280 runs the indoor
+// profile (continuous, IIR filtered), it and the LTR-559 are read as often
+// as they have a new result. The IMU samples at IMU_RATE_HZ into its FIFO,
+// which is drained every 20 ms (~8 samples).
+#define BME280_PROFILE     BME280_PROFILE_INDOOR
+#define LSM6DS3_PERIOD_MS  20
+#define IMU_RATE_HZ        416
+#define IMU_WATERMARK      32
+
+// Periods of the loop tasks, loop() sleeps while none is due
+#define RENDER_PERIOD_MS   50    // ~20 FPS
+#define IMU_TASK_MS        10    // filter, when not on core1
+#define SERIAL_PERIOD_MS   20
+#define STATS_PERIOD_MS    1000
+
+int8_t renderTask = -1;
+uint32_t frameCount = 0;
+
+// Orientation from the filter, written by whichever core runs it. Same
+// idea as the sensor snapshot: odd sequence number while it is written,
+// readers copy again when it changed under them.
+struct Orientation {
+  float roll, pitch, yaw;  // degrees
+  uint32_t updates;        // filter updates so far
+  uint32_t cycles;         // cycles spent in those updates
+  float peakAccel;         // largest |accel - 1 g| since the last motion reset, m/s^2
+  float peakGyro;          // largest rotation rate since the last motion reset, rad/s
+};
+
+// Bumped by the logger to start a new motion peak window
+volatile uint32_t motionReset = 0;
+
+ImuFusion fusion;
+Orientation orientationShared;
+volatile uint32_t orientationSeq = 0;
+Orientation orientation;
+
+// Logging to the FS area of the flash (pick a Flash Size with FS in the
+// Tools menu). One record a minute, type d on the serial port for all of
+// it as CSV, h for the last hour. The sector the log goes into next is
+// erased ahead by a task of its own, so a log record never waits for it.
+#define LOG_INTERVAL_MS  60000
+#define ERASE_AHEAD_MS   10000
+#define LOG_CHANNELS     9
+#define LOG_HEADER       "time_s,temp_cC,humidity_c%,pressure_Pa,lux_x10,proximity,roll_ddeg,pitch_ddeg,peak_accel_cms2,peak_gyro_crads"
+
+bool logEnabled = false;
+// Log time keeps counting from the last record of the previous run
+uint32_t logTimeBase = 0;
+
+// Bubble pixels per unit of sin(tilt), the same feel the accel
+// version had at 15 pixels per m/s^2
+#define BUBBLE_GAIN  (15 * 9.80665f)
+
+// Latest sensor readings
+SensorData sensorData;
 
 void setup() {
   Serial.begin(115200);
@@ -78,6 +116,7 @@ void setup() {
   
   // Initialize I2C
   Wire.begin();
+  Wire.setClock(400000);
   delay(100);
   
   // Initialize display
@@ -114,38 +153,85 @@ void setup() {
   #endif
   
   // Initialize BME280
-  if (!bme.begin(BME280_ADDR)) {
+  if (!initBME280(BME280_PROFILE)) {
     Serial.println("Could not find BME280 sensor!");
     showError("BME280 not found!");
     while (1) delay(10);
   }
-  Serial.println("BME280 initialized");
   
   // Initialize LSM6DS3TR-C
-  if (!lsm6ds3.begin_I2C(LSM6DS3_ADDR)) {
+  if (!initLSM6DS3()) {
     Serial.println("Could not find LSM6DS3 sensor!");
     showError("LSM6DS3 not found!");
     while (1) delay(10);
   }
-  Serial.println("LSM6DS3TR-C initialized");
   
   // Initialize LTR-559
-  initLTR559();
+  if (!initLTR559()) {
+    Serial.println("Could not find LTR-559 sensor!");
+    showError("LTR-559 not found!");
+    while (1) delay(10);
+  }
+  
+  // High rate motion capture through the IMU's FIFO, every sample goes
+  // through the orientation filter
+  if (!initLSM6DS3Fifo(IMU_RATE_HZ, IMU_WATERMARK)) {
+    Serial.println("Could not set up the LSM6DS3 FIFO!");
+  }
+  fusionInit(fusion, IMU_RATE_HZ);
+  #ifdef DUMP_IMU_TRACE
+  Serial.print("# rate ");
+  Serial.println(IMU_RATE_HZ);
+  #endif
+  
+  // From here on the sensors are read in the background
+  sensorAsyncSetRate(SENSOR_BME280, bme280PeriodMs());
+  sensorAsyncSetRate(SENSOR_LSM6DS3, LSM6DS3_PERIOD_MS);
+  sensorAsyncSetRate(SENSOR_LTR559, ltr559PeriodMs());
+  if (!sensorAsyncBegin()) {
+    Serial.println("Could not start sensor acquisition!");
+    showError("No sensor timer!");
+    while (1) delay(10);
+  }
+  
+  // Pick up the log where the last run left it
+  logEnabled = flashLogBegin(LOG_CHANNELS);
+  if (logEnabled) {
+    FlashLogStats stats;
+    flashLogGetStats(stats);
+    logTimeBase = stats.newest ? stats.newest + LOG_INTERVAL_MS / 1000 : 0;
+    Serial.print("Log: ");
+    Serial.print(stats.records);
+    Serial.print(" records in ");
+    Serial.print(stats.pages);
+    Serial.print("/");
+    Serial.print(stats.capacity);
+    Serial.println(" pages");
+  } else {
+    Serial.println("No FS area in flash, logging off");
+  }
   
   Serial.println("All sensors initialized!");
   delay(500);
+  
+  renderTask = schedAdd(renderFrame, RENDER_PERIOD_MS);
+  #ifndef FUSION_ON_CORE1
+  schedAdd(processImuSamples, IMU_TASK_MS);
+  #endif
+  if (logEnabled) schedAdd(logReadings, LOG_INTERVAL_MS);
+  if (logEnabled) schedAdd(eraseAhead, ERASE_AHEAD_MS);
+  schedAdd(handleSerialCommands, SERIAL_PERIOD_MS);
+  schedAdd(printStats, STATS_PERIOD_MS);
 }
 
 void loop() {
-  static uint32_t lastUpdate = 0;
-  static uint32_t frameCount = 0;
-  static uint32_t fps = 0;
-  static uint32_t nextFpsTime = millis() + 1000;
+  schedRun();
+}
   
-  // Read all sensors
-  readBME280();
-  readLSM6DS3();
-  readLTR559();
+void renderFrame() {
+  // Latest readings, the I2C work happens in the background
+  sensorAsyncSnapshot(sensorData);
+  readOrientation(orientation);
   
   // Update display
   updateDisplay();
@@ -154,17 +240,187 @@ void loop() {
   gfx->flush();
   #endif
   
-  // Calculate FPS
   frameCount++;
-  if(millis() >= nextFpsTime) {
-    fps = frameCount;
-    Serial.print("FPS: ");
-    Serial.println(fps);
-    frameCount = 0;
-    nextFpsTime = millis() + 1000;
+}
+  
+void printStats() {
+  Serial.print("FPS: ");
+  Serial.print(frameCount);
+  frameCount = 0;
+  printSensorRates();
+}
+
+#ifdef FUSION_ON_CORE1
+// arduino-pico starts core1 when the sketch has a loop1()
+void loop1() {
+  processImuSamples();
+  delay(5);
+}
+#endif
+
+// Cycle counter of the core running the filter (each core has its own DWT)
+void enableCycleCounter() {
+  m33_hw->demcr |= M33_DEMCR_TRCENA_BITS;
+  m33_hw->dwt_ctrl |= M33_DWT_CTRL_CYCCNTENA_BITS;
+}
+
+// Run every sample waiting in the IMU ring through the filter and publish
+// the result. Only one core may call this.
+void processImuSamples() {
+  static ImuSample samples[64];
+  static uint32_t cycles = 0;
+  static float peakAccel = 0;
+  static float peakGyro = 0;
+  static uint32_t seenReset = 0;
+  static bool counterOn = false;
+  if (!counterOn) {
+    enableCycleCounter();
+    counterOn = true;
+  }
+  
+  if (seenReset != motionReset) {
+    seenReset = motionReset;
+    peakAccel = 0;
+    peakGyro = 0;
   }
   
-  delay(50); // ~20 FPS update rate
+  uint16_t count;
+  bool updated = false;
+  while ((count = imuFifoRead(samples, 64)) > 0) {
+    for (uint16_t i = 0; i < count; i++) {
+      SensorData s;
+      imuSampleToSensorData(samples[i], s);
+      uint32_t start = m33_hw->dwt_cyccnt;
+      fusionUpdate(fusion, s.gyroX, s.gyroY, s.gyroZ, s.accelX, s.accelY, s.accelZ);
+      cycles += m33_hw->dwt_cyccnt - start;
+      
+      float accel = fabsf(sqrtf(s.accelX * s.accelX + s.accelY * s.accelY + s.accelZ * s.accelZ) - 9.80665f);
+      float gyro = sqrtf(s.gyroX * s.gyroX + s.gyroY * s.gyroY + s.gyroZ * s.gyroZ);
+      if (accel > peakAccel) peakAccel = accel;
+      if (gyro > peakGyro) peakGyro = gyro;
+      #ifdef DUMP_IMU_TRACE
+      Serial.printf("%d,%d,%d,%d,%d,%d\n", samples[i].gyro[0], samples[i].gyro[1], samples[i].gyro[2],
+                    samples[i].accel[0], samples[i].accel[1], samples[i].accel[2]);
+      #endif
+    }
+    updated = true;
+  }
+  if (!updated) return;
+  
+  orientationSeq = orientationSeq + 1;
+  __dmb();
+  fusionEuler(fusion, orientationShared.roll, orientationShared.pitch, orientationShared.yaw);
+  orientationShared.updates = fusion.updates;
+  orientationShared.cycles = cycles;
+  orientationShared.peakAccel = peakAccel;
+  orientationShared.peakGyro = peakGyro;
+  __dmb();
+  orientationSeq = orientationSeq + 1;
+}
+
+void readOrientation(Orientation &out) {
+  uint32_t seq;
+  do {
+    seq = orientationSeq;
+    __dmb();
+    out = orientationShared;
+    __dmb();
+  } while ((seq & 1) || seq != orientationSeq);
+}
+
+// One record per LOG_INTERVAL_MS, readings scaled to integers so the
+// deltas stay small
+void logReadings() {
+  int32_t values[LOG_CHANNELS] = {
+    (int32_t)lroundf(sensorData.temperature * 100),
+    (int32_t)lroundf(sensorData.humidity * 100),
+    (int32_t)lroundf(sensorData.pressure * 100),
+    (int32_t)lroundf(sensorData.lux * 10),
+    sensorData.proximity,
+    (int32_t)lroundf(orientation.roll * 10),
+    (int32_t)lroundf(orientation.pitch * 10),
+    (int32_t)lroundf(orientation.peakAccel * 100),
+    (int32_t)lroundf(orientation.peakGyro * 100),
+  };
+  flashLogAppend(logTimeBase + millis() / 1000, values);
+  motionReset = motionReset + 1;
+}
+
+// Every ERASE_AHEAD_MS, mostly nothing to do
+void eraseAhead() {
+  flashLogEraseAhead();
+}
+
+// d: dump the whole log, h: the last hour, f: write the RAM page to flash
+void handleSerialCommands() {
+  if (!logEnabled || !Serial.available()) return;
+  
+  FlashLogStats stats;
+  flashLogGetStats(stats);
+  uint32_t count;
+  switch (Serial.read()) {
+    case 'd':
+      count = flashLogExport(Serial, 0, 0xFFFFFFFF, LOG_HEADER);
+      break;
+    case 'h':
+      count = flashLogExport(Serial, stats.newest > 3600 ? stats.newest - 3600 : 0, 0xFFFFFFFF, LOG_HEADER);
+      break;
+    case 'f':
+      flashLogFlush();
+      Serial.println("Log flushed");
+      return;
+    default:
+      return;
+  }
+  Serial.print("# ");
+  Serial.print(count);
+  Serial.println(" records");
+}
+
+// Updates per second of every sensor since the last call
+void printSensorRates() {
+  static SensorAsyncStats last = {};
+  SensorAsyncStats stats;
+  sensorAsyncGetStats(stats);
+  
+  Serial.print(", env: ");
+  Serial.print(stats.updates[SENSOR_BME280] - last.updates[SENSOR_BME280]);
+  Serial.print("/s, imu: ");
+  Serial.print(stats.updates[SENSOR_LSM6DS3] - last.updates[SENSOR_LSM6DS3]);
+  Serial.print("/s, light: ");
+  Serial.print(stats.updates[SENSOR_LTR559] - last.updates[SENSOR_LTR559]);
+  uint8_t gain;
+  uint16_t integration;
+  ltr559GetRange(gain, integration);
+  Serial.print("/s (");
+  Serial.print(gain);
+  Serial.print("x ");
+  Serial.print(integration);
+  Serial.print(" ms), imu fifo: ");
+  Serial.print(stats.imu_samples - last.imu_samples);
+  Serial.print("/s (overruns ");
+  Serial.print(stats.imu_overruns);
+  Serial.print("), errors: ");
+  Serial.print(stats.errors);
+  
+  // Average filter cost over the last second
+  static Orientation lastOrientation = {};
+  uint32_t updates = orientation.updates - lastOrientation.updates;
+  if (updates > 0) {
+    Serial.print(", fusion: ");
+    Serial.print((orientation.cycles - lastOrientation.cycles) / updates);
+    Serial.print(" cycles/update");
+  }
+  
+  SchedStats render;
+  schedGetStats(renderTask, render);
+  Serial.print(", loop busy: ");
+  Serial.print(schedLoad());
+  Serial.print("%, late frames: ");
+  Serial.print(render.late);
+  Serial.println();
+  lastOrientation = orientation;
+  last = stats;
 }
 
 void showError(const char* msg) {
@@ -328,10 +584,25 @@ void drawMotion(int16_t x, int16_t y) {
   gfx->drawLine(centerX - bubbleSize/2, centerY, centerX + bubbleSize/2, centerY, COLOR(GREEN));
   gfx->drawLine(centerX, centerY - bubbleSize/2, centerX, centerY + bubbleSize/2, COLOR(GREEN));
   
-  // Draw bubble based on X and Y acceleration
-  int16_t bubbleX = centerX + constrain(sensorData.accelX * 15, -bubbleSize/2 + 3, bubbleSize/2 - 3);
-  int16_t bubbleY = centerY + constrain(sensorData.accelY * 15, -bubbleSize/2 + 3, bubbleSize/2 - 3);
+  // Draw bubble from the filtered tilt, which stays put while the board
+  // is moved around unlike the raw accel
+  float bubbleDX = -sinf(orientation.pitch * DEG_TO_RAD) * BUBBLE_GAIN;
+  float bubbleDY = sinf(orientation.roll * DEG_TO_RAD) * BUBBLE_GAIN;
+  int16_t bubbleX = centerX + constrain(bubbleDX, -bubbleSize/2 + 3, bubbleSize/2 - 3);
+  int16_t bubbleY = centerY + constrain(bubbleDY, -bubbleSize/2 + 3, bubbleSize/2 - 3);
   gfx->fillCircle(bubbleX, bubbleY, 3, COLOR(RED));
+  
+  // Angles next to it
+  gfx->setTextColor(COLOR(WHITE));
+  gfx->setCursor(x + bubbleSize + 8, y + 4);
+  gfx->print("R:");
+  gfx->print(orientation.roll, 0);
+  gfx->setCursor(x + bubbleSize + 8, y + 16);
+  gfx->print("P:");
+  gfx->print(orientation.pitch, 0);
+  gfx->setCursor(x + bubbleSize + 8, y + 28);
+  gfx->print("Y:");
+  gfx->print(orientation.yaw, 0);
 }
 
 void drawLight(int16_t x, int16_t y) {
@@ -387,90 +658,3 @@ void drawLight(int16_t x, int16_t y) {
     gfx->fillCircle(x + 45, y + 20, indicatorSize - 2, COLOR(ORANGE));
   }
 }
-
-void readBME280() {
-  sensorData.temperature = bme.readTemperature();
-  sensorData.humidity = bme.readHumidity();
-  sensorData.pressure = bme.readPressure() / 100.0F;
-  sensorData.altitude = bme.readAltitude(1013.25);
-}
-
-void readLSM6DS3() {
-  sensors_event_t accel, gyro, temp;
-  lsm6ds3.getEvent(&accel, &gyro, &temp);
-  
-  sensorData.accelX = accel.acceleration.x;
-  sensorData.accelY = accel.acceleration.y;
-  sensorData.accelZ = accel.acceleration.z;
-  
-  sensorData.gyroX = gyro.gyro.x;
-  sensorData.gyroY = gyro.gyro.y;
-  sensorData.gyroZ = gyro.gyro.z;
-}
-
-void initLTR559() {
-  // Enable ALS: Gain 1x
-  writeRegister(LTR559_ADDR, LTR559_ALS_CONTR, 0x01);
-  
-  // Set measurement rate: 500ms
-  writeRegister(LTR559_ADDR, LTR559_ALS_MEAS_RATE, 0x03);
-  
-  // Enable proximity sensor
-  writeRegister(LTR559_ADDR, LTR559_PS_CONTR, 0x03);
-  
-  delay(10);
-  Serial.println("LTR-559 initialized");
-}
-
-void readLTR559() {
-  // Read ALS CH0 (visible + IR)
-  Wire.beginTransmission(LTR559_ADDR);
-  Wire.write(LTR559_ALS_DATA_CH0_0);
-  Wire.endTransmission(false);
-  Wire.requestFrom(LTR559_ADDR, 2);
-  uint16_t ch0 = Wire.read() | (Wire.read() << 8);
-  
-  // Read ALS CH1 (IR)
-  Wire.beginTransmission(LTR559_ADDR);
-  Wire.write(LTR559_ALS_DATA_CH1_0);
-  Wire.endTransmission(false);
-  Wire.requestFrom(LTR559_ADDR, 2);
-  uint16_t ch1 = Wire.read() | (Wire.read() << 8);
-  
-  // Read proximity
-  Wire.beginTransmission(LTR559_ADDR);
-  Wire.write(LTR559_PS_DATA_0);
-  Wire.endTransmission(false);
-  Wire.requestFrom(LTR559_ADDR, 2);
-  sensorData.proximity = Wire.read() | (Wire.read() << 8);
-  
-  // Calculate lux using the algorithm from pimoroni/ltr559-python
-  float lux = 0;
-  
-  if (ch0 + ch1 > 0) {
-    uint32_t ratio = (ch1 * 1000) / (ch0 + ch1);
-    
-    int ch0_c[4] = {17743, 42785, 5926, 0};
-    int ch1_c[4] = {-11059, 19548, -1185, 0};
-    
-    int ch_idx = 3;
-    if (ratio < 450) {
-      ch_idx = 0;
-    } else if (ratio < 640 && ratio >= 450) {
-      ch_idx = 1;
-    } else if (ratio < 850 && ratio >= 640) {
-      ch_idx = 2;
-    }
-    
-    lux = ((ch0 * ch0_c[ch_idx]) - (ch1 * ch1_c[ch_idx])) / 10000.0;
-  }
-  
-  sensorData.lux = lux;
-}
-
-void writeRegister(uint8_t addr, uint8_t reg, uint8_t value) {
-  Wire.beginTransmission(addr);
-  Wire.write(reg);
-  Wire.write(value);
-  Wire.endTransmission();
-}
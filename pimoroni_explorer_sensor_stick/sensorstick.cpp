@@ -0,0 +1,915 @@
+#include "sensorstick.h"
+#include "pico/time.h"
+#include "hardware/sync.h"
+
+// BME280 registers
+#define BME280_CALIB_00       0x88
+#define BME280_CHIP_ID        0xD0
+#define BME280_RESET          0xE0
+#define BME280_CALIB_26       0xE1
+#define BME280_CTRL_HUM       0xF2
+#define BME280_STATUS         0xF3
+#define BME280_CTRL_MEAS      0xF4
+#define BME280_CONFIG         0xF5
+#define BME280_PRESS_MSB      0xF7  // press, temp, hum: 8 bytes
+
+// LSM6DS3TR-C registers
+#define LSM6DS3_FIFO_CTRL1    0x06
+#define LSM6DS3_FIFO_CTRL2    0x07
+#define LSM6DS3_FIFO_CTRL3    0x08
+#define LSM6DS3_FIFO_CTRL5    0x0A
+#define LSM6DS3_INT1_CTRL     0x0D
+#define LSM6DS3_WHO_AM_I      0x0F
+#define LSM6DS3_CTRL1_XL      0x10
+#define LSM6DS3_CTRL2_G       0x11
+#define LSM6DS3_CTRL3_C       0x12
+#define LSM6DS3_OUTX_L_G      0x22  // gyro then accel XYZ: 12 bytes
+#define LSM6DS3_FIFO_STATUS1  0x3A  // level, flags, pattern: 4 bytes
+#define LSM6DS3_FIFO_DATA_OUT 0x3E  // rolls back to itself on burst reads
+
+// LTR-559 registers
+#define LTR559_ALS_CONTR      0x80
+#define LTR559_PS_CONTR       0x81
+#define LTR559_PS_MEAS_RATE   0x84
+#define LTR559_ALS_MEAS_RATE  0x85
+#define LTR559_ALS_DATA_CH1_0 0x88  // CH1, CH0, status, PS: 7 bytes
+
+// Acquisition profiles, oversampling as register codes (0 skip, 1 = 1x ..
+// 5 = 16x), filter code (4 = coefficient 16), standby code (0 = 0.5 ms)
+struct Bme280Settings {
+  uint8_t osrs_t, osrs_p, osrs_h;
+  uint8_t filter;
+  uint8_t standby;
+  bool forced;
+  uint32_t period_ms;  // forced: time between shots
+};
+
+static const Bme280Settings bme280Profiles[] = {
+  { 5, 5, 5, 0, 0, false, 0 },      // BME280_PROFILE_CONTINUOUS
+  { 1, 1, 1, 0, 0, true, 60000 },   // BME280_PROFILE_WEATHER
+  { 2, 5, 1, 4, 0, false, 0 },      // BME280_PROFILE_INDOOR
+};
+
+static Bme280Profile bmeProfile = BME280_PROFILE_CONTINUOUS;
+static uint8_t bmeCtrlMeas = 0;        // ctrl_meas without the mode bits
+static uint32_t bmeMeasureUs = 0;      // worst case conversion time
+
+// Factory trimming of this BME280
+static struct {
+  uint16_t T1;
+  int16_t T2, T3;
+  uint16_t P1;
+  int16_t P2, P3, P4, P5, P6, P7, P8, P9;
+  uint8_t H1, H3;
+  int16_t H2, H4, H5;
+  int8_t H6;
+} bmeCalib;
+
+bool writeRegister(uint8_t addr, uint8_t reg, uint8_t value) {
+  Wire.beginTransmission(addr);
+  Wire.write(reg);
+  Wire.write(value);
+  return Wire.endTransmission() == 0;
+}
+
+bool readRegisters(uint8_t addr, uint8_t reg, uint8_t *buf, uint8_t len) {
+  Wire.beginTransmission(addr);
+  Wire.write(reg);
+  if (Wire.endTransmission(false) != 0) return false;
+  if (Wire.requestFrom(addr, len) != len) return false;
+  for (uint8_t i = 0; i < len; i++) {
+    buf[i] = Wire.read();
+  }
+  return true;
+}
+
+// ═══════════════════════════════════════════════════════════
+// BME280
+// ═══════════════════════════════════════════════════════════
+
+// Worst case time of one conversion from the datasheet (section 9.1)
+static uint32_t bme280MeasureTime(const Bme280Settings &cfg) {
+  static const uint8_t samples[] = { 0, 1, 2, 4, 8, 16 };
+  uint32_t us = 1250 + 2300 * samples[cfg.osrs_t];
+  if (cfg.osrs_p) us += 2300 * samples[cfg.osrs_p] + 575;
+  if (cfg.osrs_h) us += 2300 * samples[cfg.osrs_h] + 575;
+  return us;
+}
+
+bool setBME280Profile(Bme280Profile profile) {
+  if (profile >= BME280_PROFILE_COUNT) return false;
+  const Bme280Settings &cfg = bme280Profiles[profile];
+  bmeProfile = profile;
+  bmeCtrlMeas = (cfg.osrs_t << 5) | (cfg.osrs_p << 2);
+  bmeMeasureUs = bme280MeasureTime(cfg);
+  
+  // Sleep mode while changing the config, it is ignored in normal mode.
+  // ctrl_hum only takes effect after the ctrl_meas write.
+  if (!writeRegister(BME280_ADDR, BME280_CTRL_MEAS, bmeCtrlMeas)) return false;
+  writeRegister(BME280_ADDR, BME280_CTRL_HUM, cfg.osrs_h);
+  writeRegister(BME280_ADDR, BME280_CONFIG, (cfg.standby << 5) | (cfg.filter << 2));
+  writeRegister(BME280_ADDR, BME280_CTRL_MEAS, bmeCtrlMeas | (cfg.forced ? 0x00 : 0x03));
+  return true;
+}
+
+uint32_t bme280PeriodMs() {
+  const Bme280Settings &cfg = bme280Profiles[bmeProfile];
+  if (cfg.forced) return cfg.period_ms;
+  // Normal mode: a new result every conversion + 0.5 ms standby
+  return (bmeMeasureUs + 500 + 999) / 1000;
+}
+
+bool initBME280(Bme280Profile profile) {
+  uint8_t id = 0;
+  if (!readRegisters(BME280_ADDR, BME280_CHIP_ID, &id, 1) || id != 0x60) return false;
+  
+  // Soft reset and wait for the calibration data to be copied from NVM
+  writeRegister(BME280_ADDR, BME280_RESET, 0xB6);
+  delay(10);
+  uint8_t status = 1;
+  while (readRegisters(BME280_ADDR, BME280_STATUS, &status, 1) && (status & 0x01)) {
+    delay(1);
+  }
+  
+  uint8_t c[26];
+  uint8_t h[7];
+  if (!readRegisters(BME280_ADDR, BME280_CALIB_00, c, 26)) return false;
+  if (!readRegisters(BME280_ADDR, BME280_CALIB_26, h, 7)) return false;
+  
+  bmeCalib.T1 = c[0] | (c[1] << 8);
+  bmeCalib.T2 = c[2] | (c[3] << 8);
+  bmeCalib.T3 = c[4] | (c[5] << 8);
+  bmeCalib.P1 = c[6] | (c[7] << 8);
+  bmeCalib.P2 = c[8] | (c[9] << 8);
+  bmeCalib.P3 = c[10] | (c[11] << 8);
+  bmeCalib.P4 = c[12] | (c[13] << 8);
+  bmeCalib.P5 = c[14] | (c[15] << 8);
+  bmeCalib.P6 = c[16] | (c[17] << 8);
+  bmeCalib.P7 = c[18] | (c[19] << 8);
+  bmeCalib.P8 = c[20] | (c[21] << 8);
+  bmeCalib.P9 = c[22] | (c[23] << 8);
+  bmeCalib.H1 = c[25];
+  bmeCalib.H2 = h[0] | (h[1] << 8);
+  bmeCalib.H3 = h[2];
+  bmeCalib.H4 = (int16_t)((int8_t)h[3] * 16) | (h[4] & 0x0F);
+  bmeCalib.H5 = (int16_t)((int8_t)h[5] * 16) | (h[4] >> 4);
+  bmeCalib.H6 = (int8_t)h[6];
+  
+  if (!setBME280Profile(profile)) return false;
+  
+  Serial.println("BME280 initialized");
+  return true;
+}
+
+// Integer compensation from the Bosch datasheet. All three channels come
+// from the same burst, so temperature is only compensated once.
+static bool convertBME280(const uint8_t *raw, SensorData &data) {
+  int32_t adc_P = ((uint32_t)raw[0] << 12) | ((uint32_t)raw[1] << 4) | (raw[2] >> 4);
+  int32_t adc_T = ((uint32_t)raw[3] << 12) | ((uint32_t)raw[4] << 4) | (raw[5] >> 4);
+  int32_t adc_H = ((uint32_t)raw[6] << 8) | raw[7];
+  
+  // No measurement finished since reset
+  if (adc_T == 0x80000) return false;
+  
+  // Temperature, t_fine is shared with the other two
+  int32_t var1 = ((((adc_T >> 3) - ((int32_t)bmeCalib.T1 << 1))) * bmeCalib.T2) >> 11;
+  int32_t var2 = (((((adc_T >> 4) - (int32_t)bmeCalib.T1) * ((adc_T >> 4) - (int32_t)bmeCalib.T1)) >> 12) *
+                  bmeCalib.T3) >> 14;
+  int32_t t_fine = var1 + var2;
+  data.temperature = ((t_fine * 5 + 128) >> 8) / 100.0f;
+  
+  // Pressure in Pa, Q24.8
+  if (adc_P != 0x80000) {
+    int64_t p1 = (int64_t)t_fine - 128000;
+    int64_t p2 = p1 * p1 * bmeCalib.P6;
+    p2 = p2 + ((p1 * bmeCalib.P5) << 17);
+    p2 = p2 + ((int64_t)bmeCalib.P4 << 35);
+    p1 = ((p1 * p1 * bmeCalib.P3) >> 8) + ((p1 * bmeCalib.P2) << 12);
+    p1 = ((((int64_t)1) << 47) + p1) * bmeCalib.P1 >> 33;
+    if (p1 != 0) {
+      int64_t p = 1048576 - adc_P;
+      p = (((p << 31) - p2) * 3125) / p1;
+      p1 = ((int64_t)bmeCalib.P9 * (p >> 13) * (p >> 13)) >> 25;
+      p2 = ((int64_t)bmeCalib.P8 * p) >> 19;
+      p = ((p + p1 + p2) >> 8) + ((int64_t)bmeCalib.P7 << 4);
+      data.pressure = (uint32_t)p / 25600.0f;
+      data.altitude = 44330.0f * (1.0f - powf(data.pressure / SEA_LEVEL_HPA, 0.1903f));
+    }
+  }
+  
+  // Humidity in %RH, Q22.10
+  if (adc_H != 0x8000) {
+    int32_t v = t_fine - 76800;
+    v = (((((adc_H << 14) - ((int32_t)bmeCalib.H4 << 20) - ((int32_t)bmeCalib.H5 * v)) + 16384) >> 15) *
+         (((((((v * (int32_t)bmeCalib.H6) >> 10) * (((v * (int32_t)bmeCalib.H3) >> 11) + 32768)) >> 10) +
+            2097152) * (int32_t)bmeCalib.H2 + 8192) >> 14));
+    v = v - (((((v >> 15) * (v >> 15)) >> 7) * (int32_t)bmeCalib.H1) >> 4);
+    if (v < 0) v = 0;
+    if (v > 419430400) v = 419430400;
+    data.humidity = (uint32_t)(v >> 12) / 1024.0f;
+  }
+  
+  return true;
+}
+
+// In forced mode this starts a conversion and waits for it, polling the
+// measuring bit once the worst case time is nearly up
+bool readBME280(SensorData &data) {
+  if (bme280Profiles[bmeProfile].forced) {
+    if (!writeRegister(BME280_ADDR, BME280_CTRL_MEAS, bmeCtrlMeas | 0x01)) return false;
+    delayMicroseconds(bmeMeasureUs * 3 / 4);
+    uint8_t status = 0x08;
+    uint32_t start = millis();
+    while (readRegisters(BME280_ADDR, BME280_STATUS, &status, 1) && (status & 0x08)) {
+      if (millis() - start > bmeMeasureUs / 1000 + 10) return false;
+      delayMicroseconds(200);
+    }
+  }
+  
+  uint8_t raw[8];
+  if (!readRegisters(BME280_ADDR, BME280_PRESS_MSB, raw, 8)) return false;
+  return convertBME280(raw, data);
+}
+
+// ═══════════════════════════════════════════════════════════
+// LSM6DS3TR-C
+// ═══════════════════════════════════════════════════════════
+
+bool initLSM6DS3() {
+  uint8_t id = 0;
+  if (!readRegisters(LSM6DS3_ADDR, LSM6DS3_WHO_AM_I, &id, 1) || id != 0x6A) return false;
+  
+  // Block data update + register auto-increment, so one burst is one sample
+  writeRegister(LSM6DS3_ADDR, LSM6DS3_CTRL3_C, 0x44);
+  // Accel 104 Hz ±4 g, gyro 104 Hz 2000 dps
+  writeRegister(LSM6DS3_ADDR, LSM6DS3_CTRL1_XL, 0x48);
+  writeRegister(LSM6DS3_ADDR, LSM6DS3_CTRL2_G, 0x4C);
+  
+  Serial.println("LSM6DS3TR-C initialized");
+  return true;
+}
+
+static bool convertLSM6DS3(const uint8_t *raw, SensorData &data) {
+  int16_t v[6];
+  for (int i = 0; i < 6; i++) {
+    v[i] = (int16_t)(raw[i * 2] | (raw[i * 2 + 1] << 8));
+  }
+  
+  data.gyroX = v[0] * LSM6DS3_GYRO_SCALE;
+  data.gyroY = v[1] * LSM6DS3_GYRO_SCALE;
+  data.gyroZ = v[2] * LSM6DS3_GYRO_SCALE;
+  
+  data.accelX = v[3] * LSM6DS3_ACCEL_SCALE;
+  data.accelY = v[4] * LSM6DS3_ACCEL_SCALE;
+  data.accelZ = v[5] * LSM6DS3_ACCEL_SCALE;
+  return true;
+}
+
+bool readLSM6DS3(SensorData &data) {
+  uint8_t raw[12];
+  if (!readRegisters(LSM6DS3_ADDR, LSM6DS3_OUTX_L_G, raw, 12)) return false;
+  return convertLSM6DS3(raw, data);
+}
+
+// FIFO mode. The IMU collects samples on its own at a high rate, the async
+// job drains whatever piled up in a few long bursts into imuRing.
+static bool fifoEnabled = false;
+static ImuSample imuRing[IMU_RING_SIZE];
+static volatile uint16_t imuRingHead = 0;  // written by the interrupt
+static volatile uint16_t imuRingTail = 0;  // written by the reader
+static volatile uint32_t imuSamples = 0;
+static volatile uint32_t imuOverruns = 0;
+static volatile uint32_t imuDropped = 0;
+
+// Supported output data rates, index + 1 is the ODR code of CTRL1_XL,
+// CTRL2_G and FIFO_CTRL5
+static const uint16_t lsm6ds3Rates[] = { 13, 26, 52, 104, 208, 416, 833, 1660 };
+
+static void imuWatermarkIrq();
+
+bool initLSM6DS3Fifo(uint16_t rate_hz, uint16_t watermark, int8_t int1_pin) {
+  uint8_t odr = 1;
+  while (odr < 8 && lsm6ds3Rates[odr - 1] < rate_hz) odr++;
+  
+  // Accel and gyro at the FIFO rate, same ranges as the normal mode
+  if (!writeRegister(LSM6DS3_ADDR, LSM6DS3_CTRL1_XL, (odr << 4) | 0x08)) return false;
+  writeRegister(LSM6DS3_ADDR, LSM6DS3_CTRL2_G, (odr << 4) | 0x0C);
+  
+  // Bypass mode first to empty the FIFO, then continuous mode with both
+  // sensors undecimated: gyro XYZ then accel XYZ, 6 words per sample
+  uint16_t words = watermark * 6;
+  if (words > 2047) words = 2046;
+  writeRegister(LSM6DS3_ADDR, LSM6DS3_FIFO_CTRL5, 0x00);
+  writeRegister(LSM6DS3_ADDR, LSM6DS3_FIFO_CTRL1, words & 0xFF);
+  writeRegister(LSM6DS3_ADDR, LSM6DS3_FIFO_CTRL2, (words >> 8) & 0x07);
+  writeRegister(LSM6DS3_ADDR, LSM6DS3_FIFO_CTRL3, 0x09);
+  writeRegister(LSM6DS3_ADDR, LSM6DS3_FIFO_CTRL5, (odr << 3) | 0x06);
+  
+  // Watermark on INT1, the job is started as soon as it fires
+  if (int1_pin >= 0) {
+    writeRegister(LSM6DS3_ADDR, LSM6DS3_INT1_CTRL, 0x08);
+    pinMode(int1_pin, INPUT);
+    attachInterrupt(digitalPinToInterrupt(int1_pin), imuWatermarkIrq, RISING);
+  }
+  
+  imuRingHead = imuRingTail = 0;
+  fifoEnabled = true;
+  Serial.print("LSM6DS3TR-C FIFO at ");
+  Serial.print(lsm6ds3Rates[odr - 1]);
+  Serial.println(" Hz");
+  return true;
+}
+
+uint16_t imuFifoAvailable() {
+  return (uint16_t)(imuRingHead - imuRingTail) % IMU_RING_SIZE;
+}
+
+uint16_t imuFifoRead(ImuSample *out, uint16_t max) {
+  uint16_t tail = imuRingTail;
+  uint16_t count = 0;
+  while (count < max && tail != imuRingHead) {
+    __dmb();
+    out[count++] = imuRing[tail];
+    tail = (tail + 1) % IMU_RING_SIZE;
+  }
+  __dmb();
+  imuRingTail = tail;
+  return count;
+}
+
+void imuSampleToSensorData(const ImuSample &sample, SensorData &data) {
+  data.gyroX = sample.gyro[0] * LSM6DS3_GYRO_SCALE;
+  data.gyroY = sample.gyro[1] * LSM6DS3_GYRO_SCALE;
+  data.gyroZ = sample.gyro[2] * LSM6DS3_GYRO_SCALE;
+  data.accelX = sample.accel[0] * LSM6DS3_ACCEL_SCALE;
+  data.accelY = sample.accel[1] * LSM6DS3_ACCEL_SCALE;
+  data.accelZ = sample.accel[2] * LSM6DS3_ACCEL_SCALE;
+}
+
+// ═══════════════════════════════════════════════════════════
+// LTR-559
+// ═══════════════════════════════════════════════════════════
+
+// Light and proximity both measure every LTR559_PERIOD_MS, so every read
+// of the async job finds a new result of each
+#define LTR559_PERIOD_MS  500
+
+// Auto-ranging: a reading above LTR559_HIGH_COUNTS drops to the next less
+// sensitive range, a saturated one to the least sensitive. Going up takes
+// LTR559_UP_READINGS readings in a row that would still be below half of
+// LTR559_HIGH_COUNTS in the more sensitive range, so it doesn't flip back.
+#define LTR559_HIGH_COUNTS  40000
+#define LTR559_UP_READINGS  2
+
+// Gain and integration time pairs, least sensitive first. The register
+// codes go to ALS_CONTR bits 4:2 and ALS_MEAS_RATE bits 5:3.
+struct Ltr559Range {
+  uint8_t gain;
+  uint8_t gain_code;
+  uint16_t integration_ms;
+  uint8_t integration_code;
+};
+
+static const Ltr559Range ltr559Ranges[] = {
+  { 1, 0, 50, 1 },     // up to ~130k lux, direct sun
+  { 1, 0, 100, 0 },
+  { 2, 1, 100, 0 },
+  { 4, 2, 100, 0 },
+  { 8, 3, 100, 0 },
+  { 8, 3, 200, 2 },
+  { 48, 6, 100, 0 },
+  { 48, 6, 200, 2 },
+  { 96, 7, 200, 2 },
+  { 96, 7, 400, 3 },   // ~0.01 lux per count
+};
+
+#define LTR559_RANGE_COUNT  (sizeof(ltr559Ranges) / sizeof(ltr559Ranges[0]))
+#define LTR559_START_RANGE  1  // 1x, 100 ms
+
+static volatile uint8_t ltrRange = LTR559_START_RANGE;  // set in the sensor
+static volatile uint8_t ltrWanted = LTR559_START_RANGE;
+static volatile bool ltrApply = false;  // ltrWanted still has to be written
+static uint8_t ltrUpReadings = 0;
+static bool ltrSettling = false;  // first result after a change may be old
+
+static uint8_t ltr559MeasRate(uint8_t range) {
+  // Repeat rate code 3 is 500 ms
+  return (ltr559Ranges[range].integration_code << 3) | 0x03;
+}
+
+static uint8_t ltr559Contr(uint8_t range) {
+  // Active mode
+  return (ltr559Ranges[range].gain_code << 2) | 0x01;
+}
+
+// Both registers written
+static void ltr559RangeSet(uint8_t range) {
+  ltrRange = ltrWanted = range;
+  ltrApply = false;
+  ltrUpReadings = 0;
+  ltrSettling = true;
+}
+
+static bool applyLTR559Range(uint8_t range) {
+  if (!writeRegister(LTR559_ADDR, LTR559_ALS_MEAS_RATE, ltr559MeasRate(range))) return false;
+  if (!writeRegister(LTR559_ADDR, LTR559_ALS_CONTR, ltr559Contr(range))) return false;
+  ltr559RangeSet(range);
+  return true;
+}
+
+bool initLTR559() {
+  // Enable ALS at 1x and 100ms integration every 500ms. The first result
+  // is already at this range.
+  if (!applyLTR559Range(LTR559_START_RANGE)) return false;
+  ltrSettling = false;
+  
+  // Enable proximity sensor, also every 500ms
+  writeRegister(LTR559_ADDR, LTR559_PS_MEAS_RATE, 0x04);
+  writeRegister(LTR559_ADDR, LTR559_PS_CONTR, 0x03);
+  
+  delay(10);
+  Serial.println("LTR-559 initialized");
+  return true;
+}
+
+// Lux algorithm from pimoroni/ltr559-python in integers: the coefficients
+// give lux * 10000 at 1x and 100 ms, the sums stay below 2^32
+uint32_t ltr559MilliLux(uint16_t ch0, uint16_t ch1, uint8_t gain, uint16_t integration_ms) {
+  uint32_t sum = (uint32_t)ch0 + ch1;
+  if (sum == 0) return 0;
+  uint32_t ratio = (ch1 * 1000u) / sum;
+  
+  uint32_t lux;
+  if (ratio < 450) {
+    lux = ch0 * 17743u + ch1 * 11059u;
+  } else if (ratio < 640) {
+    uint32_t a = ch0 * 42785u;
+    uint32_t b = ch1 * 19548u;
+    if (a <= b) return 0;
+    lux = a - b;
+  } else if (ratio < 850) {
+    lux = ch0 * 5926u + ch1 * 1185u;
+  } else {
+    return 0;
+  }
+  
+  // / 10000 * 1000 for mlux, * 100 / integration_ms, / gain
+  return lux / (gain * (integration_ms / 10u));
+}
+
+// Pick the range for the next readings from this one
+static void rangeLTR559(uint16_t ch0, uint16_t ch1, bool invalid) {
+  uint8_t range = ltrRange;
+  uint16_t counts = ch0 > ch1 ? ch0 : ch1;
+  uint8_t wanted = range;
+  
+  if (invalid || counts >= 65535) {
+    wanted = 0;
+  } else if (counts >= LTR559_HIGH_COUNTS) {
+    if (range > 0) wanted = range - 1;
+  }
+  if (wanted != range) {
+    ltrWanted = wanted;
+    ltrApply = true;
+    ltrUpReadings = 0;
+    return;
+  }
+  
+  // Most sensitive range where these counts would stay below the half
+  uint32_t sens = ltr559Ranges[range].gain * ltr559Ranges[range].integration_ms;
+  uint8_t best = range;
+  for (uint8_t r = range + 1; r < LTR559_RANGE_COUNT; r++) {
+    uint32_t s = ltr559Ranges[r].gain * ltr559Ranges[r].integration_ms;
+    if (counts * s >= sens * (LTR559_HIGH_COUNTS / 2)) break;
+    best = r;
+  }
+  if (best == range) {
+    ltrUpReadings = 0;
+  } else if (++ltrUpReadings >= LTR559_UP_READINGS) {
+    ltrWanted = best;
+    ltrApply = true;
+    ltrUpReadings = 0;
+  }
+}
+
+// CH1, CH0, status and proximity in one go. Reading CH1 first also keeps
+// the two ALS channels from the same conversion. The status tells which
+// of them have a new result and the gain ALS used for it.
+static bool convertLTR559(const uint8_t *raw, SensorData &data) {
+  uint8_t status = raw[4];
+  if (status & 0x01) data.proximity = (raw[5] | (raw[6] << 8)) & 0x07FF;
+  if (!(status & 0x04)) return true;
+  
+  uint16_t ch1 = raw[0] | (raw[1] << 8);
+  uint16_t ch0 = raw[2] | (raw[3] << 8);
+  const Ltr559Range &range = ltr559Ranges[ltrRange];
+  bool invalid = (status & 0x80) != 0;
+  if (ltrSettling) {
+    // Measured before the range change went through
+    ltrSettling = false;
+    return true;
+  }
+  if (((status >> 4) & 0x07) != range.gain_code) {
+    // Not the gain we set, the sensor was reset or missed a write
+    ltrWanted = ltrRange;
+    ltrApply = true;
+    return true;
+  }
+  
+  rangeLTR559(ch0, ch1, invalid);
+  if (!invalid) data.lux = ltr559MilliLux(ch0, ch1, range.gain, range.integration_ms) * 0.001f;
+  return true;
+}
+
+uint32_t ltr559PeriodMs() {
+  return LTR559_PERIOD_MS;
+}
+
+void ltr559GetRange(uint8_t &gain, uint16_t &integration_ms) {
+  const Ltr559Range &range = ltr559Ranges[ltrRange];
+  gain = range.gain;
+  integration_ms = range.integration_ms;
+}
+
+bool readLTR559(SensorData &data) {
+  uint8_t raw[7];
+  if (!readRegisters(LTR559_ADDR, LTR559_ALS_DATA_CH1_0, raw, 7)) return false;
+  convertLTR559(raw, data);
+  if (ltrApply) applyLTR559Range(ltrWanted);
+  return true;
+}
+
+// ═══════════════════════════════════════════════════════════
+// Asynchronous acquisition
+// ═══════════════════════════════════════════════════════════
+
+// Give up on a transfer that did not finish in this time (device gone,
+// bus stuck) so the other sensors keep going. Long FIFO bursts get one
+// extra ms per 8 bytes, enough for 100 kHz.
+#define SENSOR_JOB_TIMEOUT_MS  10
+
+// FIFO samples per burst
+#define FIFO_CHUNK_SAMPLES     16
+
+struct SensorJob {
+  uint8_t addr;
+  uint8_t reg;
+  uint8_t len;
+  bool (*convert)(const uint8_t *raw, SensorData &data);
+  volatile uint32_t period_ms;
+  uint32_t next_ms;
+};
+
+static SensorJob sensorJobs[SENSOR_COUNT] = {
+  { BME280_ADDR, BME280_PRESS_MSB, 8, convertBME280, 0, 0 },
+  { LSM6DS3_ADDR, LSM6DS3_OUTX_L_G, 12, convertLSM6DS3, 0, 0 },
+  { LTR559_ADDR, LTR559_ALS_DATA_CH1_0, 7, convertLTR559, 0, 0 },
+};
+
+// The DMA reads into jobRaw and writes the register address from jobReg,
+// both have to stay untouched until the transfer is done
+static uint8_t jobReg;
+static uint8_t jobRaw[FIFO_CHUNK_SAMPLES * 12 + 12];
+static volatile int8_t activeJob = -1;
+static uint32_t jobStartMs;
+static uint32_t jobTimeoutMs;
+
+// Progress of a FIFO drain: words still to read, words to throw away to get
+// back in step with the gyro/accel pattern, and whether a chunk is underway
+static uint16_t fifoWordsLeft;
+static uint8_t fifoSkipWords;
+static uint8_t fifoChunkSamples;
+static bool fifoReadingData;
+static bool fifoHaveSample;
+static uint8_t fifoLast[12];
+
+// Forced mode BME280 job: write ctrl_meas to start a conversion, leave the
+// bus to the others while it runs, then read status + data in one burst
+enum BmeJobPhase { BME_IDLE, BME_TRIGGERING, BME_MEASURING };
+static volatile uint8_t bmePhase = BME_IDLE;
+static uint32_t bmeReadyMs;
+static uint8_t bmeTrigger[2];
+
+// LTR-559 range change: integration time and gain are in two registers,
+// written one after the other in place of a read
+static uint8_t ltrWrite[2];
+static uint8_t ltrWriteStep = 0;
+static bool asyncRunning = false;
+static struct repeating_timer jobTimer;
+
+// Double buffered snapshot. The writer fills the buffer the reader is not
+// looking at and then bumps the sequence number, a reader that sees the
+// number change while copying just copies again.
+static SensorData snapshots[2];
+static volatile uint32_t snapshotSeq = 0;
+
+static volatile uint32_t jobUpdates[SENSOR_COUNT];
+static SensorUpdateFunc updateFunc = NULL;
+static volatile uint32_t jobErrors = 0;
+
+// When a job wants the bus next
+static uint32_t jobDueMs(int8_t i) {
+  if (i == SENSOR_BME280 && bmePhase == BME_MEASURING) return bmeReadyMs;
+  return sensorJobs[i].next_ms;
+}
+
+static bool startTransfer(uint8_t addr, uint8_t reg, uint16_t len) {
+  jobStartMs = millis();
+  jobTimeoutMs = SENSOR_JOB_TIMEOUT_MS + len / 8;
+  jobReg = reg;
+  return Wire.writeReadAsync(addr, &jobReg, 1, jobRaw, len, true);
+}
+
+// Next piece of a FIFO drain: the status told how many words are waiting,
+// read them in chunks of whole samples. Returns false when there is
+// nothing left to read.
+static bool fifoNextChunk() {
+  uint16_t samples = (fifoWordsLeft - fifoSkipWords) / 6;
+  if (samples > FIFO_CHUNK_SAMPLES) samples = FIFO_CHUNK_SAMPLES;
+  if (samples == 0) return false;
+  
+  uint16_t words = fifoSkipWords + samples * 6;
+  fifoWordsLeft -= words;
+  fifoChunkSamples = samples;
+  fifoReadingData = true;
+  if (!startTransfer(LSM6DS3_ADDR, LSM6DS3_FIFO_DATA_OUT, words * 2)) {
+    jobErrors = jobErrors + 1;
+    return false;
+  }
+  return true;
+}
+
+// Called at the end of every transfer of the IMU job in FIFO mode. Returns
+// true while the drain goes on with another transfer.
+static bool fifoTransferDone() {
+  if (!fifoReadingData) {
+    // Status: level in words, overrun flag and which word comes next
+    fifoWordsLeft = jobRaw[0] | ((jobRaw[1] & 0x07) << 8);
+    if (jobRaw[1] & 0x40) imuOverruns = imuOverruns + 1;
+    uint16_t pattern = jobRaw[2] | ((jobRaw[3] & 0x03) << 8);
+    fifoSkipWords = pattern ? 6 - pattern : 0;
+    fifoHaveSample = false;
+    if (fifoWordsLeft < fifoSkipWords) return false;
+    return fifoNextChunk();
+  }
+  
+  // Data: copy the samples into the ring, dropping them when the reader
+  // fell behind
+  const uint8_t *raw = jobRaw + fifoSkipWords * 2;
+  fifoSkipWords = 0;
+  uint16_t head = imuRingHead;
+  for (uint8_t i = 0; i < fifoChunkSamples; i++, raw += 12) {
+    uint16_t next = (head + 1) % IMU_RING_SIZE;
+    if (next == imuRingTail) {
+      imuDropped = imuDropped + 1;
+      continue;
+    }
+    ImuSample &sample = imuRing[head];
+    for (int k = 0; k < 3; k++) {
+      sample.gyro[k] = (int16_t)(raw[k * 2] | (raw[k * 2 + 1] << 8));
+      sample.accel[k] = (int16_t)(raw[6 + k * 2] | (raw[7 + k * 2] << 8));
+    }
+    head = next;
+  }
+  __dmb();
+  imuRingHead = head;
+  imuSamples = imuSamples + fifoChunkSamples;
+  
+  // Keep the newest one for the snapshot
+  memcpy(fifoLast, raw - 12, 12);
+  fifoHaveSample = true;
+  return fifoNextChunk();
+}
+
+// Start the job that is most overdue, if the bus is free. Called from both
+// interrupts, so the check and the start happen with interrupts off.
+static void startNextJob() {
+  uint32_t irq = save_and_disable_interrupts();
+  if (asyncRunning && activeJob < 0) {
+    uint32_t now = millis();
+    int8_t best = -1;
+    int32_t bestLate = -1;
+    for (int8_t i = 0; i < SENSOR_COUNT; i++) {
+      if (sensorJobs[i].period_ms == 0) continue;
+      int32_t late = (int32_t)(now - jobDueMs(i));
+      if (late > bestLate) {
+        bestLate = late;
+        best = i;
+      }
+    }
+    
+    if (best >= 0) {
+      SensorJob &job = sensorJobs[best];
+      bool bmeForced = best == SENSOR_BME280 && bme280Profiles[bmeProfile].forced;
+      if (!(bmeForced && bmePhase == BME_MEASURING)) {
+        // Skip missed periods instead of bursting to catch up
+        job.next_ms += job.period_ms;
+        if ((int32_t)(now - job.next_ms) >= 0) job.next_ms = now + job.period_ms;
+      }
+      
+      activeJob = best;
+      bool started;
+      if (bmeForced && bmePhase == BME_IDLE) {
+        bmePhase = BME_TRIGGERING;
+        bmeTrigger[0] = BME280_CTRL_MEAS;
+        bmeTrigger[1] = bmeCtrlMeas | 0x01;
+        jobStartMs = now;
+        jobTimeoutMs = SENSOR_JOB_TIMEOUT_MS;
+        started = Wire.writeAsync(BME280_ADDR, bmeTrigger, 2, true);
+      } else if (bmeForced) {
+        started = startTransfer(BME280_ADDR, BME280_STATUS, 12);
+      } else if (best == SENSOR_LTR559 && ltrApply) {
+        ltrWriteStep = 1;
+        ltrWrite[0] = LTR559_ALS_MEAS_RATE;
+        ltrWrite[1] = ltr559MeasRate(ltrWanted);
+        jobStartMs = now;
+        jobTimeoutMs = SENSOR_JOB_TIMEOUT_MS;
+        started = Wire.writeAsync(LTR559_ADDR, ltrWrite, 2, true);
+      } else if (best == SENSOR_LSM6DS3 && fifoEnabled) {
+        fifoReadingData = false;
+        started = startTransfer(LSM6DS3_ADDR, LSM6DS3_FIFO_STATUS1, 4);
+      } else {
+        started = startTransfer(job.addr, job.reg, job.len);
+      }
+      if (!started) {
+        if (bmeForced) bmePhase = BME_IDLE;
+        ltrWriteStep = 0;
+        activeJob = -1;
+        jobErrors = jobErrors + 1;
+      }
+    }
+  }
+  restore_interrupts(irq);
+}
+
+// DMA done: convert into the back buffer and publish it
+static void jobFinished() {
+  int8_t j = activeJob;
+  if (j < 0) return;
+  
+  // A FIFO drain keeps the bus until all chunks are in, then publishes
+  // the newest sample
+  const uint8_t *raw = jobRaw;
+  if (j == SENSOR_LSM6DS3 && fifoEnabled) {
+    if (fifoTransferDone()) return;
+    if (!fifoHaveSample) {
+      activeJob = -1;
+      startNextJob();
+      return;
+    }
+    raw = fifoLast;
+  }
+  
+  if (j == SENSOR_BME280 && bmePhase != BME_IDLE) {
+    if (bmePhase == BME_TRIGGERING) {
+      // Conversion started, come back when it should be done
+      bmePhase = BME_MEASURING;
+      bmeReadyMs = millis() + (bmeMeasureUs + 999) / 1000;
+      activeJob = -1;
+      startNextJob();
+      return;
+    }
+    if (jobRaw[0] & 0x08) {
+      // Still measuring, look again in a ms
+      bmeReadyMs = millis() + 1;
+      activeJob = -1;
+      startNextJob();
+      return;
+    }
+    bmePhase = BME_IDLE;
+    raw = jobRaw + (BME280_PRESS_MSB - BME280_STATUS);
+  }
+  
+  if (j == SENSOR_LTR559 && ltrWriteStep) {
+    if (ltrWriteStep == 1) {
+      ltrWriteStep = 2;
+      ltrWrite[0] = LTR559_ALS_CONTR;
+      ltrWrite[1] = ltr559Contr(ltrWanted);
+      jobStartMs = millis();
+      if (Wire.writeAsync(LTR559_ADDR, ltrWrite, 2, true)) return;
+      jobErrors = jobErrors + 1;
+    } else {
+      ltr559RangeSet(ltrWanted);
+    }
+    ltrWriteStep = 0;
+    activeJob = -1;
+    startNextJob();
+    return;
+  }
+  
+  uint32_t seq = snapshotSeq;
+  SensorData &back = snapshots[(seq + 1) & 1];
+  back = snapshots[seq & 1];
+  if (sensorJobs[j].convert(raw, back)) {
+    __dmb();
+    snapshotSeq = seq + 1;
+    jobUpdates[j] = jobUpdates[j] + 1;
+    if (updateFunc) updateFunc((SensorId)j);
+  } else {
+    jobErrors = jobErrors + 1;
+  }
+  
+  activeJob = -1;
+  startNextJob();
+}
+
+// 1 ms tick: starts jobs when the bus went idle and catches stuck transfers
+static bool jobTimerCallback(struct repeating_timer *t) {
+  (void)t;
+  uint32_t irq = save_and_disable_interrupts();
+  if (activeJob >= 0 && millis() - jobStartMs > jobTimeoutMs) {
+    Wire.abortAsync();
+    if (activeJob == SENSOR_BME280) bmePhase = BME_IDLE;
+    ltrWriteStep = 0;
+    activeJob = -1;
+    jobErrors = jobErrors + 1;
+  }
+  restore_interrupts(irq);
+  startNextJob();
+  return true;
+}
+
+// FIFO watermark on INT1: drain right away instead of at the next period
+static void imuWatermarkIrq() {
+  sensorJobs[SENSOR_LSM6DS3].next_ms = millis();
+  startNextJob();
+}
+
+void sensorAsyncSetRate(SensorId id, uint32_t period_ms) {
+  if (id >= SENSOR_COUNT) return;
+  sensorJobs[id].next_ms = millis();
+  sensorJobs[id].period_ms = period_ms;
+}
+
+bool sensorAsyncBegin() {
+  if (asyncRunning) return true;
+  
+  // Seed the snapshot with a blocking read, so readers never see zeros
+  for (int i = 0; i < SENSOR_COUNT; i++) {
+    SensorJob &job = sensorJobs[i];
+    if (job.period_ms == 0) continue;
+    if (i == SENSOR_BME280) {
+      readBME280(snapshots[0]);
+    } else if (readRegisters(job.addr, job.reg, jobRaw, job.len)) {
+      job.convert(jobRaw, snapshots[0]);
+    }
+    job.next_ms = millis() + job.period_ms;
+  }
+  snapshotSeq = 0;
+  
+  Wire.onFinishedAsync(jobFinished);
+  asyncRunning = true;
+  if (!add_repeating_timer_ms(1, jobTimerCallback, NULL, &jobTimer)) {
+    asyncRunning = false;
+    return false;
+  }
+  return true;
+}
+
+void sensorAsyncEnd() {
+  if (!asyncRunning) return;
+  cancel_repeating_timer(&jobTimer);
+  
+  uint32_t irq = save_and_disable_interrupts();
+  asyncRunning = false;
+  restore_interrupts(irq);
+  
+  // Let a transfer that is still going finish, the blocking calls can't
+  // be mixed with it
+  uint32_t start = millis();
+  while (activeJob >= 0 && millis() - start <= jobTimeoutMs) {
+    tight_loop_contents();
+  }
+  if (activeJob >= 0) {
+    Wire.abortAsync();
+    activeJob = -1;
+  }
+  bmePhase = BME_IDLE;
+  ltrWriteStep = 0;
+}
+
+uint32_t sensorAsyncSnapshot(SensorData &data) {
+  uint32_t seq;
+  do {
+    seq = snapshotSeq;
+    __dmb();
+    data = snapshots[seq & 1];
+    __dmb();
+  } while (seq != snapshotSeq);
+  return seq;
+}
+
+void sensorAsyncGetStats(SensorAsyncStats &stats) {
+  for (int i = 0; i < SENSOR_COUNT; i++) {
+    stats.updates[i] = jobUpdates[i];
+  }
+  stats.errors = jobErrors;
+  stats.seq = snapshotSeq;
+  stats.imu_samples = imuSamples;
+  stats.imu_overruns = imuOverruns;
+  stats.imu_dropped = imuDropped;
+}
+
+void sensorAsyncOnUpdate(SensorUpdateFunc func) {
+  updateFunc = func;
+}
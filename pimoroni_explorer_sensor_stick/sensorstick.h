@@ -0,0 +1,119 @@
+#ifndef _SENSORSTICK_H_
+#define _SENSORSTICK_H_
+
+#include <Arduino.h>
+#include <Wire.h>
+
+// Drivers for the Multi Sensor Stick (BME280, LSM6DS3TR-C, LTR-559).
+// Every read fetches the device's whole data block in one auto-increment
+// burst and converts all channels from that single snapshot.
+
+// I2C Addresses
+#define LTR559_ADDR     0x23  // Light/Proximity
+#define BME280_ADDR     0x76  // Temp/Humidity/Pressure
+#define LSM6DS3_ADDR    0x6A  // IMU
+
+// Pressure used as reference for the altitude
+#define SEA_LEVEL_HPA   1013.25f
+
+// Sensor data structure
+struct SensorData {
+  float temperature;   // C
+  float humidity;      // %
+  float pressure;      // hPa
+  float altitude;      // m
+  float accelX, accelY, accelZ;  // m/s^2
+  float gyroX, gyroY, gyroZ;     // rad/s
+  float lux;
+  uint16_t proximity;  // 0-2047
+};
+
+// BME280 acquisition profiles, after the datasheet's recommendations
+enum Bme280Profile {
+  BME280_PROFILE_CONTINUOUS,  // normal mode, 16x on all, no filter: ~9 results/s
+  BME280_PROFILE_WEATHER,     // forced mode, 1x, no filter: one shot a minute, sleeps in between
+  BME280_PROFILE_INDOOR,      // normal mode, T 2x P 16x H 1x, IIR 16: ~21 results/s, smooth
+  BME280_PROFILE_COUNT
+};
+
+bool initBME280(Bme280Profile profile = BME280_PROFILE_CONTINUOUS);
+bool setBME280Profile(Bme280Profile profile);
+// How often the profile has a new result, use it as the async period
+uint32_t bme280PeriodMs();
+bool readBME280(SensorData &data);
+
+bool initLSM6DS3();
+bool readLSM6DS3(SensorData &data);
+
+// FIFO mode for the LSM6DS3TR-C: the IMU samples accel and gyro at rate_hz
+// (rounded up to 13, 26, 52, 104, 208, 416, 833 or 1660) into its own FIFO
+// and the async IMU job drains it in long bursts into a ring buffer, so the
+// job period only has to keep up with the FIFO, not with the sample rate.
+// The watermark (in samples) goes to INT1, pass its GPIO to start a drain
+// as soon as it fires, or -1 to only drain every period.
+// The snapshot keeps showing the newest sample.
+struct ImuSample {
+  int16_t gyro[3];   // raw, LSM6DS3_GYRO_SCALE rad/s per LSB
+  int16_t accel[3];  // raw, LSM6DS3_ACCEL_SCALE m/s^2 per LSB
+};
+
+#define IMU_RING_SIZE  512
+
+// ±4 g and 2000 dps full scale, converted to the units Adafruit used
+#define LSM6DS3_ACCEL_SCALE   (0.122e-3f * 9.80665f)          // m/s^2 per LSB
+#define LSM6DS3_GYRO_SCALE    (70e-3f * 3.14159265f / 180.0f)  // rad/s per LSB
+
+bool initLSM6DS3Fifo(uint16_t rate_hz, uint16_t watermark, int8_t int1_pin = -1);
+uint16_t imuFifoAvailable();
+// Take up to max samples out of the ring, oldest first
+uint16_t imuFifoRead(ImuSample *out, uint16_t max);
+void imuSampleToSensorData(const ImuSample &sample, SensorData &data);
+
+// The LTR-559 picks its ALS gain and integration time by itself from the
+// last readings, from 1x 50 ms for direct sun to 96x 400 ms in the dark
+bool initLTR559();
+// How often light and proximity have a new result
+uint32_t ltr559PeriodMs();
+bool readLTR559(SensorData &data);
+void ltr559GetRange(uint8_t &gain, uint16_t &integration_ms);
+// Lux from the raw channels in thousandths, integer math only
+uint32_t ltr559MilliLux(uint16_t ch0, uint16_t ch1, uint8_t gain, uint16_t integration_ms);
+
+// Register helpers, false when the device did not answer
+bool writeRegister(uint8_t addr, uint8_t reg, uint8_t value);
+bool readRegisters(uint8_t addr, uint8_t reg, uint8_t *buf, uint8_t len);
+
+// Asynchronous acquisition. A job list with one burst read per sensor is
+// walked from interrupts: a 1 ms timer starts whatever job is due, and the
+// end of every DMA transfer converts the data, publishes a new snapshot
+// and starts the next due job. The main loop only copies the snapshot and
+// never waits on the bus. Don't use the blocking functions above between
+// sensorAsyncBegin() and sensorAsyncEnd().
+
+enum SensorId { SENSOR_BME280, SENSOR_LSM6DS3, SENSOR_LTR559, SENSOR_COUNT };
+
+struct SensorAsyncStats {
+  uint32_t updates[SENSOR_COUNT];  // snapshots published per sensor
+  uint32_t errors;                 // failed, timed out or invalid reads
+  uint32_t seq;                    // current snapshot sequence number
+  uint32_t imu_samples;            // samples taken out of the IMU FIFO
+  uint32_t imu_overruns;           // drains that found the FIFO overrun
+  uint32_t imu_dropped;            // samples lost because the ring was full
+};
+
+// Read a sensor every period_ms, 0 (the default) leaves it out
+void sensorAsyncSetRate(SensorId id, uint32_t period_ms);
+bool sensorAsyncBegin();
+void sensorAsyncEnd();
+
+// Copy of the latest readings, returns the sequence number which goes up
+// by one for every published update
+uint32_t sensorAsyncSnapshot(SensorData &data);
+void sensorAsyncGetStats(SensorAsyncStats &stats);
+
+// Called from the interrupt that published a new snapshot, e.g. to
+// schedTrigger() the task that uses it. NULL to stop.
+typedef void (*SensorUpdateFunc)(SensorId id);
+void sensorAsyncOnUpdate(SensorUpdateFunc func);
+
+#endif
@@ -153,3 +153,20 @@ void Arduino_ST7789_Parallel::setBacklight(uint8_t brightness) {
   Arduino_PimoroniPAR8 *par_bus = (Arduino_PimoroniPAR8*)_bus;
   par_bus->setBacklight(brightness);
 }
+
+void Arduino_ST7789_Parallel::idleMode(bool on) {
+  _bus->sendCommand(on ? 0x39 : 0x38);  // IDMON / IDMOFF
+}
+
+void Arduino_ST7789_Parallel::partialArea(int16_t x, int16_t w) {
+  if (w <= 0) {
+    _bus->sendCommand(0x13);  // NORON
+    return;
+  }
+  // MADCTL MX: x 0 is the last gate line
+  uint16_t start = _width - x - w;
+  _bus->sendCommand(0x30);  // PTLAR
+  _bus->sendData16(start);
+  _bus->sendData16(start + w - 1);
+  _bus->sendCommand(0x12);  // PTLON
+}
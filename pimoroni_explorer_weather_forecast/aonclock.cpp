@@ -0,0 +1,77 @@
+#include "aonclock.h"
+#include "pico/aon_timer.h"
+
+// 1/1/2000 in Unix time
+#define EPOCH_2000  946684800
+
+static void (*tickFunc)() = NULL;
+
+static void armTick();
+
+static void toTimespec(uint32_t time, struct timespec &ts) {
+  ts.tv_sec = (time_t)time + EPOCH_2000;
+  ts.tv_nsec = 0;
+}
+
+bool aonClockBegin(uint32_t time) {
+  if (aon_timer_is_running()) return true;
+  struct timespec ts;
+  toTimespec(time, ts);
+  aon_timer_start(&ts);
+  return false;
+}
+
+uint32_t aonClockNow() {
+  struct timespec ts;
+  aon_timer_get_time(&ts);
+  return (uint32_t)(ts.tv_sec - EPOCH_2000);
+}
+
+void aonClockSet(uint32_t time) {
+  struct timespec ts;
+  toTimespec(time, ts);
+  aon_timer_set_time(&ts);
+  // The alarm is for a time of the old setting
+  if (tickFunc) armTick();
+}
+
+void aonClockToCalendar(uint32_t time, struct tm &cal) {
+  time_t t = (time_t)time + EPOCH_2000;
+  gmtime_r(&t, &cal);
+}
+
+uint32_t aonClockFromCalendar(struct tm cal) {
+  cal.tm_isdst = 0;
+  return (uint32_t)(mktime(&cal) - EPOCH_2000);
+}
+
+int aonClockDaysInMonth(int month, int year) {
+  // Day 0 of the next month is the last one of this
+  struct tm cal = {};
+  cal.tm_year = year - 1900;
+  cal.tm_mon = month;
+  cal.tm_mday = 0;
+  cal.tm_hour = 12;
+  aonClockToCalendar(aonClockFromCalendar(cal), cal);
+  return cal.tm_mday;
+}
+
+static void tickAlarm() {
+  armTick();
+  if (tickFunc) tickFunc();
+}
+
+// Alarm at the start of the next second
+static void armTick() {
+  struct timespec ts;
+  aon_timer_get_time(&ts);
+  ts.tv_sec++;
+  ts.tv_nsec = 0;
+  aon_timer_enable_alarm(&ts, tickAlarm, false);
+}
+
+void aonClockOnTick(void (*func)()) {
+  tickFunc = func;
+  if (func) armTick();
+  else aon_timer_disable_alarm();
+}
@@ -0,0 +1,28 @@
+#ifndef _AONCLOCK_H_
+#define _AONCLOCK_H_
+
+#include <Arduino.h>
+#include <time.h>
+
+// Date and time kept in the RP2350's always-on timer (powman). It counts
+// in the always-on power domain, so it keeps going through a reset, a
+// watchdog reboot or a new upload (not through a power cut), and its alarm
+// wakes the core from sleep. Times are seconds since 1/1/2000 like the
+// log's, the calendar comes from the C library (no time zones).
+
+// Starts the timer at time, unless it kept running through a reset. True
+// when it did, the time it has is still good then.
+bool aonClockBegin(uint32_t time);
+uint32_t aonClockNow();
+void aonClockSet(uint32_t time);
+
+void aonClockToCalendar(uint32_t time, struct tm &cal);
+// Fields out of range roll over, like mktime()
+uint32_t aonClockFromCalendar(struct tm cal);
+int aonClockDaysInMonth(int month, int year);
+
+// Calls func from the timer's interrupt at every whole second, e.g. to
+// schedTrigger() the task that redraws the clock. NULL to stop.
+void aonClockOnTick(void (*func)());
+
+#endif
@@ -0,0 +1,102 @@
+#include "barograph.h"
+#include "pressurehistory.h"
+#include <math.h>
+
+static BarographSpan spans[BAROGRAPH_COLUMNS];
+static uint16_t newest = 0;  // ring slot of the newest column
+static uint8_t graphHeight = 1;
+static int16_t rangeLow = 0, rangeHigh = 0;
+
+// Raw sample by age, NAN when there is none
+static float sampleAt(uint16_t age) {
+  PressureBucket bucket;
+  if (!pressureHistoryAt(PRESSURE_RAW, age, bucket)) return NAN;
+  return bucket.avg;
+}
+
+static uint8_t rowOf(float hPa) {
+  float bottom = graphHeight - 1;
+  float row = bottom - (hPa - rangeLow) * bottom / (rangeHigh - rangeLow);
+  if (row < 0) row = 0;
+  if (row > bottom) row = bottom;
+  return (uint8_t)lroundf(row);
+}
+
+static BarographSpan &slot(uint16_t age) {
+  return spans[(newest + BAROGRAPH_COLUMNS - age) % BAROGRAPH_COLUMNS];
+}
+
+// The line from the sample before to this one, a dot after a gap
+static void plot(uint16_t age) {
+  BarographSpan &span = slot(age);
+  float value = sampleAt(age);
+  if (isnan(value)) {
+    span.top = 1;
+    span.bottom = 0;
+    return;
+  }
+  uint8_t row = rowOf(value);
+  float before = sampleAt(age + 1);
+  uint8_t from = isnan(before) ? row : rowOf(before);
+  span.top = from < row ? from : row;
+  span.bottom = from < row ? row : from;
+}
+
+// Envelope of the samples shown, in whole hPa, true when it moved
+static bool rescale() {
+  float lo = INFINITY, hi = -INFINITY;
+  for (uint16_t age = 0; age < BAROGRAPH_COLUMNS; age++) {
+    float value = sampleAt(age);
+    if (isnan(value)) continue;
+    if (value < lo) lo = value;
+    if (value > hi) hi = value;
+  }
+  int16_t low = 1010, high = 1010 + BAROGRAPH_MIN_RANGE;
+  if (lo <= hi) {
+    low = (int16_t)floorf(lo);
+    high = (int16_t)ceilf(hi);
+    // Flat weather still gets some room, centred
+    int16_t missing = BAROGRAPH_MIN_RANGE - (high - low);
+    if (missing > 0) {
+      low -= missing / 2;
+      high = low + BAROGRAPH_MIN_RANGE;
+    }
+  }
+  if (low == rangeLow && high == rangeHigh) return false;
+  rangeLow = low;
+  rangeHigh = high;
+  return true;
+}
+
+static void plotAll() {
+  for (uint16_t age = 0; age < BAROGRAPH_COLUMNS; age++) {
+    plot(age);
+  }
+}
+
+void barographBegin(uint8_t height) {
+  graphHeight = height > 0 ? height : 1;
+  newest = 0;
+  rescale();
+  plotAll();
+}
+
+bool barographShift() {
+  newest = (newest + 1) % BAROGRAPH_COLUMNS;
+  if (rescale()) {
+    plotAll();
+    return true;
+  }
+  plot(0);
+  return false;
+}
+
+BarographSpan barographColumn(uint16_t x) {
+  if (x >= BAROGRAPH_COLUMNS) return { 1, 0 };
+  return slot(BAROGRAPH_COLUMNS - 1 - x);
+}
+
+void barographRange(int16_t &low, int16_t &high) {
+  low = rangeLow;
+  high = rangeHigh;
+}
@@ -0,0 +1,35 @@
+#ifndef _BAROGRAPH_H_
+#define _BAROGRAPH_H_
+
+#include <stdint.h>
+
+// Barograph of the raw pressure samples (pressurehistory.h), one column per
+// sample with the newest on the right. The plotted columns are kept as
+// pixel spans in a ring: a new sample moves the ring on by one and plots
+// only its own column, the line from the sample before to it. The scale is
+// the min/max envelope of the samples shown in whole hPa, all columns are
+// plotted again only when that changes. Plain C++ so it also builds on the
+// host.
+
+#define BAROGRAPH_COLUMNS    144  // 12 hours
+#define BAROGRAPH_MIN_RANGE  4    // hPa from the bottom to the top row
+
+// Rows from the top of the graph, both included. Empty columns (no sample
+// or not taken) have top > bottom.
+struct BarographSpan {
+  uint8_t top;
+  uint8_t bottom;
+};
+
+// Plots the samples already in the history, e.g. after loading or a gap
+void barographBegin(uint8_t height);
+// After every pressureHistoryAdd(). True when the scale changed and all
+// columns were plotted again.
+bool barographShift();
+
+// x from 0 (oldest) to BAROGRAPH_COLUMNS - 1 (newest)
+BarographSpan barographColumn(uint16_t x);
+// hPa of the bottom and the top row
+void barographRange(int16_t &low, int16_t &high);
+
+#endif
@@ -0,0 +1,113 @@
+#include "buttons.h"
+#include "pico/time.h"
+#include "hardware/sync.h"
+
+struct Button {
+  uint8_t pin;
+  volatile bool down;
+  volatile alarm_id_t alarm;  // debounce or hold, 0 when none
+  uint32_t since;             // when it went down
+  uint16_t repeats;           // long press and repeats sent since
+};
+
+static Button buttons[BUTTON_MAX];
+static uint8_t buttonCount = 0;
+static void (*eventFunc)() = NULL;
+
+static ButtonEvent queue[BUTTON_QUEUE_SIZE];
+static volatile uint16_t queueHead = 0;  // written by the interrupts
+static volatile uint16_t queueTail = 0;  // written by the reader
+static volatile uint32_t dropped = 0;
+
+static void push(uint8_t button, ButtonEventType type, uint32_t ms) {
+  uint16_t head = queueHead;
+  uint16_t next = (head + 1) % BUTTON_QUEUE_SIZE;
+  if (next == queueTail) {
+    dropped++;
+    return;
+  }
+  queue[head] = { button, (uint8_t)type, ms };
+  __dmb();
+  queueHead = next;
+  if (eventFunc) eventFunc();
+}
+
+// The level has been still since the last edge, or a hold time is up
+static int64_t settled(alarm_id_t id, void *user_data) {
+  (void)id;
+  uint8_t i = (uint8_t)(uintptr_t)user_data;
+  Button &b = buttons[i];
+  bool down = digitalRead(b.pin) == LOW;
+  uint32_t now = millis();
+  if (down != b.down) {
+    b.down = down;
+    b.since = now;
+    b.repeats = 0;
+    push(i, down ? BUTTON_PRESS : BUTTON_RELEASE, now);
+  }
+  if (!down) {
+    b.alarm = 0;
+    return 0;
+  }
+  
+  // Held: a long press, then a repeat every BUTTON_REPEAT_MS
+  uint32_t due = b.since + BUTTON_LONG_MS + b.repeats * BUTTON_REPEAT_MS;
+  if ((int32_t)(now - due) >= 0) {
+    push(i, b.repeats == 0 ? BUTTON_LONG : BUTTON_REPEAT, now);
+    b.repeats++;
+    due += BUTTON_REPEAT_MS;
+  }
+  int32_t wait = (int32_t)(due - now);
+  if (wait < 1) wait = 1;
+  return -(int64_t)wait * 1000;  // from now
+}
+
+// Every edge, bounces included, starts the debounce time again
+static void edge(uint8_t i) {
+  Button &b = buttons[i];
+  if (b.alarm) cancel_alarm(b.alarm);
+  b.alarm = add_alarm_in_ms(BUTTON_DEBOUNCE_MS, settled, (void *)(uintptr_t)i, true);
+}
+
+// attachInterrupt() takes no argument, one handler per button
+template <uint8_t N> static void edgeIrq() {
+  edge(N);
+}
+
+static void (*const edgeIrqs[BUTTON_MAX])() = { edgeIrq<0>, edgeIrq<1>, edgeIrq<2>, edgeIrq<3> };
+
+bool buttonsBegin(const uint8_t *pins, uint8_t count, void (*onEvent)()) {
+  if (count > BUTTON_MAX) return false;
+  eventFunc = onEvent;
+  queueHead = queueTail = 0;
+  buttonCount = count;
+  for (uint8_t i = 0; i < count; i++) {
+    Button &b = buttons[i];
+    b.pin = pins[i];
+    b.alarm = 0;
+    b.repeats = 0;
+    pinMode(b.pin, INPUT_PULLUP);
+    b.down = digitalRead(b.pin) == LOW;
+    b.since = millis();
+    attachInterrupt(digitalPinToInterrupt(b.pin), edgeIrqs[i], CHANGE);
+  }
+  return true;
+}
+
+bool buttonsRead(ButtonEvent &event) {
+  uint16_t tail = queueTail;
+  if (tail == queueHead) return false;
+  __dmb();
+  event = queue[tail];
+  __dmb();
+  queueTail = (tail + 1) % BUTTON_QUEUE_SIZE;
+  return true;
+}
+
+bool buttonDown(uint8_t button) {
+  return button < buttonCount && buttons[button].down;
+}
+
+uint32_t buttonsDropped() {
+  return dropped;
+}
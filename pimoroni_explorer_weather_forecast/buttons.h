@@ -0,0 +1,39 @@
+#ifndef _BUTTONS_H_
+#define _BUTTONS_H_
+
+#include <Arduino.h>
+
+// Buttons read from their GPIO interrupts instead of polling. An edge
+// (re)starts a debounce alarm for its button and the level is taken when
+// it has held still for BUTTON_DEBOUNCE_MS. The same alarm then times the
+// long press and the auto-repeat while the button is held. Events go into
+// a lock-free queue: the GPIO and timer interrupts fill it (same priority,
+// so one at a time), the loop empties it, nothing ever waits. The GPIO
+// interrupt also wakes the core from WFI.
+
+#define BUTTON_MAX          4
+#define BUTTON_DEBOUNCE_MS  20
+#define BUTTON_LONG_MS      800
+#define BUTTON_REPEAT_MS    150  // while held after a long press
+#define BUTTON_QUEUE_SIZE   16
+
+enum ButtonEventType { BUTTON_PRESS, BUTTON_RELEASE, BUTTON_LONG, BUTTON_REPEAT };
+
+struct ButtonEvent {
+  uint8_t button;  // index in the pins given to buttonsBegin()
+  uint8_t type;    // ButtonEventType
+  uint32_t ms;     // millis() when it happened
+};
+
+// Active low pins with pull-ups. onEvent is called from the interrupt
+// after every event, e.g. to schedTrigger() the task that reads them.
+bool buttonsBegin(const uint8_t *pins, uint8_t count, void (*onEvent)() = NULL);
+
+// The oldest event, false when there is none
+bool buttonsRead(ButtonEvent &event);
+// Debounced state
+bool buttonDown(uint8_t button);
+// Events lost because the queue was full
+uint32_t buttonsDropped();
+
+#endif
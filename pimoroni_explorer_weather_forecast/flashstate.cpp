@@ -0,0 +1,183 @@
+#include "flashstate.h"
+#include "flashstore.h"
+
+#define FLASHSTATE_MAGIC      0x54534B43  // "CKST"
+#define FLASHSTATE_MAX_PARTS  4
+
+struct FlashStateHeader {
+  uint32_t magic;
+  uint32_t seq;   // goes up by one per record
+  uint32_t size;  // of the parts together
+  uint32_t crc;   // of the parts
+};
+
+#define PAGES_PER_SECTOR  (FLASH_STORE_SECTOR / FLASH_STORE_PAGE)
+
+static FlashStatePart stateParts[FLASHSTATE_MAX_PARTS];
+static uint8_t statePartCount = 0;
+static uint32_t stateSize = 0;      // parts together
+static uint32_t stateOffset = 0;    // of the ring in the area
+static uint32_t recordPages = 0;    // per slot
+static uint32_t slotCount = 0;
+static uint32_t headSlot = 0;       // next one to write
+static uint32_t stateSeq = 1;
+static int32_t newestSlot = -1;
+static int32_t erasedSlot = -1;     // sectors of the next save are blank
+
+static uint8_t pageBuf[FLASH_STORE_PAGE] __attribute__((aligned(4)));
+
+static uint32_t crc32Update(uint32_t crc, const uint8_t *data, uint32_t len) {
+  while (len--) {
+    crc ^= *data++;
+    for (uint8_t b = 0; b < 8; b++) {
+      crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+    }
+  }
+  return crc;
+}
+
+static uint32_t partsCrc() {
+  uint32_t crc = 0xFFFFFFFF;
+  for (uint8_t i = 0; i < statePartCount; i++) {
+    crc = crc32Update(crc, (const uint8_t *)stateParts[i].data, stateParts[i].size);
+  }
+  return ~crc;
+}
+
+static uint32_t slotOffset(uint32_t slot) {
+  return stateOffset + slot * recordPages * FLASH_STORE_PAGE;
+}
+
+static bool slotValid(uint32_t slot, const FlashStateHeader *&h) {
+  h = (const FlashStateHeader *)flashStoreData(slotOffset(slot));
+  if (h->magic != FLASHSTATE_MAGIC || h->size != stateSize) return false;
+  const uint8_t *data = (const uint8_t *)(h + 1);
+  return ~crc32Update(0xFFFFFFFF, data, stateSize) == h->crc;
+}
+
+bool flashStateBegin(uint32_t offset, uint32_t size, const FlashStatePart *parts, uint8_t count) {
+  if (count == 0 || count > FLASHSTATE_MAX_PARTS) return false;
+  if (!flashStoreBegin()) return false;
+  if (offset % FLASH_STORE_SECTOR || size % FLASH_STORE_SECTOR || offset + size > flashStoreSize()) return false;
+  
+  statePartCount = count;
+  stateSize = 0;
+  for (uint8_t i = 0; i < count; i++) {
+    stateParts[i] = parts[i];
+    stateSize += parts[i].size;
+  }
+  stateOffset = offset;
+  recordPages = (sizeof(FlashStateHeader) + stateSize + FLASH_STORE_PAGE - 1) / FLASH_STORE_PAGE;
+  slotCount = size / FLASH_STORE_PAGE / recordPages;
+  // Erasing the sector a record starts in must not hit the newest one
+  if (slotCount * recordPages < recordPages + PAGES_PER_SECTOR) return false;
+  
+  // Newest good record, the next slot is where the ring goes on
+  newestSlot = -1;
+  stateSeq = 1;
+  for (uint32_t slot = 0; slot < slotCount; slot++) {
+    const FlashStateHeader *h;
+    if (!slotValid(slot, h)) continue;
+    if (newestSlot < 0 || h->seq >= stateSeq) {
+      newestSlot = slot;
+      stateSeq = h->seq + 1;
+    }
+  }
+  headSlot = newestSlot < 0 ? 0 : (newestSlot + 1) % slotCount;
+  erasedSlot = -1;
+  return true;
+}
+
+bool flashStateLoad() {
+  if (newestSlot < 0) return false;
+  const uint8_t *data = flashStoreData(slotOffset(newestSlot) + sizeof(FlashStateHeader));
+  for (uint8_t i = 0; i < statePartCount; i++) {
+    memcpy(stateParts[i].data, data, stateParts[i].size);
+    data += stateParts[i].size;
+  }
+  return true;
+}
+
+// Record being written, through the page buffer
+static uint32_t writeOffset = 0;
+static uint16_t writeUsed = 0;
+
+static void writePage() {
+  memset(pageBuf + writeUsed, 0xFF, FLASH_STORE_PAGE - writeUsed);
+  // Entering a new sector: erase it, it only holds older records
+  if (writeOffset % FLASH_STORE_SECTOR == 0 && !flashStoreBlank(writeOffset, FLASH_STORE_SECTOR)) {
+    flashStoreErase(writeOffset);
+  }
+  flashStoreProgram(writeOffset, pageBuf);
+  writeOffset += FLASH_STORE_PAGE;
+  writeUsed = 0;
+}
+
+static void writeBytes(const uint8_t *data, uint32_t len) {
+  while (len > 0) {
+    uint32_t n = FLASH_STORE_PAGE - writeUsed;
+    if (n > len) n = len;
+    memcpy(pageBuf + writeUsed, data, n);
+    writeUsed += n;
+    data += n;
+    len -= n;
+    if (writeUsed == FLASH_STORE_PAGE) writePage();
+  }
+}
+
+// The pages of a slot before the first sector it erases have to be blank,
+// they aren't after a save that was cut short
+static bool slotWritable(uint32_t slot) {
+  uint32_t offset = slotOffset(slot);
+  uint32_t end = offset + recordPages * FLASH_STORE_PAGE;
+  for (; offset < end && offset % FLASH_STORE_SECTOR; offset++) {
+    if (*flashStoreData(offset) != 0xFF) return false;
+  }
+  return true;
+}
+
+// Slot 0 starts a sector, so this ends
+static void skipUnwritable() {
+  while (!slotWritable(headSlot)) {
+    headSlot = (headSlot + 1) % slotCount;
+  }
+}
+
+bool flashStateEraseAhead() {
+  if (statePartCount == 0 || erasedSlot == (int32_t)headSlot) return false;
+  skipUnwritable();
+  // The sectors the record starts in on the way, the part before the first
+  // one is blank already
+  uint32_t offset = slotOffset(headSlot);
+  uint32_t end = offset + recordPages * FLASH_STORE_PAGE;
+  offset = (offset + FLASH_STORE_SECTOR - 1) & ~(FLASH_STORE_SECTOR - 1);
+  for (; offset < end; offset += FLASH_STORE_SECTOR) {
+    if (flashStoreBlank(offset, FLASH_STORE_SECTOR)) continue;
+    flashStoreErase(offset);
+    return true;
+  }
+  erasedSlot = headSlot;
+  return false;
+}
+
+bool flashStateSave() {
+  if (statePartCount == 0) return false;
+  skipUnwritable();
+  FlashStateHeader header = { FLASHSTATE_MAGIC, stateSeq, stateSize, partsCrc() };
+  writeOffset = slotOffset(headSlot);
+  writeUsed = 0;
+  writeBytes((const uint8_t *)&header, sizeof(header));
+  for (uint8_t i = 0; i < statePartCount; i++) {
+    writeBytes((const uint8_t *)stateParts[i].data, stateParts[i].size);
+  }
+  if (writeUsed > 0) writePage();
+  
+  // Read it back before calling it the newest, a bad slot is skipped
+  const FlashStateHeader *h;
+  bool ok = slotValid(headSlot, h);
+  if (ok) newestSlot = headSlot;
+  headSlot = (headSlot + 1) % slotCount;
+  erasedSlot = -1;
+  stateSeq++;
+  return ok;
+}
@@ -0,0 +1,36 @@
+#ifndef _FLASHSTATE_H_
+#define _FLASHSTATE_H_
+
+#include <Arduino.h>
+
+// Checkpoints of a few RAM blocks in a part of the flashstore area, to get
+// them back after a reboot. Every save writes a new record (header with a
+// sequence number and a CRC, then the blocks) to the next slot of a ring,
+// so the wear goes round the whole part and a save cut short by a reset
+// leaves the one before intact. Loading takes the newest record whose CRC
+// checks out.
+
+struct FlashStatePart {
+  void *data;
+  uint32_t size;
+};
+
+// offset and size in the flashstore area, sector aligned. The parts are
+// what gets saved and loaded, a record written with other sizes is
+// ignored.
+bool flashStateBegin(uint32_t offset, uint32_t size, const FlashStatePart *parts, uint8_t count);
+
+// Copies the newest record into the parts, false (and the parts left
+// alone) when there is none
+bool flashStateLoad();
+
+// Erases a sector every time the ring gets into a new one, ~50 ms, unless
+// flashStateEraseAhead() got to it first
+bool flashStateSave();
+
+// Erases one sector the next save goes into that isn't blank yet. Call it
+// from a low priority task, true when it erased (~50 ms with the other
+// core stopped).
+bool flashStateEraseAhead();
+
+#endif
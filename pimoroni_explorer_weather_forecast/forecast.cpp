@@ -0,0 +1,26 @@
+#include "forecast.h"
+
+ForecastResult classifyForecast(float seaLevelPressure, float trend) {
+  // These thresholds are based on common meteorological guidelines
+  if (trend > 2.0f) {
+    // Rapidly rising
+    return { FORECAST_FAIR, "Improving" };
+  } else if (trend > 0.5f) {
+    // Slowly rising
+    if (seaLevelPressure > 1020) return { FORECAST_SUNNY, "Fair Weather" };
+    return { FORECAST_FAIR, "Improving" };
+  } else if (trend > -0.5f) {
+    // Stable
+    if (seaLevelPressure > 1020) return { FORECAST_SUNNY, "Stable/Fair" };
+    if (seaLevelPressure > 1000) return { FORECAST_FAIR, "Partly Cloudy" };
+    return { FORECAST_CHANGING, "Unsettled" };
+  } else if (trend > -2.0f) {
+    // Slowly falling
+    if (seaLevelPressure > 1010) return { FORECAST_CHANGING, "Clouding Up" };
+    return { FORECAST_RAIN, "Rain Likely" };
+  }
+  
+  // Rapidly falling
+  if (seaLevelPressure < 1000) return { FORECAST_STORM, "Storm Warning" };
+  return { FORECAST_RAIN, "Rain Coming" };
+}
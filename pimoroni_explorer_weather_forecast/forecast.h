@@ -0,0 +1,24 @@
+#ifndef _FORECAST_H_
+#define _FORECAST_H_
+
+// Barometer forecast: thresholds on sea level pressure and its trend,
+// after the usual rules of thumb. Plain C++ so it also builds on the host.
+
+enum Forecast {
+  FORECAST_UNKNOWN,
+  FORECAST_SUNNY,
+  FORECAST_FAIR,
+  FORECAST_CHANGING,
+  FORECAST_RAIN,
+  FORECAST_STORM
+};
+
+struct ForecastResult {
+  Forecast forecast;
+  const char* text;
+};
+
+// seaLevelPressure in hPa, trend in hPa per hour
+ForecastResult classifyForecast(float seaLevelPressure, float trend);
+
+#endif
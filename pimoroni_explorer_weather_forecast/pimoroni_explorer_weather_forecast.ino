@@ -1,8 +1,17 @@
 #include <Wire.h>
-#include <Adafruit_BME280.h>
 #include <Arduino_GFX_Library.h>
 #include "Arduino_PimoroniPAR8.h"
 #include "Arduino_ST7789_Parallel.h"
+#include "sensorstick.h"
+#include "flashstore.h"
+#include "flashlog.h"
+#include "flashstate.h"
+#include "aonclock.h"
+#include "scheduler.h"
+#include "buttons.h"
+#include "forecast.h"
+#include "pressurehistory.h"
+#include "barograph.h"
 
 // Define this to use Arduino_Canvas (framebuffer)
 #define USE_CANVAS
@@ -30,16 +39,21 @@
 // Button pins - using board-defined pins from Arduino Pico
 // SWITCH_A, SWITCH_B, SWITCH_X, SWITCH_Y are defined by the board
 
-// I2C Address
-#define BME280_ADDR  0x76
+// BME280 in forced mode with 1x oversampling, one measurement a minute
+// and asleep in between (the datasheet's weather monitoring setup). The
+// forecast only needs a pressure sample every 5 minutes.
+#define BME280_PROFILE  BME280_PROFILE_WEATHER
 
-// Pressure history settings
-#define PRESSURE_SAMPLES 36  // Number of samples (default: 36 = 3 hours at 5min intervals)
-                             // Options: 12 (1hr), 24 (2hr), 36 (3hr), 48 (4hr), 72 (6hr)
-#define SAMPLE_INTERVAL 300000  // 5 minutes in milliseconds
+// Pressure history settings. The history keeps a day of 5 minute samples,
+// a week of hours and 90 days (pressurehistory.h), the forecast uses the
+// least squares trend of the last 3 hours of them.
+#define PRESSURE_SAMPLES PRESSURE_3H_SAMPLES  // 36 = 3 hours at 5min intervals
+#define SAMPLE_INTERVAL PRESSURE_SAMPLE_MS  // 5 minutes in milliseconds
 
-// BME280 sensor
-Adafruit_BME280 bme;
+// Barograph of the last 12 hours, bottom right
+#define GRAPH_X  170
+#define GRAPH_Y  194
+#define GRAPH_H  32
 
 // Display objects
 Arduino_PimoroniPAR8 *bus;
@@ -55,47 +69,29 @@ Arduino_ST7789_Parallel *gfx;
 const int16_t SCREEN_WIDTH = 320;
 const int16_t SCREEN_HEIGHT = 240;
 
-// Time and date variables
+// Time and date as shown and set, the clock itself is the AON timer
 int hours = 12;
 int minutes = 0;
 int seconds = 0;
 int day = 1;
 int month = 1;
 int year = 2025;
-unsigned long lastTimeUpdate = 0;
+bool clockKept = false;  // the AON timer ran on through the reset
 
-// Button states
-bool btnAPressed = false;
-bool btnBPressed = false;
-bool btnXPressed = false;
-bool btnYPressed = false;
+// Buttons (buttons.h), in this order in the events
+enum { BUTTON_A, BUTTON_B, BUTTON_X, BUTTON_Y };
+const uint8_t buttonPins[] = { SWITCH_A, SWITCH_B, SWITCH_X, SWITCH_Y };
+int8_t wakeButton = -1;  // woke the screensaver, ignored until released
 
 // Time setting mode
 bool settingTime = false;
 enum SettingMode { SET_HOURS, SET_MINUTES, SET_DAY, SET_MONTH, SET_YEAR, SET_ALTITUDE };
 SettingMode settingMode = SET_HOURS;
-unsigned long lastBlink = 0;
 bool blinkState = true;
 
 // Altitude setting (meters above sea level)
 int altitudeMeters = 0;  // Set to your location's altitude
 
-// Pressure tracking for forecast
-float pressureHistory[PRESSURE_SAMPLES];
-int pressureIndex = 0;
-unsigned long lastPressureSample = 0;
-int samplesCollected = 0;
-
-// Weather forecast types
-enum Forecast {
-  FORECAST_UNKNOWN,
-  FORECAST_SUNNY,
-  FORECAST_FAIR,
-  FORECAST_CHANGING,
-  FORECAST_RAIN,
-  FORECAST_STORM
-};
-
 // Sensor data
 struct WeatherData {
   float temperature;
@@ -108,12 +104,66 @@ struct WeatherData {
   const char* forecastText;
 } weather;
 
-// Screensaver variables
+// Logging to the FS area of the flash (pick a Flash Size with FS in the
+// Tools menu). One record a minute stamped with the clock, type d on the
+// serial port for all of it as CSV, h for the last day. The sectors the log
+// and the checkpoints go into next are erased ahead by a task of their own,
+// so a record or a checkpoint never waits for it.
+#define LOG_INTERVAL_MS  60000
+#define ERASE_AHEAD_MS   10000
+#define LOG_CHANNELS     3
+#define LOG_HEADER       "time_s_since_2000,temp_cC,humidity_c%,pressure_Pa"
+bool logEnabled = false;
+
+// The pressure history, clock and altitude are checkpointed with every
+// pressure sample into the last 64 KB of the FS area (the log gets the
+// rest), so a reboot comes back with the history and a forecast. The AON
+// timer keeps the time through a reset, the samples missed are left out of
+// the history then. After a power cut the clock goes on from the time of
+// the checkpoint: set the time and the samples missed while it was off are
+// left out.
+#define STATE_FLASH_SIZE  (16 * FLASH_STORE_SECTOR)
+struct ClockState {
+  uint32_t time;  // aonClockNow()
+  int32_t altitude;
+} clockState;
+bool stateEnabled = false;
+bool clockRestored = false;
+
+// Screensaver variables. The clock box moves around against burn-in, on
+// little power: dimmed backlight, the panel in idle mode (8 colours) and
+// partial mode (only the gate lines under the box are scanned), and once
+// a second only the rows of the box that changed go over the bus.
+#define BACKLIGHT        65
+#define SAVER_BACKLIGHT  16
+#define SAVER_W          176  // even, see pushRect()
+#define SAVER_H          82
+#define SAVER_MOVE_MS    10000
 bool screensaverActive = false;
 unsigned long lastActivity = 0;
 const unsigned long SCREENSAVER_TIMEOUT = 300000;  // 5 minutes (300000 ms)
-int clockX = 0;
+int clockX = 0;  // top left of the box
 int clockY = 0;
+unsigned long lastMove = 0;
+
+// Tasks (scheduler.h). The core sleeps until one is due or triggered.
+#define SERIAL_PERIOD_MS  100
+#define BLINK_MS          500    // setting mode, the field being set
+#define STATS_PERIOD_MS   60000
+int8_t renderTask = -1;
+int8_t tickTask = -1;
+int8_t sensorTask = -1;
+int8_t buttonTask = -1;
+int8_t blinkTask = -1;
+
+// Display bus use since the last stats line
+uint32_t pushUs = 0;
+uint32_t pushBytes = 0;
+uint16_t pushFrames = 0;
+
+// Hash of every row as last sent, see pushRect()
+uint32_t rowHash[SCREEN_HEIGHT];
+unsigned long statsStart = 0;
 
 void setup() {
   Serial.begin(115200);
@@ -121,11 +171,13 @@ void setup() {
   
   Serial.println("\n=== Pimoroni Weather Clock ===");
   
-  // Initialize buttons
-  pinMode(SWITCH_A, INPUT_PULLUP);
-  pinMode(SWITCH_B, INPUT_PULLUP);
-  pinMode(SWITCH_X, INPUT_PULLUP);
-  pinMode(SWITCH_Y, INPUT_PULLUP);
+  // Initialize buttons, their events run the button task
+  buttonsBegin(buttonPins, 4, buttonChanged);
+  
+  // Start the clock, unless it kept going through the reset
+  clockKept = aonClockBegin(clockFromFields());
+  updateTime();
+  Serial.println(clockKept ? "Clock kept through the reset" : "Clock started");
   
   // Initialize I2C
   Wire.begin();
@@ -152,7 +204,7 @@ void setup() {
   Serial.println("Display initialized!");
   #endif
   
-  display->setBacklight(65);  // Set to 65
+  display->setBacklight(BACKLIGHT);
   
   // Show splash
   gfx->fillScreen(COLOR(BLACK));
@@ -165,125 +217,232 @@ void setup() {
   #endif
   delay(1000);
   
-  // Initialize BME280
-  if (!bme.begin(BME280_ADDR)) {
+  // Initialize BME280 and read it in the background from now on
+  if (!initBME280(BME280_PROFILE)) {
     Serial.println("Could not find BME280 sensor!");
     showError("BME280 not found!");
     while (1) delay(10);
   }
-  Serial.println("BME280 initialized");
+  sensorAsyncSetRate(SENSOR_BME280, bme280PeriodMs());
+  if (!sensorAsyncBegin()) {
+    Serial.println("Could not start sensor acquisition!");
+    showError("No sensor timer!");
+    while (1) delay(10);
+  }
   
   // Initialize pressure history
-  for (int i = 0; i < PRESSURE_SAMPLES; i++) {
-    pressureHistory[i] = 0;
-  }
+  pressureHistoryClear();
   
   // Initialize screensaver
   lastActivity = millis();
   
-  delay(500);
+  // Pick up the history and clock of the last run
+  readWeather();
+  restoreState();
+  barographBegin(GRAPH_H);
+  calculateForecast();
+  
+  // Pick up the log of earlier runs
+  logEnabled = flashLogBegin(LOG_CHANNELS, STATE_FLASH_SIZE);
+  if (logEnabled) {
+    FlashLogStats stats;
+    flashLogGetStats(stats);
+    Serial.print("Log: ");
+    Serial.print(stats.records);
+    Serial.print(" records in ");
+    Serial.print(stats.pages);
+    Serial.print("/");
+    Serial.print(stats.capacity);
+    Serial.println(" pages");
+  } else {
+    Serial.println("No FS area in flash, logging off");
+  }
+  
+  // Everything from here on runs as tasks, started by the clock tick, new
+  // readings, the buttons or their period
+  renderTask = schedAdd(renderFrame, 0);
+  tickTask = schedAdd(clockTick, 0);
+  sensorTask = schedAdd(sensorUpdate, 0);
+  buttonTask = schedAdd(buttonEvent, 0);
+  blinkTask = schedAdd(blink, 0);
+  schedAdd(updatePressureHistory, SAMPLE_INTERVAL);
+  if (logEnabled) schedAdd(logWeather, LOG_INTERVAL_MS);
+  if (logEnabled || stateEnabled) schedAdd(eraseAhead, ERASE_AHEAD_MS);
+  schedAdd(handleSerialCommands, SERIAL_PERIOD_MS);
+  schedAdd(printStats, STATS_PERIOD_MS);
+  aonClockOnTick(clockTicked);
+  sensorAsyncOnUpdate(sensorUpdated);
+  schedTrigger(renderTask);
+  schedLoad();
+  statsStart = millis();
 }
 
 void loop() {
-  // Update time
+  schedRun();
+}
+
+// Interrupts, they only start the task that deals with it
+void clockTicked() {
+  schedTrigger(tickTask);
+}
+
+void sensorUpdated(SensorId id) {
+  (void)id;
+  schedTrigger(sensorTask);
+}
+
+void buttonChanged() {
+  schedTrigger(buttonTask);
+}
+
+void clockTick() {
   updateTime();
-  
-  // Handle buttons
-  handleButtons();
-  
-  // Check for screensaver activation/deactivation
   updateScreensaver();
+  schedTrigger(renderTask);
+}
   
-  // Read sensor and update pressure history
+// Redraw only when a reading changes in the digits shown
+void sensorUpdate() {
+  static long shown[4];
   readWeather();
-  updatePressureHistory();
+  long now[4] = {
+    lroundf(weather.temperature * 10),
+    lroundf(weather.humidity),
+    lroundf(weather.seaLevelPressure * 10),
+    lroundf(weather.dewPoint * 10),
+  };
+  if (memcmp(now, shown, sizeof(now)) == 0) return;
+  memcpy(shown, now, sizeof(now));
+  schedTrigger(renderTask);
+}
+
+void buttonEvent() {
+  ButtonEvent event;
+  while (buttonsRead(event)) handleButton(event);
+  schedTrigger(renderTask);
+}
   
-  // Calculate forecast
-  calculateForecast();
+void blink() {
+  blinkState = !blinkState;
+  schedTrigger(renderTask);
+}
   
-  // Update display
+void renderFrame() {
   if (screensaverActive) {
     drawScreensaver();
+    pushRect(clockX, clockY, SAVER_W, SAVER_H);
   } else {
     updateDisplay();
+    pushRect(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
   }
+}
   
+// Send the rows of the rectangle that changed since the last frame. The
+// whole width goes as one band (the canvas rows are one block of memory),
+// a narrower rectangle row by row. The clock ticking over is ~30 of the
+// 240 rows. x and w even, the rows are hashed in 32 bit words.
+void pushRect(int16_t x, int16_t y, int16_t w, int16_t h) {
   #ifdef USE_CANVAS
-  gfx->flush();
+  uint16_t *framebuffer = gfx->getFramebuffer();
+  int16_t first = -1, last = -1;
+  for (int16_t r = y; r < y + h; r++) {
+    const uint32_t *row = (const uint32_t *)(framebuffer + r * SCREEN_WIDTH + x);
+    uint32_t hash = 2166136261u;  // FNV-1a over 32 bit words
+    for (int16_t i = 0; i < w / 2; i++) {
+      hash = (hash ^ row[i]) * 16777619u;
+    }
+    if (hash != rowHash[r]) {
+      rowHash[r] = hash;
+      if (first < 0) first = r;
+      last = r;
+    }
+  }
+  if (first < 0) return;
+  
+  uint16_t rows = last - first + 1;
+  uint32_t start = micros();
+  if (w == SCREEN_WIDTH) {
+    display->draw16bitRGBBitmap(0, first, framebuffer + first * SCREEN_WIDTH, SCREEN_WIDTH, rows);
+  } else {
+    for (int16_t r = first; r <= last; r++) {
+      display->draw16bitRGBBitmap(x, r, framebuffer + r * SCREEN_WIDTH + x, w, 1);
+    }
+  }
+  pushUs += micros() - start;
+  pushBytes += (uint32_t)rows * w * 2;
+  pushFrames++;
   #endif
+}
   
-  delay(50);
+// The panel no longer shows what was sent, the next frame goes out whole
+void resendFrame() {
+  memset(rowHash, 0, sizeof(rowHash));
+}
+  
+// Duty cycle since the last call: time in tasks, and how long the display
+// bus was busy and what went over it
+void printStats() {
+  uint32_t elapsed = millis() - statsStart;
+  statsStart = millis();
+  if (elapsed == 0) return;
+  Serial.print("Busy ");
+  Serial.print(schedLoad(10000) / 100.0, 2);
+  Serial.print("%, display bus ");
+  Serial.print(pushUs / (elapsed * 10.0), 2);
+  Serial.print("% (");
+  Serial.print(pushFrames);
+  Serial.print(" frames, ");
+  Serial.print(pushBytes / (float)elapsed, 1);
+  Serial.println(" KB/s)");
+  pushUs = 0;
+  pushBytes = 0;
+  pushFrames = 0;
 }
 
+// The fields follow the AON timer, except while they are being set
 void updateTime() {
-  unsigned long currentMillis = millis();
-  
-  if (!settingTime && currentMillis - lastTimeUpdate >= 1000) {
-    lastTimeUpdate += 1000;  // Fixed: use += to prevent drift
-    seconds++;
-    
-    if (seconds >= 60) {
-      seconds = 0;
-      minutes++;
-      
-      if (minutes >= 60) {
-        minutes = 0;
-        hours++;
-        
-        if (hours >= 24) {
-          hours = 0;
-          day++;
-          
-          // Days in month
-          int daysInMonth = getDaysInMonth(month, year);
-          if (day > daysInMonth) {
-            day = 1;
-            month++;
-            
-            if (month > 12) {
-              month = 1;
-              year++;
-            }
-          }
-        }
-      }
-    }
-  }
+  if (settingTime) return;
+  struct tm cal;
+  aonClockToCalendar(aonClockNow(), cal);
+  seconds = cal.tm_sec;
+  minutes = cal.tm_min;
+  hours = cal.tm_hour;
+  day = cal.tm_mday;
+  month = cal.tm_mon + 1;
+  year = cal.tm_year + 1900;
 }
 
-int getDaysInMonth(int m, int y) {
-  if (m == 2) {
-    // Leap year check
-    if ((y % 4 == 0 && y % 100 != 0) || (y % 400 == 0)) {
-      return 29;
-    }
-    return 28;
-  }
-  if (m == 4 || m == 6 || m == 9 || m == 11) {
-    return 30;
-  }
-  return 31;
+// The clock fields as seconds since 1/1/2000
+uint32_t clockFromFields() {
+  struct tm cal = {};
+  cal.tm_sec = seconds;
+  cal.tm_min = minutes;
+  cal.tm_hour = hours;
+  cal.tm_mday = day;
+  cal.tm_mon = month - 1;
+  cal.tm_year = year - 1900;
+  return aonClockFromCalendar(cal);
 }
 
-void handleButtons() {
-  bool btnA = !digitalRead(SWITCH_A);
-  bool btnB = !digitalRead(SWITCH_B);
-  bool btnX = !digitalRead(SWITCH_X);
-  bool btnY = !digitalRead(SWITCH_Y);
+void handleButton(const ButtonEvent &event) {
+  if (event.type == BUTTON_RELEASE) {
+    if (event.button == wakeButton) wakeButton = -1;
+    return;
+  }
+  if (event.button == wakeButton) return;
+  lastActivity = millis();
   
-  // Any button press resets screensaver
-  if (btnA || btnB || btnX || btnY) {
-    if (screensaverActive) {
-      // Exit screensaver on any button press
-      screensaverActive = false;
-      lastActivity = millis();
-      return;  // Don't process button if just exiting screensaver
-    }
-    lastActivity = millis();
+  // Any button press exits the screensaver, and does nothing else
+  if (screensaverActive) {
+    stopScreensaver();
+    wakeButton = event.button;
+    return;
   }
   
+  bool press = event.type == BUTTON_PRESS;
+  
   // A button - Enter/exit time setting mode
-  if (btnA && !btnAPressed) {
+  if (event.button == BUTTON_A && press) {
     settingTime = !settingTime;
     if (settingTime) {
       settingMode = SET_HOURS;
@@ -291,153 +450,100 @@ void handleButtons() {
     } else {
       Serial.println("Time/Date setting mode DISABLED");
       seconds = 0;  // Reset seconds when exiting
-      lastTimeUpdate = millis();
+      timeSet();
     }
-    delay(200);  // Debounce
+    schedSetPeriod(blinkTask, settingTime ? BLINK_MS : 0);
+    blinkState = true;
   }
-  btnAPressed = btnA;
+  if (!settingTime) return;
   
   // B button - Cycle through setting modes
-  if (settingTime && btnB && !btnBPressed) {
+  if (event.button == BUTTON_B && press) {
     settingMode = (SettingMode)((settingMode + 1) % 6);
     const char* modeNames[] = {"HOURS", "MINUTES", "DAY", "MONTH", "YEAR", "ALTITUDE"};
     Serial.print("Now setting: ");
     Serial.println(modeNames[settingMode]);
-    delay(200);
-  }
-  btnBPressed = btnB;
-  
-  // X button - Increment
-  if (settingTime && btnX && !btnXPressed) {
-    switch(settingMode) {
-      case SET_HOURS:
-        hours++;
-        if (hours >= 24) hours = 0;
-        break;
-      case SET_MINUTES:
-        minutes++;
-        if (minutes >= 60) minutes = 0;
-        break;
-      case SET_DAY:
-        day++;
-        if (day > getDaysInMonth(month, year)) day = 1;
-        break;
-      case SET_MONTH:
-        month++;
-        if (month > 12) month = 1;
-        // Adjust day if needed
-        if (day > getDaysInMonth(month, year)) {
-          day = getDaysInMonth(month, year);
-        }
-        break;
-      case SET_YEAR:
-        year++;
-        if (year > 2099) year = 2025;
-        // Adjust day for leap year changes
-        if (day > getDaysInMonth(month, year)) {
-          day = getDaysInMonth(month, year);
-        }
-        break;
-      case SET_ALTITUDE:
-        altitudeMeters += 10;
-        if (altitudeMeters > 5000) altitudeMeters = 0;
-        break;
-    }
-    Serial.print("Date/Time: ");
-    Serial.print(year);
-    Serial.print("-");
-    Serial.print(month);
-    Serial.print("-");
-    Serial.print(day);
-    Serial.print(" ");
-    Serial.print(hours);
-    Serial.print(":");
-    Serial.print(minutes);
-    Serial.print(" Altitude: ");
-    Serial.print(altitudeMeters);
-    Serial.println("m");
-    delay(150);
-  }
-  btnXPressed = btnX;
-  
-  // Y button - Decrement
-  if (settingTime && btnY && !btnYPressed) {
-    switch(settingMode) {
-      case SET_HOURS:
-        hours--;
-        if (hours < 0) hours = 23;
-        break;
-      case SET_MINUTES:
-        minutes--;
-        if (minutes < 0) minutes = 59;
-        break;
-      case SET_DAY:
-        day--;
-        if (day < 1) day = getDaysInMonth(month, year);
-        break;
-      case SET_MONTH:
-        month--;
-        if (month < 1) month = 12;
-        // Adjust day if needed
-        if (day > getDaysInMonth(month, year)) {
-          day = getDaysInMonth(month, year);
-        }
-        break;
-      case SET_YEAR:
-        year--;
-        if (year < 2025) year = 2099;
-        // Adjust day for leap year changes
-        if (day > getDaysInMonth(month, year)) {
-          day = getDaysInMonth(month, year);
-        }
-        break;
-      case SET_ALTITUDE:
-        altitudeMeters -= 10;
-        if (altitudeMeters < 0) altitudeMeters = 5000;
-        break;
-    }
-    Serial.print("Date/Time: ");
-    Serial.print(year);
-    Serial.print("-");
-    Serial.print(month);
-    Serial.print("-");
-    Serial.print(day);
-    Serial.print(" ");
-    Serial.print(hours);
-    Serial.print(":");
-    Serial.print(minutes);
-    Serial.print(" Altitude: ");
-    Serial.print(altitudeMeters);
-    Serial.println("m");
-    delay(150);
-  }
-  btnYPressed = btnY;
+  }
+  
+  // X button - Increment, Y button - Decrement, both repeat while held
+  if (event.button == BUTTON_X) adjustSetting(1);
+  if (event.button == BUTTON_Y) adjustSetting(-1);
+}
+
+void adjustSetting(int step) {
+  switch(settingMode) {
+    case SET_HOURS:
+      hours = (hours + 24 + step) % 24;
+      break;
+    case SET_MINUTES:
+      minutes = (minutes + 60 + step) % 60;
+      break;
+    case SET_DAY:
+      day += step;
+      if (day > aonClockDaysInMonth(month, year)) day = 1;
+      if (day < 1) day = aonClockDaysInMonth(month, year);
+      break;
+    case SET_MONTH:
+      month += step;
+      if (month > 12) month = 1;
+      if (month < 1) month = 12;
+      break;
+    case SET_YEAR:
+      year += step;
+      if (year > 2099) year = 2025;
+      if (year < 2025) year = 2099;
+      break;
+    case SET_ALTITUDE:
+      altitudeMeters += step * 10;
+      if (altitudeMeters > 5000) altitudeMeters = 0;
+      if (altitudeMeters < 0) altitudeMeters = 5000;
+      break;
+  }
+  // Adjust day if needed, also for leap year changes
+  if (day > aonClockDaysInMonth(month, year)) {
+    day = aonClockDaysInMonth(month, year);
+  }
+  Serial.print("Date/Time: ");
+  Serial.print(year);
+  Serial.print("-");
+  Serial.print(month);
+  Serial.print("-");
+  Serial.print(day);
+  Serial.print(" ");
+  Serial.print(hours);
+  Serial.print(":");
+  Serial.print(minutes);
+  Serial.print(" Altitude: ");
+  Serial.print(altitudeMeters);
+  Serial.println("m");
 }
 
+// Every SAMPLE_INTERVAL
 void updatePressureHistory() {
-  unsigned long currentMillis = millis();
-  
-  // Sample pressure every 5 minutes
-  if (currentMillis - lastPressureSample >= SAMPLE_INTERVAL) {
-    lastPressureSample = currentMillis;
-    
-    pressureHistory[pressureIndex] = weather.seaLevelPressure;  // Use sea level pressure
-    pressureIndex = (pressureIndex + 1) % PRESSURE_SAMPLES;
-    
-    if (samplesCollected < PRESSURE_SAMPLES) {
-      samplesCollected++;
-    }
+  pressureHistoryAdd(weather.seaLevelPressure);  // Use sea level pressure
+  barographShift();
+  
+  Serial.print("Pressure sample #");
+  Serial.print(pressureHistoryCount(PRESSURE_RAW));
+  Serial.print(": ");
+  Serial.print(weather.seaLevelPressure);
+  Serial.println(" hPa (sea level)");
     
-    Serial.print("Pressure sample #");
-    Serial.print(samplesCollected);
-    Serial.print(": ");
-    Serial.print(weather.seaLevelPressure);
-    Serial.println(" hPa (sea level)");
-  }
+  calculateForecast();
+  saveState();
+  schedTrigger(renderTask);
+}
+
+// Samples the forecast looks at, up to PRESSURE_SAMPLES (fewer when some
+// were missed while the station was off)
+int forecastSamples() {
+  PressureTrend trend;
+  pressureHistoryTrend(PRESSURE_WINDOW_3H, trend);
+  return trend.samples;
 }
 
 void calculateForecast() {
-  if (samplesCollected < 2) {
+  if (forecastSamples() < 2) {
     // Not enough data yet
     weather.pressureTrend = 0;
     weather.forecast = FORECAST_UNKNOWN;
@@ -445,69 +551,30 @@ void calculateForecast() {
     return;
   }
   
-  // Calculate pressure trend (change per hour)
-  // Compare current pressure to oldest sample (use sea level pressure)
-  int oldestIndex = (pressureIndex + PRESSURE_SAMPLES - samplesCollected) % PRESSURE_SAMPLES;
-  float oldestPressure = pressureHistory[oldestIndex];
-  float pressureChange = weather.seaLevelPressure - oldestPressure;
-  
-  // Convert to hPa per hour
-  float hoursElapsed = (samplesCollected * SAMPLE_INTERVAL) / 3600000.0;
-  weather.pressureTrend = pressureChange / hoursElapsed;
-  
-  // Forecast based on sea level pressure and trend
-  // These thresholds are based on common meteorological guidelines
-  
-  if (weather.pressureTrend > 2.0) {
-    // Rapidly rising
-    weather.forecast = FORECAST_FAIR;
-    weather.forecastText = "Improving";
-  } else if (weather.pressureTrend > 0.5) {
-    // Slowly rising
-    if (weather.seaLevelPressure > 1020) {
-      weather.forecast = FORECAST_SUNNY;
-      weather.forecastText = "Fair Weather";
-    } else {
-      weather.forecast = FORECAST_FAIR;
-      weather.forecastText = "Improving";
-    }
-  } else if (weather.pressureTrend > -0.5) {
-    // Stable
-    if (weather.seaLevelPressure > 1020) {
-      weather.forecast = FORECAST_SUNNY;
-      weather.forecastText = "Stable/Fair";
-    } else if (weather.seaLevelPressure > 1000) {
-      weather.forecast = FORECAST_FAIR;
-      weather.forecastText = "Partly Cloudy";
-    } else {
-      weather.forecast = FORECAST_CHANGING;
-      weather.forecastText = "Unsettled";
-    }
-  } else if (weather.pressureTrend > -2.0) {
-    // Slowly falling
-    if (weather.seaLevelPressure > 1010) {
-      weather.forecast = FORECAST_CHANGING;
-      weather.forecastText = "Clouding Up";
-    } else {
-      weather.forecast = FORECAST_RAIN;
-      weather.forecastText = "Rain Likely";
-    }
-  } else {
-    // Rapidly falling
-    if (weather.seaLevelPressure < 1000) {
-      weather.forecast = FORECAST_STORM;
-      weather.forecastText = "Storm Warning";
-    } else {
-      weather.forecast = FORECAST_RAIN;
-      weather.forecastText = "Rain Coming";
-    }
-  }
+  // Pressure trend (change per hour): slope of the least squares line
+  // through the samples of the last 3 hours, so one noisy sample doesn't
+  // swing it
+  PressureTrend trend, hourTrend;
+  pressureHistoryTrend(PRESSURE_WINDOW_3H, trend);
+  pressureHistoryTrend(PRESSURE_WINDOW_1H, hourTrend);
+  weather.pressureTrend = trend.slope;
+  
+  // No reading yet right after a reboot, the line through the restored
+  // samples stands in for it
+  float pressure = weather.seaLevelPressure > 0 ? weather.seaLevelPressure : trend.now;
+  ForecastResult result = classifyForecast(pressure, weather.pressureTrend);
+  weather.forecast = result.forecast;
+  weather.forecastText = result.text;
   
   Serial.print("Forecast: ");
   Serial.print(weather.forecastText);
   Serial.print(" (Trend: ");
   Serial.print(weather.pressureTrend, 2);
-  Serial.println(" hPa/hr)");
+  Serial.print(" hPa/hr, last hour ");
+  Serial.print(hourTrend.slope, 2);
+  Serial.print(" hPa/hr, noise ");
+  Serial.print(sqrtf(trend.variance), 3);
+  Serial.println(" hPa)");
 }
 
 void updateDisplay() {
@@ -522,6 +589,9 @@ void updateDisplay() {
   // Draw forecast
   drawForecast();
   
+  // Draw pressure graph
+  drawBarograph();
+  
   // Draw button hints
   drawButtonHints();
 }
@@ -534,10 +604,6 @@ void drawClock() {
   
   // Day with blink if setting
   if (settingTime && settingMode == SET_DAY) {
-    if (millis() - lastBlink > 500) {
-      blinkState = !blinkState;
-      lastBlink = millis();
-    }
     if (blinkState) {
       gfx->setTextColor(COLOR(YELLOW));
     } else {
@@ -554,10 +620,6 @@ void drawClock() {
   
   // Month with blink if setting
   if (settingTime && settingMode == SET_MONTH) {
-    if (millis() - lastBlink > 500) {
-      blinkState = !blinkState;
-      lastBlink = millis();
-    }
     if (blinkState) {
       gfx->setTextColor(COLOR(YELLOW));
     } else {
@@ -574,10 +636,6 @@ void drawClock() {
   
   // Year with blink if setting
   if (settingTime && settingMode == SET_YEAR) {
-    if (millis() - lastBlink > 500) {
-      blinkState = !blinkState;
-      lastBlink = millis();
-    }
     if (blinkState) {
       gfx->setTextColor(COLOR(YELLOW));
     } else {
@@ -594,10 +652,6 @@ void drawClock() {
   // Hours
   if (settingTime && settingMode == SET_HOURS) {
     // Blink hours when setting
-    if (millis() - lastBlink > 500) {
-      blinkState = !blinkState;
-      lastBlink = millis();
-    }
     if (blinkState) {
       gfx->setTextColor(COLOR(YELLOW));
     } else {
@@ -618,10 +672,6 @@ void drawClock() {
   // Minutes
   if (settingTime && settingMode == SET_MINUTES) {
     // Blink minutes when setting
-    if (millis() - lastBlink > 500) {
-      blinkState = !blinkState;
-      lastBlink = millis();
-    }
     if (blinkState) {
       gfx->setTextColor(COLOR(YELLOW));
     } else {
@@ -658,10 +708,6 @@ void drawClock() {
     // Show altitude value when setting it
     if (settingMode == SET_ALTITUDE) {
       gfx->setTextSize(2);
-      if (millis() - lastBlink > 500) {
-        blinkState = !blinkState;
-        lastBlink = millis();
-      }
       if (blinkState) {
         gfx->setTextColor(COLOR(YELLOW));
       } else {
@@ -704,7 +750,7 @@ void drawWeatherInfo() {
   gfx->print(" hPa");
   
   // Trend arrow
-  if (samplesCollected >= 2) {
+  if (forecastSamples() >= 2) {
     int16_t arrowX = 180;
     int16_t arrowY = startY + 8;
     
@@ -785,6 +831,7 @@ void drawForecast() {
   gfx->print(" C");
   
   // Data collection status
+  int samplesCollected = forecastSamples();
   if (samplesCollected < PRESSURE_SAMPLES) {
     startY += 10;
     gfx->setTextColor(COLOR(YELLOW));
@@ -797,6 +844,26 @@ void drawForecast() {
   }
 }
 
+// Only copies the plotted columns, the barograph keeps them up to date
+void drawBarograph() {
+  gfx->drawFastHLine(GRAPH_X, GRAPH_Y + GRAPH_H, BAROGRAPH_COLUMNS, COLOR(GRAY));
+  
+  int16_t low, high;
+  barographRange(low, high);
+  gfx->setTextSize(1);
+  gfx->setTextColor(COLOR(GRAY));
+  gfx->setCursor(GRAPH_X, GRAPH_Y);
+  gfx->print(high);
+  gfx->setCursor(GRAPH_X, GRAPH_Y + GRAPH_H - 8);
+  gfx->print(low);
+  
+  for (uint16_t x = 0; x < BAROGRAPH_COLUMNS; x++) {
+    BarographSpan span = barographColumn(x);
+    if (span.top > span.bottom) continue;
+    gfx->drawFastVLine(GRAPH_X + x, GRAPH_Y + span.top, span.bottom - span.top + 1, COLOR(CYAN));
+  }
+}
+
 void drawWeatherIcon(int16_t x, int16_t y, Forecast forecast) {
   switch(forecast) {
     case FORECAST_SUNNY:
@@ -886,9 +953,12 @@ void drawButtonHints() {
 }
 
 void readWeather() {
-  weather.temperature = bme.readTemperature();
-  weather.humidity = bme.readHumidity();
-  weather.pressure = bme.readPressure() / 100.0F;  // Local pressure
+  // Latest snapshot, never waits on the I2C bus
+  SensorData sensors;
+  sensorAsyncSnapshot(sensors);
+  weather.temperature = sensors.temperature;
+  weather.humidity = sensors.humidity;
+  weather.pressure = sensors.pressure;  // Local pressure
   
   // Calculate sea level equivalent pressure
   // Formula: P0 = P / (1 - (altitude / 44330))^5.255
@@ -905,42 +975,206 @@ void readWeather() {
   weather.dewPoint = (b * alpha) / (a - alpha);
 }
 
+void restoreState() {
+  if (!flashStoreBegin()) return;
+  uint32_t historySize;
+  void *history = pressureHistoryState(historySize);
+  FlashStatePart parts[] = {
+    { history, historySize },
+    { &clockState, sizeof(clockState) },
+  };
+  stateEnabled = flashStateBegin(flashStoreSize() - STATE_FLASH_SIZE, STATE_FLASH_SIZE, parts, 2);
+  if (!stateEnabled || !flashStateLoad()) return;
+  
+  bool historyOk = pressureHistoryLoaded();
+  altitudeMeters = clockState.altitude;
+  Serial.print("Restored ");
+  Serial.print(historyOk ? pressureHistoryCount(PRESSURE_RAW) : 0);
+  Serial.print(" pressure samples from ");
+  Serial.println(clockState.time);
+  
+  if (clockKept) {
+    // The time is right, the samples missed since the checkpoint are known
+    uint32_t now = aonClockNow();
+    if (now > clockState.time) missedSamples(now - clockState.time);
+  } else {
+    aonClockSet(clockState.time);
+    clockRestored = true;
+  }
+  updateTime();
+}
+
+void saveState() {
+  if (!stateEnabled) return;
+  clockState.time = aonClockNow();
+  clockState.altitude = altitudeMeters;
+  if (!flashStateSave()) Serial.println("State checkpoint failed");
+}
+
+void missedSamples(uint32_t seconds_off) {
+  uint32_t missed = seconds_off / (PRESSURE_SAMPLE_MS / 1000);
+  pressureHistoryGap(missed);
+  barographBegin(GRAPH_H);
+  Serial.print(missed);
+  Serial.println(" pressure samples missed while off");
+}
+
+// Leaving the time setting. The first time after a power cut the clock
+// moves forward by about as long as the station was off, that many samples
+// go into the history as missing.
+void timeSet() {
+  uint32_t before = aonClockNow();
+  uint32_t now = clockFromFields();
+  aonClockSet(now);
+  if (clockRestored) {
+    clockRestored = false;
+    if (now > before) {
+      missedSamples(now - before);
+      calculateForecast();
+    }
+  }
+  saveState();
+}
+
+// Every LOG_INTERVAL_MS
+void logWeather() {
+  if (settingTime) return;
+  
+  int32_t values[LOG_CHANNELS] = {
+    (int32_t)lroundf(weather.temperature * 100),
+    (int32_t)lroundf(weather.humidity * 100),
+    (int32_t)lroundf(weather.pressure * 100),
+  };
+  // The clock can be set back, but the log's times must not go down (the
+  // queries search the pages by time). Until the clock catches up again
+  // the records keep the newest time.
+  uint32_t time = aonClockNow();
+  FlashLogStats stats;
+  flashLogGetStats(stats);
+  if (time < stats.newest) time = stats.newest;
+  flashLogAppend(time, values);
+}
+
+// Every ERASE_AHEAD_MS, mostly nothing to do. One sector at most, ~50 ms.
+void eraseAhead() {
+  if (logEnabled && flashLogEraseAhead()) return;
+  if (stateEnabled) flashStateEraseAhead();
+}
+
+// d: dump the whole log, h: the last day, f: write the RAM page to flash
+void handleSerialCommands() {
+  if (!Serial.available()) return;
+  char command = Serial.read();
+  if (command == 'p') {
+    printPressureHistory();
+    return;
+  }
+  if (!logEnabled) return;
+  
+  FlashLogStats stats;
+  flashLogGetStats(stats);
+  uint32_t count;
+  switch (command) {
+    case 'd':
+      count = flashLogExport(Serial, 0, 0xFFFFFFFF, LOG_HEADER);
+      break;
+    case 'h':
+      count = flashLogExport(Serial, stats.newest > 86400 ? stats.newest - 86400 : 0, 0xFFFFFFFF, LOG_HEADER);
+      break;
+    case 'f':
+      flashLogFlush();
+      Serial.println("Log flushed");
+      return;
+    default:
+      return;
+  }
+  Serial.print("# ");
+  Serial.print(count);
+  Serial.println(" records");
+}
+
+// Hourly and daily buckets as CSV, newest first, then the ones still open
+void printPressureHistory() {
+  static const char *names[] = { "hours", "days" };
+  PressureTier tiers[] = { PRESSURE_HOURLY, PRESSURE_DAILY };
+  for (int t = 0; t < 2; t++) {
+    Serial.print("age_");
+    Serial.print(names[t]);
+    Serial.println(",min_hPa,avg_hPa,max_hPa");
+    PressureBucket bucket;
+    if (pressureHistoryOpen(tiers[t], bucket)) printPressureBucket(-1, bucket);
+    for (uint16_t age = 0; pressureHistoryAt(tiers[t], age, bucket); age++) {
+      printPressureBucket(age, bucket);
+    }
+  }
+}
+
+void printPressureBucket(int age, const PressureBucket &bucket) {
+  Serial.print(age);
+  Serial.print(",");
+  Serial.print(bucket.min, 2);
+  Serial.print(",");
+  Serial.print(bucket.avg, 2);
+  Serial.print(",");
+  Serial.println(bucket.max, 2);
+}
+
 void updateScreensaver() {
   unsigned long currentMillis = millis();
   
   // Don't activate screensaver while setting time
   if (settingTime) {
     lastActivity = currentMillis;
-    screensaverActive = false;
+    if (screensaverActive) stopScreensaver();
     return;
   }
   
   // Check if we should activate screensaver
   if (!screensaverActive && (currentMillis - lastActivity >= SCREENSAVER_TIMEOUT)) {
-    screensaverActive = true;
-    Serial.println("Screensaver activated");
-    // Initialize random position
-    clockX = random(0, SCREEN_WIDTH - 200);
-    clockY = random(40, SCREEN_HEIGHT - 100);
+    startScreensaver();
   }
 }
 
+void startScreensaver() {
+  screensaverActive = true;
+  Serial.println("Screensaver activated");
+  display->setBacklight(SAVER_BACKLIGHT);
+  // Black all over once, from then on only the box is sent
+  display->fillScreen(BLACK);
+  display->idleMode(true);
+  moveScreensaver();
+}
+
+// Straight away on a button, the dashboard goes out whole with the next frame
+void stopScreensaver() {
+  screensaverActive = false;
+  display->partialArea(0, 0);
+  display->idleMode(false);
+  display->setBacklight(BACKLIGHT);
+  resendFrame();
+}
+
+void moveScreensaver() {
+  display->fillRect(clockX, clockY, SAVER_W, SAVER_H, BLACK);
+  clockX = random(0, SCREEN_WIDTH - SAVER_W + 1) & ~1;
+  clockY = random(0, SCREEN_HEIGHT - SAVER_H + 1);
+  display->partialArea(clockX, SAVER_W);
+  lastMove = millis();
+  resendFrame();
+}
+
+// Only the box, in colours idle mode shows
 void drawScreensaver() {
   // Move clock position every 10 seconds
-  static unsigned long lastMove = 0;
-  if (millis() - lastMove > 10000) {
-    clockX = random(0, SCREEN_WIDTH - 200);
-    clockY = random(40, SCREEN_HEIGHT - 100);
-    lastMove = millis();
-  }
+  if (millis() - lastMove >= SAVER_MOVE_MS) moveScreensaver();
   
-  // Clear screen
-  gfx->fillScreen(COLOR(BLACK));
+  // Clear the box
+  gfx->fillRect(clockX, clockY, SAVER_W, SAVER_H, COLOR(BLACK));
   
   // Draw moving date
   gfx->setTextSize(2);
   gfx->setTextColor(COLOR(CYAN));
-  gfx->setCursor(clockX, clockY - 25);
+  gfx->setCursor(clockX, clockY);
   if (day < 10) gfx->print("0");
   gfx->print(day);
   gfx->print("/");
@@ -952,7 +1186,7 @@ void drawScreensaver() {
   // Draw moving time
   gfx->setTextSize(4);
   gfx->setTextColor(COLOR(WHITE));
-  gfx->setCursor(clockX, clockY);
+  gfx->setCursor(clockX, clockY + 25);
   if (hours < 10) gfx->print("0");
   gfx->print(hours);
   gfx->print(":");
@@ -961,21 +1195,21 @@ void drawScreensaver() {
   
   // Small seconds
   gfx->setTextSize(2);
-  gfx->setTextColor(COLOR(GRAY));
-  gfx->setCursor(clockX + 150, clockY + 10);
+  gfx->setTextColor(COLOR(WHITE));
+  gfx->setCursor(clockX + 150, clockY + 35);
   if (seconds < 10) gfx->print("0");
   gfx->print(seconds);
   
   // Temperature display
   gfx->setTextSize(2);
   gfx->setTextColor(COLOR(RED));
-  gfx->setCursor(clockX, clockY + 40);
+  gfx->setCursor(clockX, clockY + 65);
   gfx->print(weather.temperature, 1);
   gfx->print(" C");
   
   // Humidity
   gfx->setTextColor(COLOR(GREEN));
-  gfx->setCursor(clockX + 120, clockY + 40);
+  gfx->setCursor(clockX + 120, clockY + 65);
   gfx->print(weather.humidity, 0);
   gfx->print("%");
 }
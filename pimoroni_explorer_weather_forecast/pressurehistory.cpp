@@ -0,0 +1,259 @@
+#include "pressurehistory.h"
+#include <math.h>
+#include <string.h>
+
+// Stored values are Pa from here
+#define PRESSURE_REF_PA  101325
+// A sample that wasn't taken (the station was off)
+#define MISSING          INT16_MIN
+
+#define SAMPLES_PER_HOUR  (3600000 / PRESSURE_SAMPLE_MS)
+#define SAMPLES_PER_DAY   (SAMPLES_PER_HOUR * 24)
+
+#if PRESSURE_RAW_SAMPLES <= PRESSURE_3H_SAMPLES
+#error "The raw tier has to be longer than the trend windows"
+#endif
+
+struct PackedBucket {
+  int16_t min, avg, max;
+};
+
+// Samples of the hour or day still open. slots counts the missing ones
+// too, the bucket closes after a full hour or day of them.
+struct Accumulator {
+  int16_t min, max;
+  int32_t sum;
+  uint16_t count;
+  uint16_t slots;
+};
+
+// Least squares sums over the samples in a trend window, in Pa from the
+// reference. x is minus the age of a sample (0 for the newest), so every
+// new slot moves the x of all samples down by one, the sample leaving the
+// window is taken out again. Integers, so they never drift.
+struct TrendSums {
+  int32_t sum_x;
+  int32_t sum_xx;
+  int32_t sum_y;
+  int32_t sum_xy;
+  int64_t sum_yy;
+  uint16_t count;
+};
+
+// Ring bookkeeping, head is the next slot to write
+struct Ring {
+  uint16_t head;
+  uint16_t count;
+};
+
+// Everything that has to survive a reboot, in one block
+static struct {
+  int16_t raw[PRESSURE_RAW_SAMPLES];
+  PackedBucket hourly[PRESSURE_HOURLY_BUCKETS];
+  PackedBucket daily[PRESSURE_DAILY_BUCKETS];
+  Ring rings[PRESSURE_TIER_COUNT];
+  Accumulator openHour, openDay;
+} state;
+
+static TrendSums trendSums[PRESSURE_WINDOW_COUNT];
+
+static const uint16_t windowSizes[PRESSURE_WINDOW_COUNT] = { PRESSURE_1H_SAMPLES, PRESSURE_3H_SAMPLES };
+
+static const uint16_t ringSizes[PRESSURE_TIER_COUNT] = {
+  PRESSURE_RAW_SAMPLES, PRESSURE_HOURLY_BUCKETS, PRESSURE_DAILY_BUCKETS
+};
+
+static int16_t pack(float hPa) {
+  long pa = lroundf(hPa * 100.0f) - PRESSURE_REF_PA;
+  if (pa > 32767) pa = 32767;
+  if (pa < -32767) pa = -32767;
+  return (int16_t)pa;
+}
+
+static float unpack(int16_t value) {
+  if (value == MISSING) return NAN;
+  return (PRESSURE_REF_PA + value) * 0.01f;
+}
+
+// Slot for the next entry, the oldest one goes when the ring is full
+static uint16_t push(PressureTier tier) {
+  Ring &ring = state.rings[tier];
+  uint16_t slot = ring.head;
+  ring.head = (ring.head + 1) % ringSizes[tier];
+  if (ring.count < ringSizes[tier]) ring.count++;
+  return slot;
+}
+
+// Sample of the raw tier by age
+static int16_t rawAt(uint16_t age) {
+  const Ring &ring = state.rings[PRESSURE_RAW];
+  return state.raw[(ring.head + PRESSURE_RAW_SAMPLES - 1 - age) % PRESSURE_RAW_SAMPLES];
+}
+
+static void accumulate(Accumulator &acc, int16_t value) {
+  acc.slots++;
+  if (value == MISSING) return;
+  if (acc.count == 0 || value < acc.min) acc.min = value;
+  if (acc.count == 0 || value > acc.max) acc.max = value;
+  acc.sum += value;
+  acc.count++;
+}
+
+// Average rounded to the nearest Pa
+static int16_t average(const Accumulator &acc) {
+  int32_t half = acc.count / 2;
+  return (int16_t)((acc.sum >= 0 ? acc.sum + half : acc.sum - half) / acc.count);
+}
+
+static PackedBucket closeBucket(Accumulator &acc) {
+  PackedBucket bucket = { MISSING, MISSING, MISSING };
+  if (acc.count > 0) bucket = { acc.min, average(acc), acc.max };
+  memset(&acc, 0, sizeof(acc));
+  return bucket;
+}
+
+static void toBucket(const PackedBucket &packed, PressureBucket &bucket) {
+  bucket.min = unpack(packed.min);
+  bucket.avg = unpack(packed.avg);
+  bucket.max = unpack(packed.max);
+}
+
+// A new slot at x = 0: all samples move one down, (x - 1)^2 = x^2 - 2x + 1
+static void shiftTrend(TrendSums &t, int16_t value) {
+  t.sum_xy -= t.sum_y;
+  t.sum_xx += t.count - 2 * t.sum_x;
+  t.sum_x -= t.count;
+  if (value == MISSING) return;
+  t.sum_y += value;
+  t.sum_yy += (int32_t)value * value;
+  t.count++;
+}
+
+// After value went into the raw ring. The slot leaving the window is still
+// in the ring, the ring is longer than the windows.
+static void updateTrend(TrendSums &t, uint16_t size, int16_t value) {
+  shiftTrend(t, value);
+  if (state.rings[PRESSURE_RAW].count <= size) return;
+  int16_t old = rawAt(size);
+  if (old == MISSING) return;
+  t.sum_x += size;
+  t.sum_xx -= (int32_t)size * size;
+  t.sum_xy += (int32_t)size * old;
+  t.sum_y -= old;
+  t.sum_yy -= (int32_t)old * old;
+  t.count--;
+}
+
+// Sums from the samples in the ring, after loading it
+static void rebuildTrends() {
+  memset(trendSums, 0, sizeof(trendSums));
+  for (int i = 0; i < PRESSURE_WINDOW_COUNT; i++) {
+    uint16_t n = state.rings[PRESSURE_RAW].count;
+    if (n > windowSizes[i]) n = windowSizes[i];
+    for (uint16_t age = n; age > 0; age--) {
+      shiftTrend(trendSums[i], rawAt(age - 1));
+    }
+  }
+}
+
+static void addSlot(int16_t value) {
+  state.raw[push(PRESSURE_RAW)] = value;
+  for (int i = 0; i < PRESSURE_WINDOW_COUNT; i++) {
+    updateTrend(trendSums[i], windowSizes[i], value);
+  }
+  
+  // The day gets the samples directly, so its average is exact too
+  accumulate(state.openHour, value);
+  accumulate(state.openDay, value);
+  if (state.openHour.slots == SAMPLES_PER_HOUR) state.hourly[push(PRESSURE_HOURLY)] = closeBucket(state.openHour);
+  if (state.openDay.slots == SAMPLES_PER_DAY) state.daily[push(PRESSURE_DAILY)] = closeBucket(state.openDay);
+}
+
+void pressureHistoryClear() {
+  memset(&state, 0, sizeof(state));
+  memset(trendSums, 0, sizeof(trendSums));
+}
+
+void pressureHistoryAdd(float hPa) {
+  addSlot(pack(hPa));
+}
+
+void pressureHistoryGap(uint32_t samples) {
+  // Longer than all of it: start over
+  if (samples >= (uint32_t)PRESSURE_DAILY_BUCKETS * SAMPLES_PER_DAY) {
+    pressureHistoryClear();
+    return;
+  }
+  while (samples-- > 0) {
+    addSlot(MISSING);
+  }
+}
+
+uint16_t pressureHistoryCount(PressureTier tier) {
+  if (tier >= PRESSURE_TIER_COUNT) return 0;
+  return state.rings[tier].count;
+}
+
+bool pressureHistoryAt(PressureTier tier, uint16_t age, PressureBucket &bucket) {
+  if (tier >= PRESSURE_TIER_COUNT || age >= state.rings[tier].count) return false;
+  uint16_t size = ringSizes[tier];
+  uint16_t slot = (state.rings[tier].head + size - 1 - age) % size;
+  
+  if (tier == PRESSURE_RAW) {
+    bucket.min = bucket.avg = bucket.max = unpack(state.raw[slot]);
+  } else {
+    toBucket(tier == PRESSURE_HOURLY ? state.hourly[slot] : state.daily[slot], bucket);
+  }
+  return true;
+}
+
+bool pressureHistoryOpen(PressureTier tier, PressureBucket &bucket) {
+  const Accumulator *acc;
+  if (tier == PRESSURE_HOURLY) acc = &state.openHour;
+  else if (tier == PRESSURE_DAILY) acc = &state.openDay;
+  else return false;
+  if (acc->count == 0) return false;
+  
+  PackedBucket packed = { acc->min, average(*acc), acc->max };
+  toBucket(packed, bucket);
+  return true;
+}
+
+bool pressureHistoryTrend(PressureWindow window, PressureTrend &trend) {
+  if (window >= PRESSURE_WINDOW_COUNT) return false;
+  const TrendSums &t = trendSums[window];
+  trend.samples = t.count;
+  if (t.count < 2) return false;
+  
+  // Doubles because sum_yy is bigger than a float holds exactly, this
+  // only runs when someone asks
+  double n = t.count;
+  double dxx = t.sum_xx - (double)t.sum_x * t.sum_x / n;
+  double dxy = t.sum_xy - (double)t.sum_x * t.sum_y / n;
+  double dyy = (double)t.sum_yy - (double)t.sum_y * t.sum_y / n;
+  double slope = dxy / dxx;  // Pa per sample
+  
+  trend.slope = slope * SAMPLES_PER_HOUR * 0.01;
+  trend.now = (PRESSURE_REF_PA + (t.sum_y - slope * t.sum_x) / n) * 0.01;
+  trend.variance = t.count > 2 ? fmax(dyy - slope * dxy, 0.0) / (n - 2) * 1e-4 : 0;
+  return true;
+}
+
+void *pressureHistoryState(uint32_t &size) {
+  size = sizeof(state);
+  return &state;
+}
+
+bool pressureHistoryLoaded() {
+  bool ok = true;
+  for (int i = 0; i < PRESSURE_TIER_COUNT; i++) {
+    if (state.rings[i].head >= ringSizes[i] || state.rings[i].count > ringSizes[i]) ok = false;
+  }
+  if (state.openHour.slots >= SAMPLES_PER_HOUR || state.openDay.slots >= SAMPLES_PER_DAY) ok = false;
+  if (!ok) {
+    pressureHistoryClear();
+    return false;
+  }
+  rebuildTrends();
+  return true;
+}
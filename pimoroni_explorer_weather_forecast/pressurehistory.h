@@ -0,0 +1,67 @@
+#ifndef _PRESSUREHISTORY_H_
+#define _PRESSUREHISTORY_H_
+
+#include <stdint.h>
+
+// Pressure history in three tiers: the 5 minute samples of the last day,
+// and hourly and daily min/avg/max buckets they roll up into. Values are
+// kept as int16 Pa from a reference pressure (686 to 1340 hPa in 0.01 hPa
+// steps), so all of it takes 2 KB. Appending and reading an entry are
+// O(1), the readers use pressureHistoryAt() on the tier that fits their
+// time span. A least squares line through the last hour and the last 3
+// hours of samples is kept up to date with every sample, also in O(1).
+// Plain C++ so it also builds on the host.
+
+#define PRESSURE_SAMPLE_MS       300000  // one sample every 5 minutes
+#define PRESSURE_RAW_SAMPLES     288     // 24 hours
+#define PRESSURE_HOURLY_BUCKETS  168     // 7 days
+#define PRESSURE_DAILY_BUCKETS   90
+
+enum PressureTier { PRESSURE_RAW, PRESSURE_HOURLY, PRESSURE_DAILY, PRESSURE_TIER_COUNT };
+
+// Trend windows
+#define PRESSURE_1H_SAMPLES  12
+#define PRESSURE_3H_SAMPLES  36
+
+enum PressureWindow { PRESSURE_WINDOW_1H, PRESSURE_WINDOW_3H, PRESSURE_WINDOW_COUNT };
+
+// hPa. Raw samples have the same value in all three, samples that were
+// not taken and buckets without any are NAN.
+struct PressureBucket {
+  float min;
+  float avg;
+  float max;
+};
+
+struct PressureTrend {
+  float slope;     // hPa per hour
+  float now;       // the line at the newest sample, hPa
+  float variance;  // of the samples around the line, hPa^2
+  uint16_t samples;  // in the window, up to its size
+};
+
+void pressureHistoryClear();
+// One sample every PRESSURE_SAMPLE_MS, every 12th closes an hour and
+// every 288th a day
+void pressureHistoryAdd(float hPa);
+// Samples that were not taken, e.g. while the station was off
+void pressureHistoryGap(uint32_t samples);
+
+// Entries in a tier, up to its size
+uint16_t pressureHistoryCount(PressureTier tier);
+// age 0 is the newest entry of the tier
+bool pressureHistoryAt(PressureTier tier, uint16_t age, PressureBucket &bucket);
+// The hour or day that is still being filled, false when it has no
+// samples yet
+bool pressureHistoryOpen(PressureTier tier, PressureBucket &bucket);
+// Line through the samples in the window, false below 2 samples (but
+// samples is set)
+bool pressureHistoryTrend(PressureWindow window, PressureTrend &trend);
+
+// The history as one block, to save it and load it back. Call
+// pressureHistoryLoaded() after writing into it, which checks it (and
+// clears the history when it doesn't make sense) and works out the trend.
+void *pressureHistoryState(uint32_t &size);
+bool pressureHistoryLoaded();
+
+#endif
@@ -0,0 +1,141 @@
+#include "scheduler.h"
+#include "pico/time.h"
+#include "hardware/sync.h"
+
+struct SchedTask {
+  SchedFunc func;
+  uint32_t period_ms;
+  uint32_t deadline_ms;
+  uint32_t next_ms;       // due time
+  volatile bool triggered;
+  SchedStats stats;
+};
+
+static SchedTask tasks[SCHED_MAX_TASKS];
+static uint8_t taskCount = 0;
+static volatile bool wakeUp = false;
+
+// Load measurement
+static uint32_t busyUs = 0;
+static uint32_t loadStartUs = 0;
+
+int8_t schedAdd(SchedFunc func, uint32_t period_ms, uint32_t deadline_ms) {
+  if (taskCount >= SCHED_MAX_TASKS || !func) return -1;
+  SchedTask &t = tasks[taskCount];
+  t.func = func;
+  t.period_ms = period_ms;
+  t.deadline_ms = deadline_ms;
+  t.next_ms = millis();
+  t.triggered = false;
+  memset(&t.stats, 0, sizeof(t.stats));
+  return taskCount++;
+}
+
+void schedSetPeriod(int8_t task, uint32_t period_ms) {
+  if (task < 0 || task >= taskCount) return;
+  tasks[task].period_ms = period_ms;
+  tasks[task].next_ms = millis();
+}
+
+void schedTrigger(int8_t task) {
+  if (task < 0 || task >= taskCount) return;
+  tasks[task].triggered = true;
+  wakeUp = true;
+}
+
+static int64_t wakeAlarm(alarm_id_t id, void *user_data) {
+  (void)id;
+  (void)user_data;
+  wakeUp = true;
+  return 0;
+}
+
+void schedRun() {
+  // Cleared before looking at the tasks, so a trigger that comes while
+  // they are checked still ends the sleep below
+  wakeUp = false;
+  uint32_t now = millis();
+  
+  // Earliest deadline first among the due tasks, triggered ones are due now
+  int8_t best = -1;
+  uint32_t bestDeadline = 0;
+  uint32_t nextDue = now + 1000;
+  for (uint8_t i = 0; i < taskCount; i++) {
+    SchedTask &t = tasks[i];
+    bool periodic = t.period_ms > 0;
+    uint32_t due = t.triggered ? now : t.next_ms;
+    if (!t.triggered && !periodic) continue;
+    
+    if ((int32_t)(now - due) < 0) {
+      if ((int32_t)(due - nextDue) < 0) nextDue = due;
+      continue;
+    }
+    uint32_t deadline = due + (t.deadline_ms ? t.deadline_ms : t.period_ms);
+    if (best < 0 || (int32_t)(deadline - bestDeadline) < 0) {
+      best = i;
+      bestDeadline = deadline;
+    }
+  }
+  
+  if (best < 0) {
+    // Nothing due: sleep until the alarm or a trigger. With interrupts
+    // masked a pending one still ends the WFI, so one that comes between
+    // the check and the WFI isn't slept through.
+    alarm_id_t alarm = add_alarm_in_ms(nextDue - now, wakeAlarm, NULL, true);
+    if (alarm < 0) {
+      delay(1);
+      return;
+    }
+    while (true) {
+      noInterrupts();
+      if (wakeUp) break;
+      __wfi();
+      interrupts();
+    }
+    interrupts();
+    if (alarm > 0) cancel_alarm(alarm);
+    return;
+  }
+  
+  SchedTask &t = tasks[best];
+  uint32_t due = t.triggered ? now : t.next_ms;
+  uint32_t late = now - due;
+  if (late > t.stats.max_late_ms) t.stats.max_late_ms = late;
+  if ((int32_t)(now - bestDeadline) > 0) t.stats.late++;
+  
+  bool triggered = t.triggered;
+  t.triggered = false;
+  uint32_t start = micros();
+  t.func();
+  uint32_t us = micros() - start;
+  busyUs += us;
+  t.stats.runs++;
+  if (us > t.stats.max_run_us) t.stats.max_run_us = us;
+  
+  // Next period, a task that fell behind whole periods drops them instead
+  // of running back to back to catch up
+  if (t.period_ms && !triggered) {
+    t.next_ms += t.period_ms;
+    uint32_t behind = millis() - t.next_ms;
+    if ((int32_t)behind >= 0) {
+      uint32_t periods = behind / t.period_ms + 1;
+      t.next_ms += periods * t.period_ms;
+      t.stats.skipped += periods;
+    }
+  }
+}
+
+bool schedGetStats(int8_t task, SchedStats &stats) {
+  if (task < 0 || task >= taskCount) return false;
+  stats = tasks[task].stats;
+  return true;
+}
+
+uint16_t schedLoad(uint16_t scale) {
+  uint32_t now = micros();
+  uint32_t elapsed = now - loadStartUs;
+  uint16_t load = elapsed ? (uint16_t)((uint64_t)busyUs * scale / elapsed) : 0;
+  busyUs = 0;
+  loadStartUs = now;
+  return load;
+}
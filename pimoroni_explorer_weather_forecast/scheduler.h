@@ -0,0 +1,41 @@
+#ifndef _SCHEDULER_H_
+#define _SCHEDULER_H_
+
+#include <Arduino.h>
+
+// Cooperative scheduler for loop(). Every task has a period and a deadline
+// (how late after its due time it may still start). schedRun() runs one
+// due task, the one whose deadline comes first, or sleeps (WFI, woken by a
+// timer alarm) until the next task is due or one is triggered. Tasks run
+// to completion, so keep them short: the sensors are read in the
+// background by sensorstick.cpp, tasks only use results.
+
+#define SCHED_MAX_TASKS  12
+
+typedef void (*SchedFunc)();
+
+struct SchedStats {
+  uint32_t runs;
+  uint32_t late;         // started after their deadline
+  uint32_t skipped;      // periods dropped because the task fell behind
+  uint32_t max_late_ms;  // worst start after the due time
+  uint32_t max_run_us;
+};
+
+// Period 0 runs the task only when triggered. Deadline 0 is the period.
+// Returns the task number, -1 when the table is full.
+int8_t schedAdd(SchedFunc func, uint32_t period_ms, uint32_t deadline_ms = 0);
+void schedSetPeriod(int8_t task, uint32_t period_ms);
+
+// Make a task due right away and end the sleep, also from interrupts
+void schedTrigger(int8_t task);
+
+// Call from loop()
+void schedRun();
+
+bool schedGetStats(int8_t task, SchedStats &stats);
+// Share of the time spent in tasks since the last call, in percent or in
+// 1/scale (10000 for hundredths of a percent)
+uint16_t schedLoad(uint16_t scale = 100);
+
+#endif